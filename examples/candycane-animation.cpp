@@ -50,6 +50,7 @@ struct CandyCaneConfig {
     bool movingRight = true;      // Current direction
     float speedMultiplier = 1.0;  // Current speed multiplier
     float currentStretch = 1.0;   // Current stretch value
+    float renderedStretch = 0.0;  // Stretch value of the pattern currently in the pixels
     bool stretchingOut = true;    // Whether we're currently growing or shrinking
     
     // Timing tracking
@@ -165,10 +166,17 @@ bool isRedSegment(int position, int baseSegmentSize, float stretchMultiplier) {
     return distanceFromCenter < (currentRedSize / 2);
 }
 
+// Initialize the candy cane animation
+void setup_candy_cane(CandyCaneConfig* config, long currentTime);
+
 // Main animation function
 void candy_cane_animation(PixAniData* data) {
-    CandyCaneConfig* config = (CandyCaneConfig*)data->data;
+    // the config lives in the animation's state storage, constructed with the defaults when it starts
+    CandyCaneConfig* config = data->state<CandyCaneConfig>();
     long currentTime = data->updated;
+    if (data->firstFire()) {
+        setup_candy_cane(config, currentTime);
+    }
     
     // Update animation states
     updateDirection(config, currentTime);
@@ -180,24 +188,32 @@ void candy_cane_animation(PixAniData* data) {
     int basePosition = currentTime / effectiveSpeed;
     int position = calculatePosition(basePosition, data->pixelCount, config->movingRight);
     
-    // Update all pixels
-    for (int i = 0; i < data->pixelCount; i++) {
-        // In power save mode, turn off every other LED
-        if (config->powerSaveMode && (i % 2 == 1)) {
-            data->pixels[i] = Color::BLACK;
-            continue;
+    if (config->powerSaveMode) {
+        // Update all pixels, every other LED is off so the pattern can't simply be scrolled
+        for (int i = 0; i < data->pixelCount; i++) {
+            if (i % 2 == 1) {
+                data->pixels[i] = Color::BLACK;
+                continue;
+            }
+            int adjustedPos = ((i + position) % data->pixelCount) / 2;
+            bool isRed = isRedSegment(adjustedPos, config->baseSegmentSize, config->currentStretch);
+            data->pixels[i] = data->paletteColor(isRed ? 0 : 1);
         }
-        
-        // Calculate position in the pattern
-        int adjustedPos = (i + position) % data->pixelCount;
-        if (config->powerSaveMode) {
-            adjustedPos = adjustedPos / 2;
+        data->offset = 0;
+        config->renderedStretch = 0.0;
+        return;
+    }
+
+    // Only render the pattern when its shape changes, movement is done by scrolling the output
+    if (data->firstFire() || config->renderedStretch != config->currentStretch) {
+        for (int i = 0; i < data->pixelCount; i++) {
+            // Determine color based on position and current stretch value
+            bool isRed = isRedSegment(i, config->baseSegmentSize, config->currentStretch);
+            data->pixels[i] = data->paletteColor(isRed ? 0 : 1);
         }
-        
-        // Determine color based on position and current stretch value
-        bool isRed = isRedSegment(adjustedPos, config->baseSegmentSize, config->currentStretch);
-        data->pixels[i] = data->paletteColor(isRed ? 0 : 1);
+        config->renderedStretch = config->currentStretch;
     }
+    data->offset = position;
 }
 
 // Initialize the candy cane animation
@@ -222,15 +238,12 @@ void setup_candy_cane(CandyCaneConfig* config, long currentTime) {
 }
 
 
-CandyCaneConfig config = CandyCaneConfig();
-
 void setup() {
     px.setup();
     px.setPixels(Color::BLACK);
 
     // Start the animation
-    setup_candy_cane(&config, millis());
-    px.startAnimation(&candy_cane_animation, &candyPalette, 25, -1, (int)&config);
+    px.startAnimation(&candy_cane_animation, &candyPalette, 25, -1);
 }
 
 void loop() {
@@ -0,0 +1,52 @@
+/*
+ * Project clocked-strip
+ * Author: Kevin Smith
+ * Date: 2024-12-12
+ *
+ * Drives an APA102 (or SK9822 / HD107S) strip from the SPI MOSI and SCK pins at a 5ms refresh,
+ * dimming it with the 5-bit global brightness, and logs the frame rate every 5 seconds.
+ */
+#include "Particle.h"
+#include "pixeleds-library.h"
+#include "pixeleds-colors.h"
+#if HAL_PLATFORM_RTL872X
+#include "pixeleds-photon2.h"
+#else
+#include "pixeleds-photon1.h"
+#endif
+
+SYSTEM_MODE(SEMI_AUTOMATIC);
+SYSTEM_THREAD(ENABLED);
+
+#define PARTICLE_PIXEL_PIN 0           // SPI (MOSI + SCK), 1 for SPI1
+#define PARTICLE_PIXEL_COUNT 300
+#define PARTICLE_PIXEL_TYPE APA102
+#define PARTICLE_PIXEL_ORDER ORDER_BGR
+
+#define STATS_INTERVAL 5000
+
+PixCol pixels[PARTICLE_PIXEL_COUNT];
+ParticlePixels strip(pixels, PARTICLE_PIXEL_COUNT, PARTICLE_PIXEL_PIN, PARTICLE_PIXEL_TYPE, PARTICLE_PIXEL_ORDER);
+Pixeleds px(&strip);
+SerialLogHandler logHandler;
+
+system_tick_t statsTime = 0;
+
+
+void setup() {
+    px.setup();
+    strip.setGlobalBrightness(8);     // of 31, dims without losing color resolution
+    px.setAnimationRefresh(5);
+    px.startAnimation(&animation_comet, &Color::RAINBOW, 1000);
+}
+
+void loop() {
+    px.update(millis());
+
+    if (millis() - statsTime >= STATS_INTERVAL) {
+        PixFrameStats stats = px.getFrameStats();
+        Log.info("frames=%lu average interval=%luus late=%lu", stats.frames, stats.averageInterval(), stats.late);
+        px.resetFrameStats();
+        statsTime = millis();
+    }
+}
@@ -0,0 +1,83 @@
+/*
+ * Project frame-exchange-stress
+ * Author: Kevin Smith
+ * Date: 2024-12-12
+ *
+ * Several threads publish whole frames of one color as fast as they can while loop() shows
+ * them, checking that every frame shown is complete (a torn frame would mix two colors).
+ */
+#include "Particle.h"
+#include "pixeleds-library.h"
+#include "pixeleds-colors.h"
+
+SYSTEM_MODE(SEMI_AUTOMATIC);
+SYSTEM_THREAD(ENABLED);
+
+#define PARTICLE_PIXEL_PIN 0
+#define PARTICLE_PIXEL_COUNT 300
+#define PARTICLE_PIXEL_TYPE WS2812B
+#define PARTICLE_PIXEL_ORDER ORDER_GRB
+
+#define WRITER_COUNT 3
+#define STATS_INTERVAL 5000
+
+Pixeleds px = Pixeleds(PARTICLE_PIXEL_COUNT, PARTICLE_PIXEL_PIN, PARTICLE_PIXEL_TYPE, PARTICLE_PIXEL_ORDER);
+PixFrameExchange exchange(PARTICLE_PIXEL_COUNT);
+Thread *writers[WRITER_COUNT];
+
+unsigned long torn = 0;
+unsigned long shown = 0;
+system_tick_t statsTime = 0;
+
+
+// half of the writes render into the back buffer, the other half publish a copy
+void writerThread(void *param) {
+    int id = (int) (intptr_t) param;
+    PixCol frame[PARTICLE_PIXEL_COUNT];
+    for (uint32_t count = 0; ; count++) {
+        PixCol color = PixCol::hsv((id * 0.33f) + (count % 100) / 300.0f, 1.0, 0.2);
+        if (count % 2) {
+            for (int idx = 0; idx < PARTICLE_PIXEL_COUNT; idx++) { frame[idx] = color; }
+            exchange.publish(frame);
+        }
+        else {
+            PixCol *back = exchange.beginFrame();
+            if (back) {
+                for (int idx = 0; idx < PARTICLE_PIXEL_COUNT; idx++) { back[idx] = color; }
+                exchange.endFrame();
+            }
+        }
+        os_thread_yield();
+    }
+}
+
+void setup() {
+    px.setup();
+    px.setFrameExchange(&exchange);
+    for (int idx = 0; idx < WRITER_COUNT; idx++) {
+        writers[idx] = new Thread("writer", writerThread, (void*) (intptr_t) idx);
+    }
+}
+
+void loop() {
+    unsigned long acquired = exchange.acquired;
+    px.update(millis());
+
+    // the front frame belongs to this thread until the next update()
+    if (exchange.acquired != acquired) {
+        shown++;
+        const PixCol *frame = exchange.front();
+        for (int idx = 1; idx < PARTICLE_PIXEL_COUNT; idx++) {
+            if (frame[idx] != frame[0]) {
+                torn++;
+                break;
+            }
+        }
+    }
+
+    if (millis() - statsTime >= STATS_INTERVAL) {
+        Log.info("published=%lu shown=%lu collisions=%lu torn=%lu",
+                 exchange.published.load(), shown, exchange.collisions.load(), torn);
+        statsTime = millis();
+    }
+}
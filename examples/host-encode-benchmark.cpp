@@ -0,0 +1,61 @@
+/*
+ * Project host-encode-benchmark
+ * Author: Kevin Smith
+ * Date: 2024-12-12
+ *
+ * Host build only (PIXELEDS_HOST=1): times the SPI encoders of each LED type on the same frames
+ * and prints the cost per LED relative to WS2812B. Built by the CMake host build:
+ *
+ *   cmake -S . -B build && cmake --build build --target host-encode-benchmark
+ */
+#include "Particle.h"
+#include "pixeleds-library.h"
+#include "pixeleds-encode.h"
+#include <vector>
+
+#define BENCH_PIXELS 300
+#define BENCH_FRAMES 50000
+
+static std::vector<PixCol> pixels(BENCH_PIXELS);
+static std::vector<uint8_t> buffer(BENCH_PIXELS * WS2816_BYTES_PER_LED * SPI_BITS_FACTOR);
+static volatile uint8_t sink;
+
+// ns per LED of encode
+template <typename ENCODE>
+static double benchmark(const char *name, ENCODE encode) {
+    unsigned long begin = micros();
+    for (int frame = 0; frame < BENCH_FRAMES; frame++) {
+        pixels[frame % BENCH_PIXELS] = PixCol(frame, frame >> 8, frame >> 3);
+        PixOutputWalk walk(pixels.data(), BENCH_PIXELS, OUTPUT_DIRECT, 0, 0);
+        encode(buffer.data(), walk);
+        sink = buffer[frame % buffer.size()];
+    }
+    double ns = (micros() - begin) * 1000.0 / BENCH_FRAMES / BENCH_PIXELS;
+    printf("%-8s %6.2f ns/LED", name, ns);
+    return ns;
+}
+
+int main() {
+    for (int idx = 0; idx < BENCH_PIXELS; idx++) {
+        pixels[idx] = PixCol::hsv(idx * 360 / BENCH_PIXELS, 255, 200);
+    }
+    PixGamma16 gamma(PIXEL_GAMMA_16);
+
+    double ws2812b = benchmark("WS2812B", [](uint8_t *pos, PixOutputWalk &walk) {
+        encodeSpiPixelsAt(pos, walk, BENCH_PIXELS, 3, 0, 6, 0);
+    });
+    printf("\n");
+    double ws2816 = benchmark("WS2816", [&](uint8_t *pos, PixOutputWalk &walk) {
+        encodeSpiPixels16(pos, walk, BENCH_PIXELS, 6, 0, 12, gamma);
+    });
+    printf(" %5.2fx\n", ws2816 / ws2812b);
+    double apa102 = benchmark("APA102", [](uint8_t *pos, PixOutputWalk &walk) {
+        encodeClockedPixels(pos, walk, BENCH_PIXELS, 3, 2, 1, CLOCKED_MAX_BRIGHTNESS);
+    });
+    printf(" %5.2fx\n", apa102 / ws2812b);
+    double hd108 = benchmark("HD108", [&](uint8_t *pos, PixOutputWalk &walk) {
+        encodeHd108Pixels(pos, walk, BENCH_PIXELS, 2, 4, 6, CLOCKED_MAX_BRIGHTNESS, gamma);
+    });
+    printf(" %5.2fx\n", hd108 / ws2812b);
+    return 0;
+}
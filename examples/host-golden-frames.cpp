@@ -0,0 +1,104 @@
+/*
+ * Project host-golden-frames
+ * Author: Kevin Smith
+ * Date: 2024-12-12
+ *
+ * Host build only (PIXELEDS_HOST=1): records the frames of every built-in animation as golden
+ * streams, or renders them again and compares them with the golden streams, so a rewrite of the
+ * color math or the animations can be checked for changes in the output. check also verifies that
+ * the Photon 1 and Photon 2 encoders send the same data bits for every frame.
+ * Built by the CMake host build:
+ *
+ *   cmake -S . -B build && cmake --build build --target host-golden-frames
+ *   build/host-golden-frames check golden         # as the golden-frames ctest does
+ *   build/host-golden-frames check golden 1       # channels may differ by 1
+ *   build/host-golden-frames record golden        # after a change meant to alter the output
+ */
+#include "Particle.h"
+#include "pixeleds-library.h"
+#include "pixeleds-colors.h"
+#include "pixeleds-golden.h"
+
+#define PARTICLE_PIXEL_COUNT 60
+
+// the 60 pixels as a 10x6 zig-zag panel for the 2D animations
+PixLayout panel(10, 6, LAYOUT_SERPENTINE);
+
+PixGoldenCase cases[] = {
+    {"blink", &animation_blink, &Color::RGB, 1000, 0, PARTICLE_PIXEL_COUNT, nullptr, nullptr},
+    {"alternating", &animation_alternating, &Color::RYGB, 1000, 0, PARTICLE_PIXEL_COUNT, nullptr, nullptr},
+    {"strobe", &animation_strobe, &Color::BW, 500, 0, PARTICLE_PIXEL_COUNT, nullptr, nullptr},
+    {"cycle", &animation_cycle, &Color::RAINBOW, 1400, 0, PARTICLE_PIXEL_COUNT, nullptr, nullptr},
+    {"random", &animation_random, &Color::RAINBOW, 1000, 0, PARTICLE_PIXEL_COUNT, nullptr, nullptr},
+    {"fadeIn", &animation_fadeIn, &Color::REDS, 2000, 0, PARTICLE_PIXEL_COUNT, nullptr, nullptr},
+    {"fadeOut", &animation_fadeOut, &Color::REDS, 2000, 0, PARTICLE_PIXEL_COUNT, nullptr, nullptr},
+    {"fader", &animation_fader, &Color::BLUES, 2000, 0, PARTICLE_PIXEL_COUNT, nullptr, nullptr},
+    {"glow", &animation_glow, &Color::GREENS, 1500, 0, PARTICLE_PIXEL_COUNT, nullptr, nullptr},
+    {"gradient", &animation_gradient, &Color::RAINBOW, 2000, 0, PARTICLE_PIXEL_COUNT, nullptr, nullptr},
+    {"increment", &animation_increment, &Color::RYGB, 1000, 0, PARTICLE_PIXEL_COUNT, nullptr, nullptr},
+    {"decrement", &animation_decrement, &Color::RYGB, 1000, 0, PARTICLE_PIXEL_COUNT, nullptr, nullptr},
+    {"bars", &animation_bars, &Color::RGB, 1000, 0, PARTICLE_PIXEL_COUNT, nullptr, nullptr},
+    {"comet", &animation_comet, &Color::BLUES, 2000, 0, PARTICLE_PIXEL_COUNT, nullptr, nullptr},
+    {"bounce", &animation_bounce, &Color::PURPLES, 2000, 0, PARTICLE_PIXEL_COUNT, nullptr, nullptr},
+    {"scanner", &animation_scanner, &Color::REDS, 1500, 0, PARTICLE_PIXEL_COUNT, nullptr, nullptr},
+    {"sparkle", &animation_sparkle, &Color::CYANS, 1000, 0, PARTICLE_PIXEL_COUNT, nullptr, nullptr},
+    {"gradient-hsv", &animation_gradient, &Color::RAINBOW, 2000, 0, PARTICLE_PIXEL_COUNT, &PixHsvTable::standard(), nullptr},
+    {"gradient2d", &animation_gradient2d, &Color::RAINBOW, 2000, 0, PARTICLE_PIXEL_COUNT, nullptr, &panel},
+    {"scanner2d", &animation_scanner2d, &Color::RAINBOW, 2000, 0, PARTICLE_PIXEL_COUNT, nullptr, &panel},
+};
+
+#define CASE_COUNT (int)(sizeof(cases) / sizeof(cases[0]))
+
+
+// the frames of a case through each single-wire encoder, returns false if any LED differs or a type isn't checked
+static bool checkEncoders(PixGolden &golden, const PixGoldenCase &test) {
+    std::vector<PixCol> frames(golden.getFrames() * test.pixelCount);
+    if (!golden.render(test, frames.data())) return false;
+    bool same = true;
+    for (int frame = 0; frame < golden.getFrames(); frame++) {
+        const PixCol *pixels = &frames[frame * test.pixelCount];
+        int led;
+        if ((led = PixGolden::compareEncoders(pixels, test.pixelCount, WS2812B, ORDER_GRB)) != -1
+            || (led = PixGolden::compareEncoders(pixels, test.pixelCount, WS2812B, ORDER_BRG)) != -1
+            || (led = PixGolden::compareEncoders(pixels, test.pixelCount, SK6812W, ORDER_GRBW)) != -1
+            || (led = PixGolden::compareEncoders(pixels, test.pixelCount, WS2816, ORDER_GRB)) != -1
+            || (led = PixGolden::compareFixedEncoder<WS2812B, ORDER_GRB>(pixels, test.pixelCount)) != -1
+            || (led = PixGolden::compareFixedEncoder<SK6812W, ORDER_GRBW>(pixels, test.pixelCount)) != -1) {
+            if (led == PIXGOLDEN_UNCHECKED) printf("%s: encoder not checked\n", test.name);
+            else printf("%s: encoders differ at frame %d LED %d\n", test.name, frame, led);
+            same = false;
+            break;
+        }
+    }
+    return same;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        printf("usage: %s record|check <dir> [tolerance]\n", argv[0]);
+        return 2;
+    }
+    bool record = strcmp(argv[1], "record") == 0;
+    const char *dir = argv[2];
+    int tolerance = argc > 3 ? atoi(argv[3]) : 0;
+
+    PixGolden golden;
+    int failed = 0;
+    for (int idx = 0; idx < CASE_COUNT; idx++) {
+        if (record) {
+            if (!golden.record(cases[idx], dir)) {
+                printf("%s: can't record\n", cases[idx].name);
+                failed++;
+            }
+            continue;
+        }
+        PixGoldenResult result = golden.compare(cases[idx], dir, tolerance);
+        char text[200];
+        result.format(text, sizeof(text));
+        printf("%s\n", text);
+        if (!result.passed()) failed++;
+        if (!checkEncoders(golden, cases[idx])) failed++;
+    }
+    printf(record ? "%d cases recorded in %s, %d failed\n" : "%d cases checked against %s, %d failed\n", CASE_COUNT, dir, failed);
+    return failed ? 1 : 0;
+}
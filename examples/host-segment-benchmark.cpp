@@ -0,0 +1,80 @@
+/*
+ * Project host-segment-benchmark
+ * Author: Kevin Smith
+ * Date: 2024-12-12
+ *
+ * Host build only (PIXELEDS_HOST=1): renders a large installation of independent segments with
+ * PixSegmentRenderer on 1, 2, 4, ... threads up to one per core and prints frames per second and
+ * the speedup over one thread. Built by the CMake host build:
+ *
+ *   cmake -S . -B build && cmake --build build --target host-segment-benchmark
+ */
+#include "Particle.h"
+#include "pixeleds-library.h"
+#include "pixeleds-colors.h"
+#include "pixeleds-host.h"
+
+#define PARTICLE_PIXEL_COUNT 300     // pixels per segment
+#define PARTICLE_PIXEL_TYPE WS2812B
+#define PARTICLE_PIXEL_ORDER ORDER_GRB
+
+#define BENCH_SEGMENTS 128
+#define BENCH_FRAMES 500
+#define BENCH_FRAME_MILLIS 20
+
+
+// the output of every segment, a checksum stands in for sending the frame to a controller
+static void outputSegment(const PixCol* frame, int outputCount, void* context) {
+    uint32_t* checksum = (uint32_t*) context;
+    *checksum = pixelHash(frame, outputCount, *checksum);
+}
+
+// a mix of cheap and expensive animations so the threads get uneven work (see work stealing)
+static void startSegment(Pixeleds* px, int index) {
+    px->setAnimationRefresh(BENCH_FRAME_MILLIS);
+    px->setChangeDetection(false);  // every frame is rendered and output
+    switch (index % 4) {
+        case 0: px->startAnimation(&animation_gradient, &Color::RAINBOW, 3000 + index * 10); break;
+        case 1: px->startAnimation(&animation_comet, &Color::BLUES, 2000 + index * 10); break;
+        case 2: px->startAnimation(&animation_glow, &Color::REDS, 4000 + index * 10); break;
+        case 3: px->startAnimation(&animation_sparkle, &Color::PURPLES, 1000 + index * 10); break;
+    }
+}
+
+static double benchmark(int threads, uint32_t* checksum) {
+    PixSegmentRenderer renderer(threads);
+    for (int idx = 0; idx < BENCH_SEGMENTS; idx++) {
+        Pixeleds* px = renderer.addSegment(PARTICLE_PIXEL_COUNT, &outputSegment, checksum, PARTICLE_PIXEL_TYPE, PARTICLE_PIXEL_ORDER);
+        if (!px) return 0;
+        startSegment(px, idx);
+    }
+
+    system_tick_t start = millis();
+    unsigned long begin = micros();
+    for (int frame = 0; frame < BENCH_FRAMES; frame++) {
+        renderer.render(start + frame * BENCH_FRAME_MILLIS);
+    }
+    double seconds = (micros() - begin) / 1000000.0;
+    printf("%2d threads: %7.1f frames/s, %5.1f Mpixels/s, %lu steals\n", renderer.getThreadCount(),
+           BENCH_FRAMES / seconds, BENCH_FRAMES * (double) BENCH_SEGMENTS * PARTICLE_PIXEL_COUNT / seconds / 1e6,
+           renderer.getSteals());
+    return BENCH_FRAMES / seconds;
+}
+
+int main() {
+    int cores = (int) std::thread::hardware_concurrency();
+    if (cores < 1) cores = 1;
+    printf("%d segments of %d pixels, %d frames, %d cores\n", BENCH_SEGMENTS, PARTICLE_PIXEL_COUNT, BENCH_FRAMES, cores);
+
+    uint32_t checksum = 0;
+    double single = benchmark(1, &checksum);
+    for (int threads = 2; threads <= cores; threads *= 2) {
+        double fps = benchmark(threads, &checksum);
+        printf("           speedup %.2fx\n", single > 0 ? fps / single : 0);
+    }
+    if (cores > 1 && (cores & (cores - 1))) {
+        double fps = benchmark(cores, &checksum);
+        printf("           speedup %.2fx\n", single > 0 ? fps / single : 0);
+    }
+    return 0;
+}
@@ -0,0 +1,43 @@
+/*
+ * Project hsv-rainbow
+ * Author: Kevin Smith
+ * Date: 2024-12-12
+ *
+ * A rainbow animation written in HSV pixels: the hue rotates by a byte add, the saturation
+ * breathes by a byte write, the pixels are converted to RGB while the frame is encoded.
+ */
+#include "Particle.h"
+#include "pixeleds-library.h"
+#include "pixeleds-colors.h"
+
+SYSTEM_MODE(SEMI_AUTOMATIC);
+SYSTEM_THREAD(ENABLED);
+
+#define PARTICLE_PIXEL_PIN 0
+#define PARTICLE_PIXEL_COUNT 60
+#define PARTICLE_PIXEL_TYPE WS2812B
+#define PARTICLE_PIXEL_ORDER ORDER_GRB
+
+Pixeleds px = Pixeleds(PARTICLE_PIXEL_COUNT, PARTICLE_PIXEL_PIN, PARTICLE_PIXEL_TYPE, PARTICLE_PIXEL_ORDER);
+PixHsvTable rainbow(HSV_RAINBOW);
+
+
+// the whole hue wheel spread over the strip, rotating once per cycle
+void hsv_rainbow(PixAniData *data) {
+    byte hue = data->step(256);
+    byte sat = 192 + data->triangleWave(4) * 63;
+    PixHsv *pixels = data->hsvPixels();
+    for (int idx = 0; idx < data->pixelCount; idx++) {
+        pixels[idx] = PixHsv(hue + idx * 256 / data->pixelCount, sat, 160);
+    }
+}
+
+void setup() {
+    px.setup();
+    px.setHsvPixels(&rainbow);
+    px.startAnimation(&hsv_rainbow, &Color::RAINBOW, 5000);
+}
+
+void loop() {
+    px.update(millis());
+}
@@ -0,0 +1,55 @@
+/*
+ * Project idle-scheduling
+ * Author: Kevin Smith
+ * Date: 2024-12-12
+ *
+ * Cycles through the rainbow palette, sleeping between the frames that actually change instead
+ * of polling update(), and logs how much of the time was spent idle every 10 seconds.
+ */
+#include "Particle.h"
+#include "pixeleds-library.h"
+#include "pixeleds-colors.h"
+
+SYSTEM_MODE(SEMI_AUTOMATIC);
+SYSTEM_THREAD(ENABLED);
+
+#define PARTICLE_PIXEL_PIN 0
+#define PARTICLE_PIXEL_COUNT 60
+#define PARTICLE_PIXEL_TYPE WS2812B
+#define PARTICLE_PIXEL_ORDER ORDER_GRB
+
+#define MAX_IDLE 1000
+#define STATS_INTERVAL 10000
+
+Pixeleds px = Pixeleds(PARTICLE_PIXEL_COUNT, PARTICLE_PIXEL_PIN, PARTICLE_PIXEL_TYPE, PARTICLE_PIXEL_ORDER);
+SerialLogHandler logHandler;
+
+system_tick_t statsTime = 0;
+system_tick_t idleTotal = 0;
+unsigned long wakes = 0;
+
+
+void setup() {
+    px.setup();
+    px.startAnimation(&animation_cycle, &Color::RAINBOW, 7000);
+}
+
+void loop() {
+    px.update(millis());
+    wakes++;
+
+    // the next palette step, capped so the stats below are still logged
+    system_tick_t idle = min(px.getIdleMillis(millis()), (system_tick_t) MAX_IDLE);
+    if (idle > 0) {
+        delay(idle);
+        idleTotal += idle;
+    }
+
+    if (millis() - statsTime >= STATS_INTERVAL) {
+        system_tick_t elapsed = millis() - statsTime;
+        Log.info("wakes=%lu idle=%lu%%", wakes, idleTotal * 100 / elapsed);
+        wakes = 0;
+        idleTotal = 0;
+        statsTime = millis();
+    }
+}
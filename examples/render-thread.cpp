@@ -0,0 +1,57 @@
+/*
+ * Project render-thread
+ * Author: Kevin Smith
+ * Date: 2024-12-12
+ *
+ * Renders the animation on its own thread while loop() does slow work, changing the palette
+ * every 10 seconds and logging the frame timing every 5 seconds.
+ */
+#include "Particle.h"
+#include "pixeleds-library.h"
+#include "pixeleds-colors.h"
+
+SYSTEM_MODE(SEMI_AUTOMATIC);
+SYSTEM_THREAD(ENABLED);
+
+#define PARTICLE_PIXEL_PIN 0
+#define PARTICLE_PIXEL_COUNT 300
+#define PARTICLE_PIXEL_TYPE WS2812B
+#define PARTICLE_PIXEL_ORDER ORDER_GRB
+
+#define STATS_INTERVAL 5000
+#define PALETTE_INTERVAL 10000
+
+Pixeleds px = Pixeleds(PARTICLE_PIXEL_COUNT, PARTICLE_PIXEL_PIN, PARTICLE_PIXEL_TYPE, PARTICLE_PIXEL_ORDER);
+SerialLogHandler logHandler;
+
+system_tick_t statsTime = 0;
+system_tick_t paletteTime = 0;
+bool rainbow = true;
+
+
+void setup() {
+    px.setup();
+    px.setAnimationRefresh(20);
+    px.startAnimation(&animation_comet, &Color::RAINBOW, 3000);
+    px.startThread();
+}
+
+void loop() {
+    // stands in for sensors, network requests etc. that would make a polled update() stutter
+    delay(random(5, 60));
+
+    if (millis() - paletteTime >= PALETTE_INTERVAL) {
+        rainbow = !rainbow;
+        px.startAnimation(&animation_comet, rainbow ? &Color::RAINBOW : &Color::BLUES, 3000);
+        paletteTime = millis();
+    }
+
+    if (millis() - statsTime >= STATS_INTERVAL) {
+        PixFrameStats stats = px.getFrameStats();
+        Log.info("frames=%lu interval avg=%luus min=%luus max=%luus jitter=%luus late=%lu",
+                 stats.frames, stats.averageInterval(), stats.minInterval, stats.maxInterval,
+                 stats.jitter(), stats.late);
+        px.resetFrameStats();
+        statsTime = millis();
+    }
+}
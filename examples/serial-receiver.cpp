@@ -0,0 +1,52 @@
+/*
+ * Project serial-receiver
+ * Author: Kevin Smith
+ * Date: 2024-12-12
+ *
+ * Shows frames rendered on a PC and sent over USB serial (see tools/pixserial-send.py), logging
+ * the achieved frames and bytes per second every 5 seconds.
+ */
+#include "Particle.h"
+#include "pixeleds-library.h"
+#include "pixeleds-colors.h"
+#include "pixeleds-serial.h"
+
+SYSTEM_MODE(SEMI_AUTOMATIC);
+SYSTEM_THREAD(ENABLED);
+
+#define PARTICLE_PIXEL_PIN 0
+#define PARTICLE_PIXEL_COUNT 300
+#define PARTICLE_PIXEL_TYPE WS2812B
+#define PARTICLE_PIXEL_ORDER ORDER_GRB
+
+#define STATS_INTERVAL 5000
+
+Pixeleds px = Pixeleds(PARTICLE_PIXEL_COUNT, PARTICLE_PIXEL_PIN, PARTICLE_PIXEL_TYPE, PARTICLE_PIXEL_ORDER);
+PixSerial receiver(px, Serial);
+
+system_tick_t statsTime = 0;
+unsigned long statsFrames = 0;
+unsigned long statsBytes = 0;
+
+
+void setup() {
+    Serial.begin();
+    Serial1.begin(115200);
+    px.setup();
+}
+
+void loop() {
+    receiver.receive();
+    px.update(millis());
+
+    if (millis() - statsTime >= STATS_INTERVAL) {
+        // stats go to Serial1 (TX pin) so they don't mix with the frames on USB serial
+        Serial1.printlnf("%.1f fps, %.0f bytes/s, errors=%lu skipped=%lu",
+                         (receiver.frames - statsFrames) * 1000.0f / STATS_INTERVAL,
+                         (receiver.bytes - statsBytes) * 1000.0f / STATS_INTERVAL,
+                         receiver.errors, receiver.skipped);
+        statsFrames = receiver.frames;
+        statsBytes = receiver.bytes;
+        statsTime = millis();
+    }
+}
@@ -0,0 +1,141 @@
+/*
+ * Project stream-benchmark
+ * Author: Kevin Smith
+ * Date: 2024-12-12
+ *
+ * Measures how fast PixStream decodes frames from memory and from LittleFS, then plays the
+ * benchmark stream on the strip.
+ */
+#include "Particle.h"
+#include "pixeleds-library.h"
+#include "pixeleds-colors.h"
+#include "pixeleds-stream.h"
+
+#if HAL_PLATFORM_FILESYSTEM
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+SYSTEM_MODE(SEMI_AUTOMATIC);
+SYSTEM_THREAD(ENABLED);
+
+#define PARTICLE_PIXEL_PIN 0
+#define PARTICLE_PIXEL_COUNT 300
+#define PARTICLE_PIXEL_TYPE WS2812B
+#define PARTICLE_PIXEL_ORDER ORDER_GRB
+
+#define BENCH_FRAMES 200
+#define BENCH_FRAME_MILLIS 20
+#define BENCH_FILE "/bench.pxs"
+
+Pixeleds px = Pixeleds(PARTICLE_PIXEL_COUNT, PARTICLE_PIXEL_PIN, PARTICLE_PIXEL_TYPE, PARTICLE_PIXEL_ORDER);
+
+PixCol benchPixels[PARTICLE_PIXEL_COUNT];
+PixStream show;
+uint8_t *benchStream = nullptr;
+size_t benchSize = 0;
+
+
+static uint8_t *putLong(uint8_t *pos, uint32_t value) {
+    for (int idx = 0; idx < 4; idx++) { *pos++ = value >> (idx * 8); }
+    return pos;
+}
+
+static uint8_t *putWord(uint8_t *pos, uint16_t value) {
+    *pos++ = value;
+    *pos++ = value >> 8;
+    return pos;
+}
+
+// every 10th frame is a full literal keyframe (worst case), the rest move a comet as small deltas
+void buildBenchStream() {
+    size_t keyLength = 4 + PARTICLE_PIXEL_COUNT * sizeof(PixCol);
+    size_t deltaLength = 2 * (4 + sizeof(PixCol));
+    benchSize = PIXSTREAM_HEADER_SIZE + BENCH_FRAMES * (PIXSTREAM_FRAME_HEADER_SIZE + keyLength);
+    benchStream = (uint8_t*) malloc(benchSize);
+    if (!benchStream) return;
+
+    uint8_t *pos = benchStream;
+    memcpy(pos, "PXS", 3);
+    pos[3] = PIXSTREAM_VERSION;
+    pos = putWord(pos + 4, PARTICLE_PIXEL_COUNT);
+    pos = putWord(pos, 0);
+    pos = putLong(pos, BENCH_FRAMES);
+    pos = putLong(pos, BENCH_FRAMES * BENCH_FRAME_MILLIS);
+
+    for (int frame = 0; frame < BENCH_FRAMES; frame++) {
+        bool key = frame % 10 == 0;
+        pos = putLong(pos, frame * BENCH_FRAME_MILLIS);
+        *pos++ = key ? PIXSTREAM_FRAME_KEY : PIXSTREAM_FRAME_DELTA;
+        size_t length = key ? keyLength : deltaLength;
+        *pos++ = length; *pos++ = length >> 8; *pos++ = length >> 16;
+        if (key) {
+            pos = putWord(pos, 0);
+            pos = putWord(pos, PARTICLE_PIXEL_COUNT);
+            for (int idx = 0; idx < PARTICLE_PIXEL_COUNT; idx++) {
+                PixCol color = PixCol::hsv((float) idx / PARTICLE_PIXEL_COUNT, 1.0, 0.2);
+                memcpy(pos, &color, sizeof(PixCol));
+                pos += sizeof(PixCol);
+            }
+        }
+        else {
+            // light the comet head and clear its tail
+            int head = frame % PARTICLE_PIXEL_COUNT;
+            pos = putWord(pos, head ? head - 1 : 0);
+            pos = putWord(pos, 0x8000 | 1);
+            *pos++ = 0; *pos++ = 0; *pos++ = 0;
+            pos = putWord(pos, 0);
+            pos = putWord(pos, 0x8000 | 1);
+            *pos++ = 255; *pos++ = 255; *pos++ = 255;
+        }
+    }
+    benchSize = pos - benchStream;
+}
+
+void report(const char *source, PixStream &stream, unsigned long elapsed) {
+    float seconds = elapsed / 1000000.0f;
+    Log.info("%s: %lu frames, %lu bytes in %lu us = %.0f frames/s, %.0f KB/s", source,
+             stream.framesDecoded, stream.bytesRead, elapsed,
+             stream.framesDecoded / seconds, stream.bytesRead / 1024.0f / seconds);
+}
+
+void benchmark() {
+    PixStream stream;
+    uint32_t end = BENCH_FRAMES * BENCH_FRAME_MILLIS;
+
+    if (stream.openMemory(benchStream, benchSize)) {
+        unsigned long start = micros();
+        stream.render(benchPixels, PARTICLE_PIXEL_COUNT, end);
+        report("memory", stream, micros() - start);
+    }
+
+#if HAL_PLATFORM_FILESYSTEM
+    int fd = open(BENCH_FILE, O_WRONLY | O_CREAT | O_TRUNC);
+    if (fd >= 0) {
+        write(fd, benchStream, benchSize);
+        close(fd);
+    }
+    if (stream.openFile(BENCH_FILE)) {
+        unsigned long start = micros();
+        stream.render(benchPixels, PARTICLE_PIXEL_COUNT, end);
+        report("littlefs", stream, micros() - start);
+    }
+#endif
+}
+
+
+void setup() {
+    px.setup();
+    waitFor(Serial.isConnected, 10000);
+    buildBenchStream();
+    benchmark();
+
+    // then loop the benchmark stream on the strip
+    if (show.openMemory(benchStream, benchSize)) {
+        px.startAnimation(&animation_stream, nullptr, show.getDuration(), -1, (intptr_t) &show);
+    }
+}
+
+void loop() {
+    px.update(millis());
+}
@@ -0,0 +1,53 @@
+/*
+ * Project udp-receiver
+ * Author: Kevin Smith
+ * Date: 2024-12-12
+ *
+ * Shows frames sent by a show controller (e.g. xLights, or tools/pixudp-send.py) over DDP,
+ * logging the received frame rate every 5 seconds.
+ */
+#include "Particle.h"
+#include "pixeleds-library.h"
+#include "pixeleds-colors.h"
+#include "pixeleds-udp.h"
+
+SYSTEM_MODE(SEMI_AUTOMATIC);
+SYSTEM_THREAD(ENABLED);
+
+#define PARTICLE_PIXEL_PIN 0
+#define PARTICLE_PIXEL_COUNT 1000
+#define PARTICLE_PIXEL_TYPE WS2812B
+#define PARTICLE_PIXEL_ORDER ORDER_GRB
+
+#define STATS_INTERVAL 5000
+
+Pixeleds px = Pixeleds(PARTICLE_PIXEL_COUNT, PARTICLE_PIXEL_PIN, PARTICLE_PIXEL_TYPE, PARTICLE_PIXEL_ORDER);
+PixUdp receiver(px);
+
+system_tick_t statsTime = 0;
+unsigned long statsFrames = 0;
+
+
+void setup() {
+    px.setup();
+    // glow until the first frame arrives
+    px.startAnimation(&animation_glow, &Color::BLUES, 3000);
+
+    WiFi.connect();
+    waitUntil(WiFi.ready);
+    receiver.begin(PIXUDP_DDP);  // or PIXUDP_E131 starting at universe 1
+    Log.info("Listening on %s", WiFi.localIP().toString().c_str());
+}
+
+void loop() {
+    receiver.receive();
+    px.update(millis());
+
+    if (millis() - statsTime >= STATS_INTERVAL) {
+        Log.info("%.1f fps, packets=%lu dropped=%lu invalid=%lu",
+                 (receiver.frames - statsFrames) * 1000.0f / STATS_INTERVAL,
+                 receiver.packets, receiver.dropped, receiver.invalid);
+        statsFrames = receiver.frames;
+        statsTime = millis();
+    }
+}
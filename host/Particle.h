@@ -0,0 +1,833 @@
+/*
+Copyright 2024 The Brynwood Team, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/*
+ * The Device OS calls the library uses, for host builds (PIXELEDS_HOST=1) on Linux and macOS.
+ *
+ * The clock runs in real time from the start of the program, or is set by the program with
+ * hostSetMillis()/hostAdvanceMillis() so tests and golden frames don't depend on how fast they
+ * run, or follows the CPU time of one thread (hostCpuTime()) so timing tests don't depend on
+ * the load of the machine. random() is a fixed generator (splitmix64) so the same seed gives the
+ * same animation on every C library.
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#ifdef __APPLE__
+#include <mach/mach.h>
+#endif
+
+#ifndef PIXELEDS_HOST
+#define PIXELEDS_HOST 1
+#endif
+
+#ifndef __unused
+#define __unused __attribute__((unused))
+#endif
+
+typedef uint8_t byte;
+typedef uint32_t system_tick_t;
+typedef uint16_t pin_t;
+
+
+/*
+ * clock
+ */
+
+struct HostClock {
+    std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+    std::atomic<bool> manual{false};
+    std::atomic<uint64_t> manualMicros{0};
+
+    // CPU time of cpuThread less cpuOffset (see hostCpuTime()), it doesn't pass interruptDue
+    std::atomic<bool> cpu{false};
+    pthread_t cpuThread;
+    std::atomic<uint64_t> cpuOffset{0};
+    std::atomic<uint64_t> interruptDue{UINT64_MAX};
+
+    // the earliest interrupt not delivered yet of each simulated peripheral
+    std::mutex interruptMutex;
+    std::vector<std::pair<const void*, uint64_t>> interrupts;
+
+    static HostClock& instance() {
+        static HostClock clock;
+        return clock;
+    }
+};
+
+// CPU time used by a thread, in microseconds
+inline uint64_t hostThreadMicros(pthread_t thread) {
+#ifdef __APPLE__
+    thread_basic_info_data_t info;
+    mach_msg_type_number_t count = THREAD_BASIC_INFO_COUNT;
+    if (thread_info(pthread_mach_thread_np(thread), THREAD_BASIC_INFO, (thread_info_t) &info, &count) != KERN_SUCCESS) return 0;
+    return (uint64_t) (info.user_time.seconds + info.system_time.seconds) * 1000000 +
+           info.user_time.microseconds + info.system_time.microseconds;
+#else
+    clockid_t id;
+    timespec time;
+    if (pthread_getcpuclockid(thread, &id) || clock_gettime(id, &time)) return 0;
+    return (uint64_t) time.tv_sec * 1000000 + time.tv_nsec / 1000;
+#endif
+}
+
+// the time of the simulated interrupt running on this thread, UINT64_MAX if there is none
+inline uint64_t& hostInterruptMicros() {
+    thread_local uint64_t time = UINT64_MAX;
+    return time;
+}
+
+inline uint64_t hostCpuMicros() {
+    HostClock& clock = HostClock::instance();
+    uint64_t offset, now;
+    do {
+        offset = clock.cpuOffset.load();
+        now = hostThreadMicros(clock.cpuThread) - offset;
+    } while (offset != clock.cpuOffset.load());
+    return now;
+}
+
+// microseconds since the program started, the time set with hostSetMillis(), or on the CPU clock;
+// in a simulated interrupt the time it was raised
+inline unsigned long micros() {
+    HostClock& clock = HostClock::instance();
+    if (hostInterruptMicros() != UINT64_MAX) return (unsigned long) hostInterruptMicros();
+    if (clock.manual.load(std::memory_order_acquire)) return (unsigned long) clock.manualMicros.load();
+    if (clock.cpu.load(std::memory_order_acquire)) {
+        uint64_t now = hostCpuMicros(), due = clock.interruptDue.load();
+        return (unsigned long) (now < due ? now : due);
+    }
+    return (unsigned long) std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - clock.origin).count();
+}
+
+inline system_tick_t millis() {
+    return (system_tick_t) (micros() / 1000);
+}
+
+// stop the clock at millis, it only moves with hostSetMillis(), hostAdvanceMillis() and delay()
+inline void hostSetMillis(system_tick_t millis) {
+    HostClock& clock = HostClock::instance();
+    clock.manualMicros.store((uint64_t) millis * 1000);
+    clock.manual.store(true, std::memory_order_release);
+    clock.cpu.store(false, std::memory_order_release);
+}
+
+inline void hostAdvanceMillis(system_tick_t millis) {
+    HostClock::instance().manualMicros.fetch_add((uint64_t) millis * 1000);
+}
+
+// back to real time
+inline void hostRealTime() {
+    HostClock::instance().manual.store(false, std::memory_order_release);
+    HostClock::instance().cpu.store(false, std::memory_order_release);
+}
+
+/*
+ * From now on the clock runs on the CPU time of the calling thread, the one core of the device: it
+ * stands still while the host runs other threads or programs, and while the thread sleeps (delay()
+ * spins on it). The simulated peripherals (SPIClass) raise their interrupts on this clock, it doesn't
+ * pass one before it was delivered, so a late host thread doesn't make a late interrupt.
+ */
+inline void hostCpuTime() {
+    HostClock& clock = HostClock::instance();
+    uint64_t now = micros();
+    clock.cpuThread = pthread_self();
+    clock.cpuOffset = hostThreadMicros(clock.cpuThread) - now;
+    clock.manual.store(false, std::memory_order_release);
+    clock.cpu.store(true, std::memory_order_release);
+}
+
+// true on the thread whose CPU time is the clock
+inline bool hostIsClockThread() {
+    HostClock& clock = HostClock::instance();
+    return clock.cpu.load(std::memory_order_acquire) && pthread_equal(pthread_self(), clock.cpuThread);
+}
+
+// the next interrupt of a simulated peripheral is raised at due, UINT64_MAX for none
+inline void hostInterruptDue(const void* source, uint64_t due) {
+    HostClock& clock = HostClock::instance();
+    std::lock_guard<std::mutex> lock(clock.interruptMutex);
+    uint64_t earliest = due;
+    bool found = false;
+    for (auto& interrupt : clock.interrupts) {
+        if (interrupt.first == source) {
+            interrupt.second = due;
+            found = true;
+        }
+        else if (interrupt.second < earliest) earliest = interrupt.second;
+    }
+    if (!found) clock.interrupts.emplace_back(source, due);
+    clock.interruptDue = earliest;
+}
+
+// the interrupt raised at due is delivered now, returns the time it runs at: on the CPU clock due, the
+// time that went by since is skipped, otherwise when it got to run
+inline unsigned long hostInterruptAt(unsigned long due) {
+    HostClock& clock = HostClock::instance();
+    if (!clock.cpu.load(std::memory_order_acquire)) {
+        unsigned long now = micros();
+        return (long) (now - due) > 0 ? now : due;
+    }
+    uint64_t now = hostCpuMicros();
+    if (now > due) clock.cpuOffset += now - due;
+    return due;
+}
+
+// sleeps, or advances a stopped clock, or spins on the CPU clock
+inline void delay(unsigned long ms) {
+    if (HostClock::instance().manual.load(std::memory_order_acquire)) hostAdvanceMillis(ms);
+    else if (hostIsClockThread()) for (unsigned long start = micros(); micros() - start < ms * 1000;);
+    else std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+// spins like on the device, or advances a stopped clock
+inline void delayMicroseconds(unsigned int us) {
+    if (HostClock::instance().manual.load(std::memory_order_acquire)) HostClock::instance().manualMicros.fetch_add(us);
+    else for (unsigned long start = micros(); micros() - start < us;);
+}
+
+
+/*
+ * random numbers
+ */
+
+inline std::atomic<uint64_t>& hostRandomState() {
+    static std::atomic<uint64_t> state{0};
+    return state;
+}
+
+inline uint32_t hostRandom() {
+    uint64_t z = hostRandomState().fetch_add(0x9E3779B97F4A7C15ULL) + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return (uint32_t) ((z ^ (z >> 31)) >> 32);
+}
+
+inline void randomSeed(unsigned int seed) {
+    hostRandomState().store(seed);
+}
+
+// 0 to max - 1
+inline long random(long max) {
+    return max > 0 ? (long) (hostRandom() % (unsigned long) max) : 0;
+}
+
+// min to max - 1
+inline long random(long min, long max) {
+    return max > min ? min + (long) (hostRandom() % (unsigned long) (max - min)) : min;
+}
+
+
+/*
+ * min, max and constrain of mixed types (Device OS has these as templates too)
+ */
+
+template <typename A, typename B>
+constexpr typename std::common_type<A, B>::type min(A a, B b) {
+    typedef typename std::common_type<A, B>::type T;
+    return (T) b < (T) a ? (T) b : (T) a;
+}
+
+template <typename A, typename B>
+constexpr typename std::common_type<A, B>::type max(A a, B b) {
+    typedef typename std::common_type<A, B>::type T;
+    return (T) a < (T) b ? (T) b : (T) a;
+}
+
+template <typename T, typename L, typename H>
+constexpr T constrain(T amount, L low, H high) {
+    return amount < (T) low ? (T) low : (amount > (T) high ? (T) high : amount);
+}
+
+
+/*
+ * logging, to stderr
+ */
+
+class Logger {
+public:
+    void trace(const char* format, ...) const __attribute__((format(printf, 2, 3))) {
+        va_list args;
+        va_start(args, format);
+        write(0, "TRACE", format, args);
+        va_end(args);
+    }
+    void info(const char* format, ...) const __attribute__((format(printf, 2, 3))) {
+        va_list args;
+        va_start(args, format);
+        write(1, "INFO", format, args);
+        va_end(args);
+    }
+    void warn(const char* format, ...) const __attribute__((format(printf, 2, 3))) {
+        va_list args;
+        va_start(args, format);
+        write(2, "WARN", format, args);
+        va_end(args);
+    }
+    void error(const char* format, ...) const __attribute__((format(printf, 2, 3))) {
+        va_list args;
+        va_start(args, format);
+        write(3, "ERROR", format, args);
+        va_end(args);
+    }
+
+    // messages below this level are dropped: 0 trace, 1 info, 2 warn, 3 error, 4 none
+    static std::atomic<int>& level() {
+        static std::atomic<int> level{1};
+        return level;
+    }
+
+private:
+    static void write(int severity, const char* name, const char* format, va_list args) {
+        if (severity < level().load(std::memory_order_relaxed)) return;
+        char text[512];
+        vsnprintf(text, sizeof(text), format, args);
+        fprintf(stderr, "%010lu [pixeleds] %s: %s\n", (unsigned long) millis(), name, text);
+    }
+};
+
+inline Logger Log;
+
+
+/*
+ * system
+ */
+
+class SystemClass {
+public:
+    // free heap, the available physical memory unless a test set it with hostSetFreeMemory()
+    uint32_t freeMemory() {
+        long limit = freeMemoryLimit().load();
+        if (limit >= 0) return (uint32_t) limit;
+        long pages = sysconf(_SC_AVPHYS_PAGES), size = sysconf(_SC_PAGESIZE);
+        unsigned long long bytes = pages > 0 && size > 0 ? (unsigned long long) pages * size : 0;
+        return bytes > UINT32_MAX ? UINT32_MAX : (uint32_t) bytes;
+    }
+
+    static std::atomic<long>& freeMemoryLimit() {
+        static std::atomic<long> limit{-1};
+        return limit;
+    }
+};
+
+inline SystemClass System;
+
+// the free memory reported by System.freeMemory(), -1 for the real value
+inline void hostSetFreeMemory(long bytes) {
+    SystemClass::freeMemoryLimit().store(bytes);
+}
+
+
+/*
+ * streams on file descriptors
+ */
+
+// the Device OS Stream calls the library uses, readBytes() reads in bulk
+class Stream {
+public:
+    virtual ~Stream() { }
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual size_t readBytes(char* buffer, size_t length) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t length) = 0;
+
+    size_t readBytes(uint8_t* buffer, size_t length) { return readBytes((char*) buffer, length); }
+    size_t write(uint8_t value) { return write(&value, 1); }
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        char text[512];
+        va_list args;
+        va_start(args, format);
+        int length = vsnprintf(text, sizeof(text), format, args);
+        va_end(args);
+        return length > 0 ? write((const uint8_t*) text, min((size_t) length, sizeof(text) - 1)) : 0;
+    }
+
+    size_t printlnf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        char text[512];
+        va_list args;
+        va_start(args, format);
+        int length = vsnprintf(text, sizeof(text) - 2, format, args);
+        va_end(args);
+        if (length < 0) return 0;
+        length = min(length, (int) sizeof(text) - 3);
+        text[length++] = '\r';
+        text[length++] = '\n';
+        return write((const uint8_t*) text, length);
+    }
+};
+
+/**
+ * A Stream on a file descriptor, e.g. the master side of a pseudo-terminal, a pipe or a serial
+ * device opened by the program. available() doesn't block; readBytes() waits for the bytes asked
+ * for, so ask for at most available() as PixSerial does.
+ */
+class FdStream : public Stream {
+public:
+    explicit FdStream(int readFd, int writeFd = -1) : readFd(readFd), writeFd(writeFd >= 0 ? writeFd : readFd) { }
+
+    void begin(unsigned long baud = 9600) { }
+
+    int available() override {
+        int count = 0;
+        return ioctl(readFd, FIONREAD, &count) == 0 ? count : 0;
+    }
+
+    int read() override {
+        uint8_t value;
+        return ::read(readFd, &value, 1) == 1 ? value : -1;
+    }
+
+    size_t readBytes(char* buffer, size_t length) override {
+        size_t done = 0;
+        while (done < length) {
+            ssize_t count = ::read(readFd, buffer + done, length - done);
+            if (count <= 0) break;
+            done += count;
+        }
+        return done;
+    }
+
+    size_t write(const uint8_t* buffer, size_t length) override {
+        ssize_t count = ::write(writeFd, buffer, length);
+        return count > 0 ? (size_t) count : 0;
+    }
+    using Stream::write;
+
+private:
+    int readFd;
+    int writeFd;
+};
+
+// the USB serial port of the devices is the terminal of the program
+inline FdStream Serial(STDIN_FILENO, STDOUT_FILENO);
+
+
+/*
+ * UDP on a POSIX socket
+ */
+
+class IPAddress {
+public:
+    IPAddress() : address(0) { }
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : address((uint32_t) a << 24 | b << 16 | c << 8 | d) { }
+    explicit IPAddress(uint32_t address) : address(address) { }
+
+    uint8_t operator[](int index) const { return address >> (24 - 8 * index); }
+    bool operator==(const IPAddress& other) const { return address == other.address; }
+    uint32_t raw() const { return address; }   // host byte order
+
+private:
+    uint32_t address;
+};
+
+/**
+ * The Device OS UDP class: parsePacket() takes the next datagram (without blocking, or waiting up
+ * to timeout ms) into the buffer of setBuffer() size and read() takes bytes from it. Datagrams
+ * larger than the buffer are truncated, as on the devices.
+ */
+class UDP {
+public:
+    ~UDP() { stop(); }
+
+    bool setBuffer(size_t size, uint8_t* buffer = nullptr) {
+        packet.resize(size);
+        return true;
+    }
+
+    uint8_t begin(uint16_t port) {
+        stop();
+        socketFd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (socketFd < 0) return 0;
+        int reuse = 1;
+        setsockopt(socketFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        sockaddr_in local = {};
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = htonl(INADDR_ANY);
+        local.sin_port = htons(port);
+        if (bind(socketFd, (sockaddr*) &local, sizeof(local)) != 0) {
+            stop();
+            return 0;
+        }
+        if (packet.empty()) packet.resize(512);
+        return 1;
+    }
+
+    void stop() {
+        if (socketFd >= 0) close(socketFd);
+        socketFd = -1;
+        length = position = 0;
+    }
+
+    int joinMulticast(const IPAddress& group) {
+        ip_mreq request = {};
+        request.imr_multiaddr.s_addr = htonl(group.raw());
+        request.imr_interface.s_addr = htonl(INADDR_ANY);
+        return setsockopt(socketFd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &request, sizeof(request)) == 0 ? 0 : -1;
+    }
+
+    // size of the next datagram, 0 if there is none
+    int parsePacket(system_tick_t timeout = 0) {
+        length = position = 0;
+        if (socketFd < 0) return 0;
+        if (timeout) {
+            timeval wait = { (time_t) (timeout / 1000), (suseconds_t) (timeout % 1000 * 1000) };
+            setsockopt(socketFd, SOL_SOCKET, SO_RCVTIMEO, &wait, sizeof(wait));
+        }
+        sockaddr_in from = {};
+        socklen_t fromLength = sizeof(from);
+        ssize_t received = recvfrom(socketFd, packet.data(), packet.size(), timeout ? 0 : MSG_DONTWAIT,
+                                    (sockaddr*) &from, &fromLength);
+        if (received <= 0) return 0;
+        remote = IPAddress(ntohl(from.sin_addr.s_addr));
+        remotePortNumber = ntohs(from.sin_port);
+        length = (size_t) received;
+        return (int) length;
+    }
+
+    int available() { return (int) (length - position); }
+
+    int read() { return position < length ? packet[position++] : -1; }
+
+    int read(uint8_t* buffer, size_t size) {
+        size = min(size, length - position);
+        memcpy(buffer, packet.data() + position, size);
+        position += size;
+        return (int) size;
+    }
+
+    IPAddress remoteIP() { return remote; }
+    uint16_t remotePort() { return remotePortNumber; }
+
+    // send a datagram from this socket (or an unbound one), returns the bytes sent or -1
+    int sendPacket(const uint8_t* buffer, size_t size, IPAddress destination, uint16_t port) {
+        int fd = socketFd >= 0 ? socketFd : socket(AF_INET, SOCK_DGRAM, 0);
+        sockaddr_in to = {};
+        to.sin_family = AF_INET;
+        to.sin_addr.s_addr = htonl(destination.raw());
+        to.sin_port = htons(port);
+        ssize_t sent = fd >= 0 ? sendto(fd, buffer, size, 0, (sockaddr*) &to, sizeof(to)) : -1;
+        if (fd != socketFd && fd >= 0) close(fd);
+        return (int) sent;
+    }
+
+private:
+    int socketFd = -1;
+    std::vector<uint8_t> packet;
+    size_t length = 0;
+    size_t position = 0;
+    IPAddress remote;
+    uint16_t remotePortNumber = 0;
+};
+
+
+
+/*
+ * pins, and SPI with a simulated DMA
+ *
+ * Enough for the Photon 2 strip: builds with PIXELEDS_HOST=0 and PLATFORM_ID=32 compile the device
+ * ParticlePixels against these. A transfer takes its time at the clock speed. With a completion
+ * callback it is sent by a DMA thread that calls the callback when it is done (the interrupt,
+ * with no latency, between HAL_disable_irq() and HAL_enable_irq() it waits), without one it
+ * blocks. On the CPU clock (hostCpuTime()) the transfers end on time whenever the DMA thread
+ * gets to run. The transfers are kept with the micros() they started and ended so a test can
+ * rebuild what the LEDs received (with the real-time or CPU clock).
+ */
+
+enum PinMode { INPUT, OUTPUT, INPUT_PULLUP, INPUT_PULLDOWN, PIN_MODE_NONE = 0xFF };
+
+#define LOW 0
+#define HIGH 1
+
+// the SPI pins of the Photon 2
+#define MOSI 15
+#define MISO 16
+#define SCK 17
+#define MOSI1 2
+#define MISO1 3
+#define SCK1 4
+#define PIN_INVALID 0xFF
+
+struct HostPin {
+    PinMode mode = INPUT;
+    int value = LOW;
+};
+
+inline HostPin& hostPin(pin_t pin) {
+    static HostPin pins[32];
+    return pins[pin % 32];
+}
+
+// interrupts: the DMA callbacks below run holding this lock, so code between HAL_disable_irq() and
+// HAL_enable_irq() is never interleaved with a callback, as on the device
+inline std::recursive_mutex& hostIrqMutex() {
+    static std::recursive_mutex mutex;
+    return mutex;
+}
+
+inline int HAL_disable_irq() {
+    hostIrqMutex().lock();
+    return 0;
+}
+inline void HAL_enable_irq(int mask) { hostIrqMutex().unlock(); }
+
+inline PinMode getPinMode(pin_t pin) { return hostPin(pin).mode; }
+inline void pinMode(pin_t pin, PinMode mode) { hostPin(pin).mode = mode; }
+inline int32_t digitalRead(pin_t pin) { return hostPin(pin).value; }
+inline void digitalWrite(pin_t pin, uint8_t value) { hostPin(pin).value = value; }
+
+typedef enum { HAL_SPI_INTERFACE1 = 0, HAL_SPI_INTERFACE2 = 1 } hal_spi_interface_t;
+typedef void (*wiring_spi_dma_transfercomplete_callback_t)(void);
+
+#define HAL_PLATFORM_SPI_NUM 2
+#define HAL_SPI_CONFIG_VERSION 1
+#define HAL_SPI_CONFIG_FLAG_MOSI_ONLY 0x01
+#define SPI_MODE_MASTER 0
+#define SPI_MODE0 0x00
+#define MSBFIRST 1
+
+struct hal_spi_config_t {
+    uint16_t size;
+    uint16_t version;
+    uint32_t flags;
+};
+
+inline int hal_spi_begin_ext(hal_spi_interface_t spi, int mode, pin_t ssPin, const hal_spi_config_t* config) {
+    return 0;
+}
+
+// an SPI transfer as it went out on MOSI, in micros()
+struct HostSpiTransfer {
+    unsigned long start;
+    unsigned long end;
+    std::vector<uint8_t> data;
+};
+
+class SPIClass {
+public:
+    explicit SPIClass(hal_spi_interface_t spiInterface) : spiInterface(spiInterface) { }
+    ~SPIClass() { end(); }
+
+    hal_spi_interface_t interface() { return spiInterface; }
+    void begin() { }
+    void setClockSpeed(unsigned clock) { clockSpeed = clock; }
+    void setBitOrder(uint8_t order) { }
+    void setDataMode(uint8_t mode) { }
+    int32_t beginTransaction() { return 0; }
+    void endTransaction() { }
+
+    // waits for the DMA to finish
+    void end() {
+        {
+            std::lock_guard<std::mutex> lock(dmaMutex);
+            dmaStop = true;
+        }
+        dmaWake.notify_one();
+        if (dmaThread.joinable()) dmaThread.join();
+        dmaStop = false;
+    }
+
+    // sends length bytes after the transfers already queued, from the DMA thread if there is a callback
+    void transfer(const void* tx, void* rx, size_t length, wiring_spi_dma_transfercomplete_callback_t callback) {
+        std::unique_lock<std::mutex> lock(dmaMutex);
+        HostSpiTransfer sent;
+        sent.start = inDmaCallback() ? busyUntil : max(micros(), busyUntil);
+        sent.end = sent.start + (unsigned long) ((uint64_t) length * 8 * 1000000 / clockSpeed);
+        sent.data.assign((const uint8_t*) tx, (const uint8_t*) tx + length);
+        if (rx) memset(rx, 0, length);
+        busyUntil = sent.end;
+        sentTransfers.push_back(std::move(sent));
+        if (!callback) {
+            lock.unlock();
+            sleepUntil(busyUntil);
+            return;
+        }
+        dmaQueue.push_back({ sentTransfers.size() - 1, callback });
+        if (dmaQueue.size() == 1) hostInterruptDue(this, busyUntil);
+        if (!dmaThread.joinable()) dmaThread = std::thread(&SPIClass::runDma, this);
+        lock.unlock();
+        dmaWake.notify_one();
+    }
+
+    // the transfers sent since the last call
+    std::vector<HostSpiTransfer> takeTransfers() {
+        std::lock_guard<std::mutex> lock(dmaMutex);
+        std::vector<HostSpiTransfer> transfers;
+        transfers.swap(sentTransfers);
+        for (auto& queued : dmaQueue) queued.index -= transfers.size();
+        return transfers;
+    }
+
+private:
+    struct DmaTransfer {
+        size_t index;
+        wiring_spi_dma_transfercomplete_callback_t callback;
+    };
+
+    static bool& inDmaCallback() {
+        thread_local bool inCallback = false;
+        return inCallback;
+    }
+
+    // on the CPU clock the thread that is the clock spins, the others sleep until it got there
+    void sleepUntil(unsigned long end) {
+        long remaining = (long) (end - micros());
+        if (!HostClock::instance().cpu.load(std::memory_order_acquire)) {
+            if (remaining > 0) std::this_thread::sleep_for(std::chrono::microseconds(remaining));
+            return;
+        }
+        for (; remaining > 0 && !dmaStop; remaining = (long) (end - micros())) {
+            if (!hostIsClockThread()) std::this_thread::sleep_for(std::chrono::microseconds(remaining));
+        }
+    }
+
+    // the transfer ends when the DMA thread gets to it (on time on the CPU clock), the next one starts from there
+    void runDma() {
+        std::unique_lock<std::mutex> lock(dmaMutex);
+        while (!dmaStop || !dmaQueue.empty()) {
+            if (dmaQueue.empty()) {
+                dmaWake.wait(lock);
+                continue;
+            }
+            DmaTransfer next = dmaQueue.front();
+            unsigned long end = sentTransfers[next.index].end;
+            lock.unlock();
+            sleepUntil(end);
+            lock.lock();
+            next = dmaQueue.front();  // takeTransfers() moves the index
+            dmaQueue.erase(dmaQueue.begin());
+            end = hostInterruptAt(sentTransfers[next.index].end);
+            sentTransfers[next.index].end = end;
+            if (dmaQueue.empty()) busyUntil = max(busyUntil, end);
+            lock.unlock();
+            {
+                std::lock_guard<std::recursive_mutex> irq(hostIrqMutex());
+                hostInterruptMicros() = end;
+                inDmaCallback() = true;
+                next.callback();
+                inDmaCallback() = false;
+                hostInterruptMicros() = UINT64_MAX;
+            }
+            lock.lock();
+            hostInterruptDue(this, dmaQueue.empty() ? UINT64_MAX : sentTransfers[dmaQueue.front().index].end);
+        }
+    }
+
+    hal_spi_interface_t spiInterface;
+    unsigned clockSpeed = 1000000;
+    std::mutex dmaMutex;
+    std::condition_variable dmaWake;
+    std::thread dmaThread;
+    std::atomic<bool> dmaStop{false};
+    std::vector<DmaTransfer> dmaQueue;
+    std::vector<HostSpiTransfer> sentTransfers;
+    unsigned long busyUntil = 0;
+};
+
+inline SPIClass SPI(HAL_SPI_INTERFACE1);
+inline SPIClass SPI1(HAL_SPI_INTERFACE2);
+
+/*
+ * threads and recursive mutexes, on std::thread
+ */
+
+typedef void* os_thread_t;
+typedef uint8_t os_thread_prio_t;
+typedef void (*os_thread_fn_t)(void* param);
+typedef void* os_mutex_recursive_t;
+
+#define OS_THREAD_PRIORITY_DEFAULT 2
+#define OS_THREAD_STACK_SIZE_DEFAULT 3072
+
+inline int os_thread_create(os_thread_t* thread, const char* name, os_thread_prio_t priority, os_thread_fn_t function,
+                            void* param, size_t stackSize) {
+    *thread = new std::thread(function, param);
+    return 0;
+}
+
+inline int os_thread_join(os_thread_t thread) {
+    static_cast<std::thread*>(thread)->join();
+    return 0;
+}
+
+inline int os_thread_cleanup(os_thread_t thread) {
+    delete static_cast<std::thread*>(thread);
+    return 0;
+}
+
+// returning from the thread function ends the std::thread
+inline int os_thread_exit(os_thread_t thread) {
+    return 0;
+}
+
+inline void os_thread_yield() {
+    std::this_thread::yield();
+}
+
+// waits until *previousWake + increment on millis(), in short sleeps so a stopped clock can be advanced
+inline int os_thread_delay_until(system_tick_t* previousWake, system_tick_t increment) {
+    *previousWake += increment;
+    while ((int32_t) (*previousWake - millis()) > 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    return 0;
+}
+
+inline int os_mutex_recursive_create(os_mutex_recursive_t* mutex) {
+    *mutex = new std::recursive_mutex();
+    return 0;
+}
+
+inline int os_mutex_recursive_destroy(os_mutex_recursive_t mutex) {
+    delete static_cast<std::recursive_mutex*>(mutex);
+    return 0;
+}
+
+inline int os_mutex_recursive_lock(os_mutex_recursive_t mutex) {
+    static_cast<std::recursive_mutex*>(mutex)->lock();
+    return 0;
+}
+
+inline int os_mutex_recursive_unlock(os_mutex_recursive_t mutex) {
+    static_cast<std::recursive_mutex*>(mutex)->unlock();
+    return 0;
+}
+
+// runs the block with lockable (anything with lock() and unlock()) held
+#define WITH_LOCK(lockable) \
+    for (bool __todo = true; __todo;) \
+        for (std::lock_guard<decltype(lockable)> __lock((lockable)); __todo; __todo = false)
@@ -0,0 +1,346 @@
+/*
+Copyright 2024 The Brynwood Team, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include "Particle.h"
+#include "pixeleds-library.h"
+
+#define SPI_BITS_FACTOR 3
+
+// clocked types (see PIXEL_TYPE_CLOCKED): 4 bytes per LED, a zero start frame, 10MHz clock
+#define CLOCKED_BYTES_PER_LED 4
+#define CLOCKED_START_BYTES 4
+#define CLOCKED_CLOCK_SPEED 10000000
+#define CLOCKED_MAX_BRIGHTNESS 31
+
+// 16-bit types (see PIXEL_TYPE_16BIT): WS2816 sends 2 bytes per channel, HD108 a 16-bit header
+// (start bit + 3 x 5-bit gain) and 3 x 16-bit channels after a longer start frame
+#define WS2816_BYTES_PER_LED 6
+#define HD108_BYTES_PER_LED 8
+#define HD108_START_BYTES 16
+
+
+
+/**
+ * @struct PixLedFormat
+ * @brief The wire format of an LED type and color order (ORDER_*) as compile-time constants.
+ *
+ * Used by FixedParticlePixels so the encoders can be specialized: channel positions, bytes per
+ * LED and whether a white channel is sent are known to the compiler, the per-pixel encode is
+ * straight-line stores without offset lookups or a white-channel branch.
+ */
+template <byte TYPE, byte ORDER>
+struct PixLedFormat {
+    static_assert(TYPE == WS2812B || TYPE == SK6812W, "Only WS2812B and SK6812W are supported (use ParticlePixels for clocked types)");
+    static_assert((ORDER & 0b11) != (ORDER >> 2 & 0b11) && (ORDER & 0b11) != (ORDER >> 4 & 0b11)
+                  && (ORDER >> 2 & 0b11) != (ORDER >> 4 & 0b11), "Color order must be one of ORDER_*");
+
+    static constexpr bool hasWhite = (ORDER >> 6 & 0b11) != 0;
+    static_assert(hasWhite == (TYPE == SK6812W), "SK6812W needs an RGBW order, WS2812B an RGB order");
+
+    static constexpr byte type = TYPE;
+    static constexpr byte order = ORDER;
+    static constexpr int bytesPerLED = hasWhite ? 4 : 3;
+
+    // position of each channel on the wire (0 = sent first)
+    static constexpr int rIndex = ORDER & 0b11;
+    static constexpr int gIndex = ORDER >> 2 & 0b11;
+    static constexpr int bIndex = ORDER >> 4 & 0b11;
+    static constexpr int wIndex = ORDER >> 6 & 0b11;
+};
+
+
+/**
+ * Encodes a single byte into a 3-byte WS2812B bit pattern.
+ *
+ * Each bit in the input byte is encoded into a 3-bit pattern:
+ * - '1' is encoded as '110'
+ * - '0' is encoded as '100'
+ *
+ * The encoding is done in three bytes:
+ * First byte:  Contains patterns for bits 7,6,5 (MSB)
+ * Second byte: Contains patterns for bits 4,3,2
+ * Third byte:  Contains patterns for bits 2(cont),1,0 (LSB)
+ *
+ * @param byte    The input byte to encode
+ * @param target  Pointer to where the 3 encoded bytes should be written
+ *
+ * @note This function performs inlined bitwise operations for optimal timing
+ *       in LED control via SPI. The target buffer must have space for 3 bytes.
+ *
+ * Example:
+ * Input:  0b10110100
+ * Output: 0b11010011  First byte  (bits 7,6,5)
+ *         0b01001101  Second byte (bits 4,3,2)
+ *         0b00100110  Third byte  (bits 2-cont,1,0)
+ */
+inline void encodeByteTo3xBits(uint8_t byte, uint8_t* target) {
+    // 1 = 110, 0 = 100
+    // First byte: bits 7,6,5
+    *target++ =
+        ((byte & 0b10000000) ? 0b11000000 : 0b10000000) | // bit 7 -> bits 7,6,5
+        ((byte & 0b01000000) ? 0b00011000 : 0b00010000) | // bit 6 -> bits 4,3,2
+        ((byte & 0b00100000) ? 0b00000011 : 0b00000010);  // bit 5 -> bits 1,0 (continues)
+
+    // Second byte: bits 4,3,2 (bit 5's continuation is always 0)
+    *target++ =
+        ((byte & 0b00010000) ? 0b01100000 : 0b01000000) | // bit 4 -> bits 6,5,4
+        ((byte & 0b00001000) ? 0b00001100 : 0b00001000) | // bit 3 -> bits 3,2,1
+        ((byte & 0b00000100) ? 0b00000001 : 0b00000001);  // bit 2 -> bit 0 (continues)
+
+    // Third byte: continuation of bit 2, then bits 1,0
+    *target =
+        ((byte & 0b00000100) ? 0b10000000 : 0b00000000) | // bit 2 continues -> bits 7,6
+        ((byte & 0b00000010) ? 0b00110000 : 0b00100000) | // bit 1 -> bits 5,4,3
+        ((byte & 0b00000001) ? 0b00000110 : 0b00000100);  // bit 0 -> bits 2,1,0
+}
+
+// encodes count pixels from the walk into SPI bit patterns starting at pos
+typedef void (PixSpiEncoder)(uint8_t* pos, PixOutputWalk& walk, int count);
+
+/**
+ * Encodes count pixels into SPI bit patterns for a fixed format, see encodeByteTo3xBits().
+ * The channel offsets are constants, so each pixel is straight-line stores (the white channel is
+ * a constant pattern, encodeByteTo3xBits(0)).
+ */
+template <typename FORMAT>
+void encodeSpiPixels(uint8_t* pos, PixOutputWalk& walk, int count) {
+    constexpr int stride = FORMAT::bytesPerLED * SPI_BITS_FACTOR;
+    for (int i = 0; i < count; i++, pos += stride) {
+        PixCol pixel = walk.next();
+        encodeByteTo3xBits(pixel.r, pos + FORMAT::rIndex * SPI_BITS_FACTOR);
+        encodeByteTo3xBits(pixel.g, pos + FORMAT::gIndex * SPI_BITS_FACTOR);
+        encodeByteTo3xBits(pixel.b, pos + FORMAT::bIndex * SPI_BITS_FACTOR);
+        if (FORMAT::hasWhite) {
+            encodeByteTo3xBits(0, pos + FORMAT::wIndex * SPI_BITS_FACTOR);
+        }
+    }
+}
+
+/**
+ * Encodes count pixels into SPI bit patterns with the channel offsets known at runtime (in SPI bytes,
+ * from the color order), see encodeByteTo3xBits(). A white offset of 0 means no white channel; the
+ * pixels have none, it is sent as 0.
+ *
+ * The pixels are walked in output order (see PixOutputWalk) so a short rendered buffer can be emitted
+ * tiled/mirrored/reversed on a longer strip, or scrolled, without an intermediate copy.
+ */
+inline void encodeSpiPixelsAt(uint8_t* pos, PixOutputWalk& walk, int count,
+                              uint8_t rOffset, uint8_t gOffset, uint8_t bOffset, uint8_t wOffset) {
+    // e.g. [R:0xA5][G:0x1F][B:0xC0] -> [R:x3][G:x3][B:x3], 9 SPI bytes (12 with white) per pixel
+    int stride = (wOffset ? 4 : 3) * SPI_BITS_FACTOR;
+    for (int i = 0; i < count; i++, pos += stride) {
+        PixCol pixel = walk.next();
+        encodeByteTo3xBits(pixel.r, pos + rOffset);
+        encodeByteTo3xBits(pixel.g, pos + gOffset);
+        encodeByteTo3xBits(pixel.b, pos + bOffset);
+        if (wOffset) {
+            encodeByteTo3xBits(0, pos + wOffset);
+        }
+    }
+}
+
+/**
+ * Shift of a channel (0 = r, 1 = g, 2 = b) in the word of packPixelWord() for the LED type and color
+ * order: the channel sent first is in the highest bits.
+ */
+inline byte pixelWordShift(byte type, byte order, int channel) {
+    byte last = (type == SK6812W) ? 3 : 2;
+    byte width = (type == WS2816) ? 16 : 8;
+    return (last - ((order >> (2 * channel)) & 3)) * width;
+}
+
+/**
+ * The 48 data bits of a WS2816 as a word sent MSB first, the shifts are from pixelWordShift().
+ */
+inline uint64_t packPixelWord16(PixCol16 pixel, byte rShift, byte gShift, byte bShift) {
+    return (uint64_t)pixel.r << rShift | (uint64_t)pixel.g << gShift | (uint64_t)pixel.b << bShift;
+}
+
+/**
+ * The data bits of one single-wire LED as a word sent MSB first (the Photon 1 bit-bangs it bit by
+ * bit): 24 bits for WS2812B, 32 for SK6812W (white 0), 48 for WS2816 with each channel expanded by
+ * the gamma table. The shifts are from pixelWordShift().
+ */
+inline uint64_t packPixelWord(PixCol pixel, byte rShift, byte gShift, byte bShift, const PixGamma16* gamma16) {
+    if (gamma16) return packPixelWord16(gamma16->expand(pixel), rShift, gShift, bShift);
+    return (uint32_t)pixel.r << rShift | (uint32_t)pixel.g << gShift | (uint32_t)pixel.b << bShift;
+}
+
+/**
+ * Bytes of zeros sent after the LED data of a clocked strip.
+ *
+ * Each LED delays the data by half a clock, so the last LEDs need count/2 extra clock edges to
+ * receive theirs; SK9822 also needs a 32-bit zero frame to latch. 4 + count/16 bytes covers
+ * APA102, SK9822 and HD107S.
+ */
+constexpr size_t clockedEndBytes(int count) {
+    return CLOCKED_START_BYTES + (count + 15) / 16;
+}
+
+/**
+ * Encodes count pixels for a clocked strip starting at pos: per LED 0b111 + 5-bit brightness,
+ * then the three colors at their byte offsets (1-3, from the color order).
+ */
+inline void encodeClockedPixels(uint8_t* pos, PixOutputWalk& walk, int count,
+                                uint8_t rOffset, uint8_t gOffset, uint8_t bOffset, uint8_t brightness) {
+    uint8_t header = 0xE0 | (brightness & CLOCKED_MAX_BRIGHTNESS);
+    for (int i = 0; i < count; i++, pos += CLOCKED_BYTES_PER_LED) {
+        PixCol pixel = walk.next();
+        pos[0] = header;
+        pos[rOffset] = pixel.r;
+        pos[gOffset] = pixel.g;
+        pos[bOffset] = pixel.b;
+    }
+}
+
+/**
+ * Encodes count pixels into SPI bit patterns for a WS2816 (16 bits per channel) starting at pos,
+ * from the walk's 16-bit frame or each channel expanded by the gamma table, high byte first. The
+ * offsets are in SPI bytes (6 per channel, from the color order).
+ */
+inline void encodeSpiPixels16(uint8_t* pos, PixOutputWalk& walk, int count,
+                              uint8_t rOffset, uint8_t gOffset, uint8_t bOffset, const PixGamma16& gamma) {
+    for (int i = 0; i < count; i++, pos += WS2816_BYTES_PER_LED * SPI_BITS_FACTOR) {
+        PixCol16 pixel = walk.next16(gamma);
+        uint16_t r = pixel.r, g = pixel.g, b = pixel.b;
+        encodeByteTo3xBits(r >> 8, pos + rOffset);
+        encodeByteTo3xBits(r, pos + rOffset + SPI_BITS_FACTOR);
+        encodeByteTo3xBits(g >> 8, pos + gOffset);
+        encodeByteTo3xBits(g, pos + gOffset + SPI_BITS_FACTOR);
+        encodeByteTo3xBits(b >> 8, pos + bOffset);
+        encodeByteTo3xBits(b, pos + bOffset + SPI_BITS_FACTOR);
+    }
+}
+
+/**
+ * Encodes count pixels for an HD108 strip starting at pos: per LED a header with the start bit and
+ * the brightness as all three 5-bit gains, then the 16-bit channels (from the walk's 16-bit frame or
+ * gamma expanded) at their byte offsets (2, 4 or 6, from the color order), all big endian.
+ */
+inline void encodeHd108Pixels(uint8_t* pos, PixOutputWalk& walk, int count,
+                              uint8_t rOffset, uint8_t gOffset, uint8_t bOffset, uint8_t brightness, const PixGamma16& gamma) {
+    uint8_t gain = brightness & CLOCKED_MAX_BRIGHTNESS;
+    uint16_t header = 0x8000 | gain << 10 | gain << 5 | gain;
+    for (int i = 0; i < count; i++, pos += HD108_BYTES_PER_LED) {
+        PixCol16 pixel = walk.next16(gamma);
+        uint16_t r = pixel.r, g = pixel.g, b = pixel.b;
+        pos[0] = header >> 8;
+        pos[1] = header;
+        pos[rOffset] = r >> 8;
+        pos[rOffset + 1] = r;
+        pos[gOffset] = g >> 8;
+        pos[gOffset + 1] = g;
+        pos[bOffset] = b >> 8;
+        pos[bOffset + 1] = b;
+    }
+}
+
+
+/**
+ * @class PixChangeDetector
+ * @brief The change detection of a strip: recognizes a frame identical to the one sent last, so
+ * update() skips encoding and sending it, and when an unchanged frame is due again (keep-alive).
+ *
+ * Frames are compared byte for byte with a copy of the last one sent plus the output offset and
+ * blend, a changed frame is never skipped. The copy (pixelCount colors) is allocated when the
+ * detection is enabled, it is off by default. Settings that change the encoding (mapping,
+ * brightness, gamma, HSV table) invalidate() the last frame so the next one is sent.
+ *
+ * Example Usage:
+ * @code
+ * strip.getChangeDetector().setEnabled(true, 1000, strip.getPixelCount());
+ * @endcode
+ */
+class PixChangeDetector {
+public:
+    PixChangeDetector() { }
+    ~PixChangeDetector() { delete[] sentPixels; }
+
+    PixChangeDetector(const PixChangeDetector&) = delete;
+    PixChangeDetector& operator=(const PixChangeDetector&) = delete;
+
+    // with keepAlive > 0 an unchanged frame is sent again at least every keepAlive ms, false if the copy
+    // of the frame could not be allocated (the detection stays off)
+    bool setEnabled(bool enable, unsigned long keepAlive, int pixelCount) {
+        delete[] sentPixels;
+        sentPixels = nullptr;
+        sentCount = 0;
+        sentValid = false;
+        this->keepAlive = keepAlive;
+        if (!enable || pixelCount <= 0) return !enable;
+        sentPixels = new (std::nothrow) PixCol[pixelCount];
+        if (!sentPixels) {
+            Log.error("Not enough memory available for change detection!");
+            return false;
+        }
+        sentCount = pixelCount;
+        return true;
+    }
+    bool isEnabled() const { return sentPixels != nullptr; }
+
+    // the next frame is sent whatever it is
+    void invalidate() { sentValid = false; }
+
+    // true if source is the frame sent last and the keep-alive isn't due (counted as skipped), otherwise it
+    // is recorded as the frame sent last
+    bool skip(const PixCol* source, int offset, byte blend, bool force) {
+        if (!sentPixels) {
+            sentFrames++;
+            return false;
+        }
+        size_t bytes = sentCount * sizeof(PixCol);
+        if (!force && sentValid && offset == sentOffset && blend == sentBlend && !keepAliveDue() &&
+            memcmp(source, sentPixels, bytes) == 0) {
+            skippedFrames++;
+            return true;
+        }
+        memcpy(sentPixels, source, bytes);
+        sentValid = true;
+        sentOffset = offset;
+        sentBlend = blend;
+        sentMillis = millis();
+        sentFrames++;
+        return false;
+    }
+
+    bool keepAliveDue() const { return keepAlive && sentValid && millis() - sentMillis >= keepAlive; }
+
+    // ms until the keep-alive resend is due, PIXELEDS_IDLE_FOREVER without one
+    system_tick_t getKeepAliveIdle(system_tick_t millis) const {
+        if (!keepAlive || !sentValid) return (system_tick_t) PIXELEDS_IDLE_FOREVER;
+        system_tick_t due = sentMillis + keepAlive;
+        return (int32_t) (due - millis) > 0 ? due - millis : 0;
+    }
+
+    // frames not sent because they were unchanged, frames sent
+    unsigned long getSkippedFrames() const { return skippedFrames; }
+    unsigned long getSentFrames() const { return sentFrames; }
+
+    size_t bytesAllocated() const { return sentCount * sizeof(PixCol); }
+
+private:
+    PixCol* sentPixels = nullptr;
+    int sentCount = 0;
+    unsigned long keepAlive = 0;
+    bool sentValid = false;
+    int sentOffset = 0;
+    byte sentBlend = 0;
+    system_tick_t sentMillis = 0;
+    unsigned long skippedFrames = 0;
+    unsigned long sentFrames = 0;
+};
@@ -0,0 +1,50 @@
+/*
+Copyright 2024 The Brynwood Team, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include "Particle.h"
+#include "pixeleds-library.h"
+#include "pixeleds-host.h"
+#include "pixeleds-photon1.h"
+#include "pixeleds-photon2.h"
+
+
+
+/**
+ * RAM in bytes a Pixeleds of pixelCount pixels needs on this platform, with a heap strip of the LED type and color
+ * order on outputCount LEDs (0 = pixelCount) and paletteColors colors in its palettes. Counts the transition frames
+ * although they are only allocated on the first transition; the frame cache, keyframes and the encode cache are
+ * only known at runtime (see Pixeleds::getFootprint).
+ *
+ * Usable at compile time, e.g. to choose the strip length per device:
+ * @code
+ * static_assert(pixeledsFootprint(600, WS2812B, ORDER_GRB).total() < 40 * 1024, "strip too long for this device");
+ * @endcode
+ */
+constexpr PixFootprint pixeledsFootprint(int pixelCount, byte type = WS2812B, byte order = ORDER_RGB, int outputCount = 0,
+                                         int paletteColors = 0) {
+    return PixFootprint{
+        pixelCount * sizeof(PixCol),
+        2 * pixelCount * sizeof(PixCol),
+        Pixeleds::stateArenaSize(pixelCount),
+        ParticlePixels::encodeBytes(type, order, outputCount > 0 ? outputCount : pixelCount),
+        ParticlePixels::resetBytes(type, outputCount > 0 ? outputCount : pixelCount),
+        paletteColors * sizeof(PixCol),
+        0,
+        sizeof(Pixeleds) + sizeof(ParticlePixels)
+    };
+}
@@ -0,0 +1,235 @@
+/*
+Copyright 2024 The Brynwood Team, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#if PIXELEDS_HOST  // desktop/server build
+#include "pixeleds-golden.h"
+#include "pixeleds-stream.h"
+#include <cstdio>
+#include <cstdlib>
+
+static void putWord(FILE *file, uint16_t value) {
+    fputc(value & 0xFF, file);
+    fputc(value >> 8, file);
+}
+
+static void putLong(FILE *file, uint32_t value) {
+    for (int idx = 0; idx < 4; idx++) { fputc((value >> (idx * 8)) & 0xFF, file); }
+}
+
+static void goldenPath(char *path, size_t size, const char *dir, const char *name) {
+    snprintf(path, size, "%s/%s.pxs", dir, name);
+}
+
+static bool readFile(const char *path, std::vector<uint8_t> &data) {
+    FILE *file = fopen(path, "rb");
+    if (!file) return false;
+    uint8_t buffer[4096];
+    size_t length;
+    while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        data.insert(data.end(), buffer, buffer + length);
+    }
+    fclose(file);
+    return true;
+}
+
+void PixGoldenResult::format(char *text, size_t size) const {
+    if (!found) {
+        snprintf(text, size, "%s: MISSING golden frames", name);
+        return;
+    }
+    int length = snprintf(text, size, "%s: %s %d frames, %lu differing (%lu over tolerance), max %d", name,
+                          passed() ? "ok" : "FAIL", frames, differing, failing, maxDiff);
+    if (failFrame >= 0 && length > 0 && (size_t) length < size) {
+        snprintf(text + length, size - length, ", first frame %d pixel %d golden %02x%02x%02x rendered %02x%02x%02x",
+                 failFrame, failPixel, expected.r, expected.g, expected.b, actual.r, actual.g, actual.b);
+    }
+}
+
+/**
+* Renders the case on its own strip: the random seed is reset, the animation refresh is the frame
+* time and frame n is the output at start + n * frameMillis, so the frames don't depend on when or
+* how fast they are rendered. Change detection is off, every frame is the strip's output frame
+* (mapping and HSV conversion applied).
+*/
+bool PixGolden::render(const PixGoldenCase &test, PixCol *out) {
+    int count = test.pixelCount;
+    if (count <= 0 || !test.animation || !out) return false;
+    std::vector<PixCol> pixels(count);
+    ParticlePixels strip(pixels.data(), count);
+    Pixeleds px(&strip);
+    px.setAnimationRefresh(frameMillis);
+    px.setChangeDetection(false);
+    if (test.hsv) px.setHsvPixels(test.hsv);
+    if (test.layout && !px.setLayout(test.layout)) return false;
+
+    randomSeed(seed);
+    PixAniData *data = px.startAnimation(test.animation, test.palette, test.cycle, -1, test.data);
+    if (!data || !strip.getFrame()) return false;
+    system_tick_t start = data->start;
+    for (int frame = 0; frame < frames; frame++) {
+        px.update(start + frame * frameMillis);
+        memcpy(out + frame * count, strip.getFrame(), count * sizeof(PixCol));
+    }
+    return true;
+}
+
+/**
+* Stores the frames as a PixStream of keyframes, frame n at n * frameMillis.
+*/
+bool PixGolden::record(const PixGoldenCase &test, const char *dir) {
+    int count = test.pixelCount;
+    if (count >= 0x8000) return false;  // a keyframe op covers at most 0x7FFF pixels
+    std::vector<PixCol> rendered(frames * count);
+    if (!render(test, rendered.data())) return false;
+
+    char path[256];
+    goldenPath(path, sizeof(path), dir, test.name);
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        Log.error("Can't write %s", path);
+        return false;
+    }
+    fwrite("PXS", 1, 3, file);
+    fputc(PIXSTREAM_VERSION, file);
+    putWord(file, count);
+    putWord(file, 0);
+    putLong(file, frames);
+    putLong(file, frames * frameMillis);
+
+    uint32_t length = 4 + count * 3;
+    for (int frame = 0; frame < frames; frame++) {
+        putLong(file, frame * frameMillis);
+        fputc(PIXSTREAM_FRAME_KEY, file);
+        for (int idx = 0; idx < 3; idx++) { fputc((length >> (idx * 8)) & 0xFF, file); }
+        putWord(file, 0);
+        putWord(file, count);
+        const PixCol *pixel = &rendered[frame * count];
+        for (int idx = 0; idx < count; idx++, pixel++) {
+            fputc(pixel->r, file);
+            fputc(pixel->g, file);
+            fputc(pixel->b, file);
+        }
+    }
+    bool written = !ferror(file);
+    fclose(file);
+    return written;
+}
+
+/**
+* Renders the case and compares every channel of every frame with the golden stream.
+*/
+PixGoldenResult PixGolden::compare(const PixGoldenCase &test, const char *dir, int tolerance) {
+    PixGoldenResult result;
+    result.name = test.name;
+    int count = test.pixelCount;
+
+    char path[256];
+    goldenPath(path, sizeof(path), dir, test.name);
+    std::vector<uint8_t> data;
+    PixStream stream;
+    if (!readFile(path, data) || !stream.openMemory(data.data(), data.size())
+        || stream.getPixelCount() != count || (int) stream.getFrameCount() < frames) {
+        return result;
+    }
+    std::vector<PixCol> rendered(frames * count);
+    if (!render(test, rendered.data())) return result;
+    result.found = true;
+
+    std::vector<PixCol> expected(count);
+    for (int frame = 0; frame < frames; frame++) {
+        stream.render(expected.data(), count, frame * frameMillis);
+        const PixCol *actual = &rendered[frame * count];
+        for (int pixel = 0; pixel < count; pixel++) {
+            const PixCol &want = expected[pixel];
+            const PixCol &got = actual[pixel];
+            int diffs[3] = { abs(want.r - got.r), abs(want.g - got.g), abs(want.b - got.b) };
+            for (int diff : diffs) {
+                if (!diff) continue;
+                result.differing++;
+                if (diff > result.maxDiff) result.maxDiff = diff;
+                if (diff <= tolerance) continue;
+                if (!result.failing++) {
+                    result.failFrame = frame;
+                    result.failPixel = pixel;
+                    result.expected = want;
+                    result.actual = got;
+                }
+            }
+        }
+        result.frames++;
+    }
+    return result;
+}
+
+/*
+ * encoders
+ */
+
+int PixGolden::spiBytesPerLED(byte type, byte order) {
+    if (type == WS2816) return WS2816_BYTES_PER_LED * SPI_BITS_FACTOR;
+    return ((order >> 6 & 0b11) ? 4 : 3) * SPI_BITS_FACTOR;
+}
+
+/**
+* Encodes the frame like a Photon 2 ParticlePixels of the type and order (the LED data without the
+* reset periods), false for the clocked types.
+*/
+bool PixGolden::encodeSpi(const PixCol *frame, int count, byte type, byte order, uint8_t *spi) {
+    PixOutputWalk walk(frame, count, OUTPUT_DIRECT);
+    if (type == WS2816) {
+        encodeSpiPixels16(spi, walk, count, 2 * SPI_BITS_FACTOR * (order & 0b11), 2 * SPI_BITS_FACTOR * (order >> 2 & 0b11),
+                          2 * SPI_BITS_FACTOR * (order >> 4 & 0b11), PixGamma16::standard());
+        return true;
+    }
+    if (type == WS2812B || type == SK6812W) {
+        encodeSpiPixelsAt(spi, walk, count, SPI_BITS_FACTOR * (order & 0b11), SPI_BITS_FACTOR * (order >> 2 & 0b11),
+                          SPI_BITS_FACTOR * (order >> 4 & 0b11), SPI_BITS_FACTOR * (order >> 6 & 0b11));
+        return true;
+    }
+    return false;
+}
+
+/**
+* Decodes the Photon 2 SPI patterns of each LED back to data bits ('110' = 1, '100' = 0, anything else
+* is a mismatch) and compares them with the word the Photon 1 sends for the LED, MSB first.
+*/
+int PixGolden::compareEncoders(const PixCol *frame, int count, byte type, byte order) {
+    int size = spiBytesPerLED(type, order);
+    std::vector<uint8_t> spi(count * size);
+    if (!encodeSpi(frame, count, type, order, spi.data())) return PIXGOLDEN_UNCHECKED;
+
+    const PixGamma16 *gamma16 = (type == WS2816) ? &PixGamma16::standard() : nullptr;
+    byte rShift = pixelWordShift(type, order, 0);
+    byte gShift = pixelWordShift(type, order, 1);
+    byte bShift = pixelWordShift(type, order, 2);
+    int bits = size * 8 / SPI_BITS_FACTOR;
+    for (int led = 0; led < count; led++) {
+        uint64_t word = packPixelWord(frame[led], rShift, gShift, bShift, gamma16);
+        const uint8_t *pattern = &spi[led * size];
+        for (int bit = 0; bit < bits; bit++) {
+            int first = bit * SPI_BITS_FACTOR;
+            int spiBits = 0;
+            for (int idx = first; idx < first + SPI_BITS_FACTOR; idx++) {
+                spiBits = spiBits << 1 | (pattern[idx / 8] >> (7 - idx % 8) & 1);
+            }
+            bool expected = word >> (bits - 1 - bit) & 1;
+            if (spiBits != (expected ? 0b110 : 0b100)) return led;
+        }
+    }
+    return -1;
+}
+
+#endif
@@ -0,0 +1,146 @@
+/*
+Copyright 2024 The Brynwood Team, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+#if PIXELEDS_HOST  // golden frames are recorded and checked on a host build (see pixeleds-host.h)
+
+#include "Particle.h"
+#include "pixeleds-library.h"
+#include "pixeleds-encode.h"
+#include "pixeleds-host.h"
+#include <vector>
+
+#define PIXGOLDEN_FRAMES 100         // frames rendered per case
+#define PIXGOLDEN_FRAME_MILLIS 20    // time between the frames
+#define PIXGOLDEN_SEED 1             // randomSeed() before each case, for sparkle, strobe and random
+#define PIXGOLDEN_UNCHECKED -2       // compareEncoders() has no Photon 2 SPI encoder to check for the type
+
+
+/**
+ * @struct PixGoldenCase
+ * @brief An animation rendered by PixGolden, its golden frames are stored in <dir>/<name>.pxs.
+ */
+struct PixGoldenCase {
+    const char* name;
+    PixAniFunc* animation;
+    PixPal* palette;
+    long cycle;
+    intptr_t data;
+    int pixelCount;
+    const PixHsvTable* hsv;    // nullptr for RGB pixels, see Pixeleds::setHsvPixels
+    PixLayout* layout;         // nullptr for a plain strip, see Pixeleds::setLayout (the 2D animations need one)
+};
+
+
+/**
+ * @struct PixGoldenResult
+ * @brief The comparison of a case with its golden frames.
+ */
+struct PixGoldenResult {
+    const char* name = nullptr;
+    bool found = false;              // the golden file was read and matches the case's pixel count
+    int frames = 0;                  // frames compared
+    unsigned long differing = 0;     // channel values that differ at all
+    unsigned long failing = 0;       // channel values that differ by more than the tolerance
+    int maxDiff = 0;                 // largest difference of a channel value
+    int failFrame = -1;              // first failing frame and pixel, with the golden and the rendered color
+    int failPixel = -1;
+    PixCol expected;
+    PixCol actual;
+
+    bool passed() const { return found && failing == 0; }
+
+    // one line report, e.g. "comet: FAIL 100 frames, 12 differing (3 over tolerance), max 9, first frame 4 pixel 17 ..."
+    void format(char* text, size_t size) const;
+};
+
+
+/**
+ * @class PixGolden
+ * @brief Replays animations deterministically and compares them with golden frames, for proving that a
+ * rewrite (fixed point, lookup tables, SIMD) of the color math, the wave functions or the animations
+ * didn't change the output.
+ *
+ * Each case runs on its own Pixeleds with a fixed random seed, and is updated at fixed times from its
+ * start, so the frames only depend on the code. record() stores them as a PixStream of keyframes (they
+ * can be played on a strip with animation_stream), compare() renders them again and compares every
+ * channel with the stored frames within a tolerance. Record before the change, compare after.
+ *
+ * compareEncoders() checks that the Photon 2 SPI encoders put the same data bits on the wire as the
+ * Photon 1 bit-bang loop for a frame, and that FixedParticlePixels encodes like ParticlePixels.
+ *
+ * @note random() must follow randomSeed() in the host Particle.h for sparkle, strobe and random to replay.
+ *
+ * Example Usage:
+ * @code
+ * PixGoldenCase comet = {"comet", &animation_comet, &Color::BLUES, 2000, 0, 60, nullptr, nullptr};
+ * PixGolden golden;
+ * golden.record(comet, "golden");                 // before the change
+ * PixGoldenResult result = golden.compare(comet, "golden", 1);   // after, within 1 per channel
+ * @endcode
+ */
+class PixGolden {
+public:
+    PixGolden(int frames = PIXGOLDEN_FRAMES, int frameMillis = PIXGOLDEN_FRAME_MILLIS, uint32_t seed = PIXGOLDEN_SEED)
+        : frames(frames), frameMillis(frameMillis), seed(seed) { }
+
+    // render the frames of the case into frames (getFrames() x pixelCount pixels)
+    bool render(const PixGoldenCase& test, PixCol* frames);
+
+    // render the case and store it as <dir>/<name>.pxs
+    bool record(const PixGoldenCase& test, const char* dir);
+
+    // render the case and compare it with <dir>/<name>.pxs, channels may differ by up to tolerance
+    PixGoldenResult compare(const PixGoldenCase& test, const char* dir, int tolerance = 0);
+
+    int getFrames() const { return frames; }
+    int getFrameMillis() const { return frameMillis; }
+
+    // LED of the frame where the Photon 1 and Photon 2 data bits first differ for the type (WS2812B, SK6812W
+    // or WS2816) and color order, -1 if they are the same, PIXGOLDEN_UNCHECKED for other types (the clocked
+    // types share their encoder)
+    static int compareEncoders(const PixCol* frame, int count, byte type, byte order);
+
+    // LED where FixedParticlePixels<TYPE, ORDER> first encodes differently from ParticlePixels, -1 if it doesn't,
+    // PIXGOLDEN_UNCHECKED for a type compareEncoders() doesn't check
+    template <byte TYPE, byte ORDER>
+    static int compareFixedEncoder(const PixCol* frame, int count);
+
+private:
+    static bool encodeSpi(const PixCol* frame, int count, byte type, byte order, uint8_t* spi);
+    static int spiBytesPerLED(byte type, byte order);
+
+    int frames;
+    int frameMillis;
+    uint32_t seed;
+};
+
+
+template <byte TYPE, byte ORDER>
+int PixGolden::compareFixedEncoder(const PixCol* frame, int count) {
+    typedef PixLedFormat<TYPE, ORDER> Format;
+    int size = Format::bytesPerLED * SPI_BITS_FACTOR;
+    std::vector<uint8_t> fixed(count * size), runtime(count * size);
+    PixOutputWalk walk(frame, count, OUTPUT_DIRECT);
+    encodeSpiPixels<Format>(fixed.data(), walk, count);
+    if (!encodeSpi(frame, count, TYPE, ORDER, runtime.data())) return PIXGOLDEN_UNCHECKED;
+    for (int led = 0; led < count; led++) {
+        if (memcmp(&fixed[led * size], &runtime[led * size], size)) return led;
+    }
+    return -1;
+}
+
+#endif
@@ -0,0 +1,257 @@
+/*
+Copyright 2024 The Brynwood Team, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#if PIXELEDS_HOST  // desktop/server build
+#include "pixeleds-host.h"
+#include "pixeleds-library.h"
+#include <new>
+
+// cache line aligned memory of whole cache lines, zeroed, nullptr if there is not enough memory
+static byte* allocateLines(size_t bytes) {
+    bytes = PIXELEDS_CACHE_ALIGN(bytes);
+    byte* memory = static_cast<byte*>(operator new(bytes, std::align_val_t(PIXELEDS_CACHE_LINE), std::nothrow));
+    if (memory) memset(memory, 0, bytes);
+    return memory;
+}
+
+static void freeLines(void* memory) {
+    operator delete(memory, std::align_val_t(PIXELEDS_CACHE_LINE));
+}
+
+/*
+ * ParticlePixels
+ */
+
+ParticlePixels::~ParticlePixels() {
+    freeLines(frame);
+}
+
+/**
+* Allocates the output frame for outputCount LEDs.
+*
+* @return false (and logs an error) if there is not enough memory
+*/
+bool ParticlePixels::allocateFrame() {
+    freeLines(frame);
+    frame = reinterpret_cast<PixCol*>(allocateLines(outputCount * sizeof(PixCol)));
+    frameReady = false;
+    if (frame == nullptr) {
+        Log.error("Not enough memory available!");
+        return false;
+    }
+    return true;
+}
+
+bool ParticlePixels::setOutputMapping(byte mapping, int outputCount) {
+    this->mapping = mapping;
+    this->outputCount = outputCount > 0 ? outputCount : PixOutputWalk::defaultOutputCount(mapping, pixelCount);
+    changes.invalidate();
+    triggerRefresh();
+    return allocateFrame();
+}
+
+/**
+* Renders the pixels into the output frame if they changed, like the device encoders but without
+* sending anything; flush() passes the frame on. Safe to call for different strips on different threads.
+*/
+void ParticlePixels::update(bool forceRefresh) {
+    if (!pixels || !frame) return;
+
+    const PixCol* source = pixels;
+    int sourceOffset = offset;
+    byte sourceBlend = offsetBlend;
+    bool pending = false;
+    if (exchange) {
+        if (refresh) pending = !exchange->publish(pixels, offset, offsetBlend);
+        if (!exchange->acquire() && !forceRefresh && !changes.keepAliveDue()) {
+            refresh = pending;
+            return;
+        }
+        source = exchange->front();
+        sourceOffset = exchange->frontOffset();
+        sourceBlend = exchange->frontOffsetBlend();
+    }
+    else if (!refresh && !forceRefresh && !changes.keepAliveDue()) return;
+
+    if (changes.skip(source, sourceOffset, sourceBlend, forceRefresh)) {
+        refresh = pending;
+        return;
+    }
+
+    PixOutputWalk walk(source, pixelCount, mapping, sourceOffset, sourceBlend, hsvTable);
+    for (int i = 0; i < outputCount; i++) {
+        frame[i] = walk.next();
+    }
+    frameReady = true;
+    refresh = pending;
+}
+
+bool ParticlePixels::flush() {
+    if (!frameReady) return false;
+    frameReady = false;
+    if (output) output(frame, outputCount, outputContext);
+    return true;
+}
+
+/*
+ * PixSegmentRenderer
+ */
+
+/**
+ * The memory of a segment in one cache line aligned block: [pixels][transition frames][state arena],
+ * each part starting on its own cache line. A base class of the segment so it is ready before Pixeleds.
+ */
+struct PixSegmentMemory {
+    byte* block;
+    PixCol* pixels;
+    PixCol* transitionPixels;
+    byte* stateArena;
+    ParticlePixels strip;
+
+    static size_t pixelBytes(int pixelCount) { return PIXELEDS_CACHE_ALIGN(pixelCount * sizeof(PixCol)); }
+
+    PixSegmentMemory(int pixelCount, byte type, byte order)
+        : block(allocateLines(3 * pixelBytes(pixelCount) + Pixeleds::stateArenaSize(pixelCount))),
+          pixels(reinterpret_cast<PixCol*>(block)),
+          transitionPixels(reinterpret_cast<PixCol*>(block + pixelBytes(pixelCount))),
+          stateArena(block + 3 * pixelBytes(pixelCount)),
+          strip(pixels, pixelCount, 0, type, order) { }
+
+    ~PixSegmentMemory() { freeLines(block); }
+};
+
+// aligned so the animation data of neighbouring segments doesn't share a cache line either
+struct alignas(PIXELEDS_CACHE_LINE) PixSegmentRenderer::Segment : private PixSegmentMemory, public Pixeleds {
+    Segment(int pixelCount, byte type, byte order)
+        : PixSegmentMemory(pixelCount, type, order),
+          Pixeleds(&this->PixSegmentMemory::strip, this->PixSegmentMemory::stateArena, this->PixSegmentMemory::transitionPixels) { }
+
+    bool isAllocated() const { return block != nullptr; }
+    ParticlePixels* getStrip() { return &this->PixSegmentMemory::strip; }
+};
+
+PixSegmentRenderer::PixSegmentRenderer(int threads) {
+    if (threads <= 0) threads = (int) std::thread::hardware_concurrency();
+    threadCount = threads > 0 ? threads : 1;
+    queues = new Queue[threadCount];
+    for (int i = 1; i < threadCount; i++) {
+        workers.emplace_back(&PixSegmentRenderer::worker, this, i);
+    }
+}
+
+PixSegmentRenderer::~PixSegmentRenderer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& thread : workers) thread.join();
+    delete[] queues;
+    for (Segment* segment : segments) delete segment;
+}
+
+Pixeleds* PixSegmentRenderer::addSegment(int pixelCount, PixHostOutput* output, void* context, byte type, byte order) {
+    if (pixelCount <= 0) return nullptr;
+    Segment* segment = new (std::nothrow) Segment(pixelCount, type, order);
+    if (!segment || !segment->isAllocated()) {
+        Log.error("Not enough memory available!");
+        delete segment;
+        return nullptr;
+    }
+    segment->getStrip()->setOutput(output, context);
+    segments.push_back(segment);
+    return segment;
+}
+
+Pixeleds* PixSegmentRenderer::getSegment(int index) const {
+    return (index >= 0 && index < (int) segments.size()) ? segments[index] : nullptr;
+}
+
+ParticlePixels* PixSegmentRenderer::getStrip(int index) const {
+    return (index >= 0 && index < (int) segments.size()) ? segments[index]->getStrip() : nullptr;
+}
+
+/**
+* Renders one frame of all segments on the pool and outputs the new frames in segment order.
+*
+* Each thread gets a contiguous range of segments (neighbouring segments stay on one core from frame
+* to frame), the calling thread takes the first range. Returns after the outputs were called.
+*/
+void PixSegmentRenderer::render(system_tick_t millis) {
+    int count = (int) segments.size();
+    for (int i = 0; i < threadCount; i++) {
+        queues[i].next.store(count * i / threadCount, std::memory_order_relaxed);
+        queues[i].end = count * (i + 1) / threadCount;
+    }
+    frameMillis = millis;
+
+    if (threadCount > 1) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running = threadCount - 1;
+            generation++;
+        }
+        wake.notify_all();
+    }
+    work(0);
+    if (threadCount > 1) {
+        // barrier: every segment is rendered once all workers are done
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return running == 0; });
+    }
+
+    for (Segment* segment : segments) {
+        segment->getStrip()->flush();
+    }
+}
+
+void PixSegmentRenderer::worker(int index) {
+    unsigned long seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this, seen] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+        work(index);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--running == 0) done.notify_one();
+        }
+    }
+}
+
+/**
+* Renders the thread's own range, then steals from the other ranges until none is left.
+*/
+void PixSegmentRenderer::work(int index) {
+    int segment;
+    while ((segment = queues[index].next.fetch_add(1, std::memory_order_relaxed)) < queues[index].end) {
+        segments[segment]->update(frameMillis);
+    }
+    unsigned long stolen = 0;
+    for (int i = 1; i < threadCount; i++) {
+        Queue& queue = queues[(index + i) % threadCount];
+        while ((segment = queue.next.fetch_add(1, std::memory_order_relaxed)) < queue.end) {
+            segments[segment]->update(frameMillis);
+            stolen++;
+        }
+    }
+    if (stolen) steals.fetch_add(stolen, std::memory_order_relaxed);
+}
+
+#endif
@@ -0,0 +1,258 @@
+/*
+Copyright 2024 The Brynwood Team, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+#if PIXELEDS_HOST  // desktop/server build (simulators, LED controllers on a PC), not a Particle device
+
+#include "Particle.h"
+#include "pixeleds-library.h"
+#include "pixeleds-encode.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// per-strip buffers and per-worker counters are aligned to this so threads never share a cache line
+#ifndef PIXELEDS_CACHE_LINE
+#define PIXELEDS_CACHE_LINE 64
+#endif
+
+// round bytes up to whole cache lines
+#define PIXELEDS_CACHE_ALIGN(bytes) (((bytes) + PIXELEDS_CACHE_LINE - 1) / PIXELEDS_CACHE_LINE * PIXELEDS_CACHE_LINE)
+
+
+// called with a finished frame of outputCount RGB pixels in strip order (mapping, offset and HSV applied)
+typedef void (PixHostOutput)(const PixCol* frame, int outputCount, void* context);
+
+
+/**
+ * @class ParticlePixels
+ * @brief A strip on a host build: update() renders the output frame into memory, flush() hands it to a callback.
+ *
+ * @param pixels Pointer to an array of PixCol objects representing the colors of the LEDs.
+ * @param pixelCount The number of LEDs in the strip.
+ * @param pixelPin Not used on the host, kept so the Pixeleds constructors work unchanged.
+ * @param type The type of LED strip, passed on for the output (see getType).
+ * @param order The color order of the LEDs, passed on for the output (see getOrder).
+ *
+ * The frame is made with the same PixOutputWalk as the device encoders (tiled, mirrored, reversed, offset and
+ * HSV), but kept as RGB pixels; the output (a simulator window, a network or USB LED controller) packs it into
+ * its own format. Rendering and output are separate so many strips can be rendered in parallel and output
+ * in order (see PixSegmentRenderer).
+ */
+class ParticlePixels {
+public:
+    ParticlePixels(PixCol* pixels, int pixelCount, byte pixelPin = 0, byte type = WS2812B, byte order = ORDER_RGB)
+        : pixels(pixels), pixelCount(pixelCount), mapping(OUTPUT_DIRECT), outputCount(pixelCount), offset(0), offsetBlend(0),
+          refresh(true), type(type), order(order) {
+        allocateFrame();
+    }
+
+    ~ParticlePixels();
+
+    // bytes of the output frame for outputCount LEDs, there is no reset padding (see pixeledsFootprint)
+    static constexpr size_t encodeBytes(byte type, byte order, int outputCount) {
+        return PIXELEDS_CACHE_ALIGN(outputCount * sizeof(PixCol));
+    }
+    static constexpr size_t resetBytes(byte type, int outputCount) { return 0; }
+    static constexpr bool isSupported(byte type) { return true; }
+
+    void setup() { }
+    void update(bool forceRefresh = false);
+    inline void triggerRefresh() { refresh = true; }
+
+    // PIXELEDS_OK, or PIXELEDS_NO_MEMORY if the output frame could not be allocated
+    int getStatus() { return frame ? PIXELEDS_OK : PIXELEDS_NO_MEMORY; }
+    size_t getEncodeBytes() { return frame ? encodeBytes(type, order, outputCount) : 0; }
+    size_t getResetBytes() { return 0; }
+    bool isRefreshPending() { return refresh || changes.keepAliveDue(); }
+    bool hasFrameExchange() { return exchange != nullptr; }
+
+    // hand the frame rendered by update() to the output, false if there is no new frame
+    bool flush();
+    bool isFrameReady() { return frameReady; }
+    const PixCol* getFrame() { return frame; }
+
+    // called by flush() with each new frame, context is passed through
+    void setOutput(PixHostOutput* output, void* context = nullptr) {
+        this->output = output;
+        outputContext = context;
+    }
+    byte getType() { return type; }
+    byte getOrder() { return order; }
+
+    // skips frames identical to the one sent last when enabled, off by default
+    PixChangeDetector& getChangeDetector() { return changes; }
+
+    int getPixelCount() { return pixelCount; }
+    PixCol* getPixels() { return pixels; }
+
+    // render from a different buffer of pixelCount pixels (e.g. a transition frame)
+    void setPixels(PixCol* pixels) {
+        this->pixels = pixels;
+        triggerRefresh();
+    }
+
+    // emit the pixels tiled, mirrored or reversed (OUTPUT_*) on a strip of outputCount pixels
+    bool setOutputMapping(byte mapping, int outputCount = 0);
+    int getOutputCount() { return outputCount; }
+
+    // the host renders 8-bit frames, there is no 16-bit output (see Pixeleds::setPixels16())
+    bool setPixels16(const PixCol16* pixels16) { return !pixels16; }
+    const PixGamma16* getGamma16() const { return nullptr; }
+
+    // the pixels are PixHsv converted with the table while rendering, nullptr for RGB pixels (must outlive the strip)
+    void setHsvTable(const PixHsvTable* table) {
+        hsvTable = table;
+        changes.invalidate();
+        triggerRefresh();
+    }
+    const PixHsvTable* getHsvTable() const { return hsvTable; }
+
+    // render the latest frame published to the exchange, frames set here are published to it
+    void setFrameExchange(PixFrameExchange* exchange) {
+        this->exchange = exchange;
+        triggerRefresh();
+    }
+
+    void setOffset(int offset, byte blend = 0) {
+        if (offset == this->offset && blend == offsetBlend) return;
+        this->offset = offset;
+        this->offsetBlend = blend;
+        triggerRefresh();
+    }
+
+    void setPixelColor(int pixel, PixCol pixelColor) {
+        if (pixel >= pixelCount) return;
+        pixels[pixel] = pixelColor;
+        triggerRefresh();
+    };
+    void setPixelColor(int pixel, byte r, byte g, byte b) {
+        if (pixel >= pixelCount) return;
+        pixels[pixel] = PixCol(r, g, b);
+        triggerRefresh();
+    };
+
+private:
+    bool allocateFrame();
+
+    PixCol* pixels;
+    int pixelCount;
+    byte mapping;
+    int outputCount;
+    int offset;
+    byte offsetBlend;
+    PixFrameExchange* exchange = nullptr;
+    const PixHsvTable* hsvTable = nullptr;
+
+    // determines if update() should refresh the pixels
+    bool refresh;
+
+    // change detection (see getChangeDetector)
+    PixChangeDetector changes;
+
+    // LED type and color order for the output
+    byte type;
+    byte order;
+
+    // output frame of outputCount pixels, cache line aligned and padded so strips rendered
+    // on different threads never write to the same line
+    PixCol* frame = nullptr;
+    bool frameReady = false;
+    PixHostOutput* output = nullptr;
+    void* outputContext = nullptr;
+};
+
+
+/**
+ * @class PixSegmentRenderer
+ * @brief Renders many independent segments (strips or parts of a long installation) on a pool of threads.
+ *
+ * Each segment is a Pixeleds with its own strip, pixels, transition frames and animation state, all in cache
+ * line aligned memory. render() updates every segment for the same time: the segments are split into a
+ * contiguous range per thread, a thread that is done with its range steals the remaining segments of the
+ * others, so a few expensive animations don't leave the other cores idle. When all segments are rendered
+ * (the barrier) the new frames are handed to the outputs one after the other in segment order, on the
+ * calling thread.
+ *
+ * Segments don't share state, each animation runs on one thread per frame. The calling thread renders as
+ * well, threads = 1 renders everything on it without a pool.
+ *
+ * Example Usage:
+ * @code
+ * PixSegmentRenderer renderer;                   // one thread per core
+ * for (int i = 0; i < 64; i++) {
+ *     Pixeleds *px = renderer.addSegment(150, sendSegment, &controllers[i]);
+ *     px->startAnimation(&animation_gradient, &Color::RAINBOW, 2000 + i * 50);
+ * }
+ * while (running) renderer.render(millis());
+ * @endcode
+ */
+class PixSegmentRenderer {
+public:
+    // threads including the calling one, 0 for one per core
+    PixSegmentRenderer(int threads = 0);
+    ~PixSegmentRenderer();
+
+    PixSegmentRenderer(const PixSegmentRenderer&) = delete;
+    PixSegmentRenderer& operator=(const PixSegmentRenderer&) = delete;
+
+    // add a segment of pixelCount pixels, its frames are passed to output (nullptr to read them with getStrip());
+    // don't add segments while render() runs
+    Pixeleds* addSegment(int pixelCount, PixHostOutput* output = nullptr, void* context = nullptr,
+                         byte type = WS2812B, byte order = ORDER_RGB);
+
+    int getSegmentCount() const { return (int) segments.size(); }
+    Pixeleds* getSegment(int index) const;
+    ParticlePixels* getStrip(int index) const;
+
+    // update all segments for the given time on the pool, then output the new frames in segment order
+    void render(system_tick_t millis);
+
+    int getThreadCount() const { return threadCount; }
+    // segments rendered by a thread other than the one they were assigned to, since construction
+    unsigned long getSteals() const { return steals.load(std::memory_order_relaxed); }
+
+private:
+    struct Segment;
+
+    // a thread's range of segments, next is taken with fetch_add by the owner and by thieves
+    struct alignas(PIXELEDS_CACHE_LINE) Queue {
+        std::atomic<int> next{0};
+        int end = 0;
+    };
+
+    void worker(int index);
+    void work(int index);
+
+    std::vector<Segment*> segments;
+    int threadCount;
+    Queue* queues;
+    std::vector<std::thread> workers;
+    system_tick_t frameMillis = 0;
+    std::atomic<unsigned long> steals{0};
+
+    // frame start and barrier
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    unsigned long generation = 0;
+    int running = 0;
+    bool stopping = false;
+};
+
+#endif
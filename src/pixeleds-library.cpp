@@ -16,9 +16,12 @@ limitations under the License.
 
 #include "pixeleds-library.h"
 #include <cmath>
+#include <new>
 
 // Include platform-specific implementations
-#if (PLATFORM_ID == 6) || (PLATFORM_ID == 8) || (PLATFORM_ID == 10) || (PLATFORM_ID == 88)  // photon, p1, electron, readbear-duo
+#if PIXELEDS_HOST  // desktop/server build, frames are rendered into memory (see PixSegmentRenderer)
+    #include "pixeleds-host.h"
+#elif (PLATFORM_ID == 6) || (PLATFORM_ID == 8) || (PLATFORM_ID == 10) || (PLATFORM_ID == 88)  // photon, p1, electron, readbear-duo
     #include "pixeleds-photon1.h"
 #elif (HAL_PLATFORM_NRF52840)  // tracker, argon, boron, zenon, b-som, b5-som, e-somx
     #error "Platform not supported"
@@ -28,22 +31,50 @@ limitations under the License.
 #else
     #error "Platform not supported"
 #endif
+#include "pixeleds-footprint.h"
+
+
+// holds the Pixeleds lock for a scope
+class PixelsGuard {
+public:
+    PixelsGuard(Pixeleds &pixeleds) : pixeleds(pixeleds) { pixeleds.lock(); }
+    ~PixelsGuard() { pixeleds.unlock(); }
+private:
+    Pixeleds &pixeleds;
+};
+
+
+// ms from millis until due, 0 if it is due or past
+static system_tick_t untilDue(system_tick_t due, system_tick_t millis) {
+    return (int32_t) (due - millis) > 0 ? due - millis : 0;
+}
 
 
 /*
  * constructors/destructors
  */
 
+// the strip of an owning Pixeleds, nullptr if it can't be allocated (see getStatus())
+static ParticlePixels* newStrip(PixCol* pixels, int pixelCount, byte pixelPin, byte type, byte order) {
+    ParticlePixels *strip = new (std::nothrow) ParticlePixels(pixels, pixelCount, pixelPin, type, order);
+    if (!strip) Log.error("Not enough memory available for the strip!");
+    return strip;
+}
+
 Pixeleds::Pixeleds(PixCol* pixels, int pixelCount, byte pixelPin, byte type, byte order) {
-    pixelStrip = new ParticlePixels(pixels, pixelCount, pixelPin, type, order);
+    pixelStrip = newStrip(pixels, pixelCount, pixelPin, type, order);
     ownPixelStrip = true;
     initializeAnimation(pixels, pixelCount);
 }
 
 Pixeleds::Pixeleds(int pixelCount, byte pixelPin, byte type, byte order) {
-    PixCol *pixels = new PixCol[pixelCount];
+    PixCol *pixels = new (std::nothrow) PixCol[pixelCount];
+    if (!pixels) {
+        Log.error("Not enough memory available for pixels!");
+        pixelCount = 0;  // an empty strip, see getStatus()
+    }
     ownPixels = true;
-    pixelStrip = new ParticlePixels(pixels, pixelCount, pixelPin, type, order);
+    pixelStrip = newStrip(pixels, pixelCount, pixelPin, type, order);
     ownPixelStrip = true;
     initializeAnimation(pixels, pixelCount);
 } 
@@ -52,21 +83,85 @@ Pixeleds::Pixeleds(ParticlePixels* pixelStrip) : pixelStrip(pixelStrip) {
     initializeAnimation(pixelStrip->getPixels(), pixelStrip->getPixelCount());
 }
 
+Pixeleds::Pixeleds(ParticlePixels* pixelStrip, byte* stateMemory, PixCol* transitionMemory) : pixelStrip(pixelStrip) {
+    ownBuffers = false;
+    transitionPixels = transitionMemory;
+    initializeAnimation(pixelStrip->getPixels(), pixelStrip->getPixelCount(), stateMemory);
+}
+
 Pixeleds::~Pixeleds() { 
+    stopThread();
+#if !PIXELEDS_HOST
+    if (mutex) os_mutex_recursive_destroy(mutex);
+#endif
     if (ownPixels) delete[] animationData.pixels; 
+    delete[] animationData.pixels16;
     if (ownPixelStrip) delete pixelStrip; 
+    if (ownBuffers) {
+        delete[] transitionPixels;
+        delete[] stateArena;
+    }
+    delete[] keyframePixels;
 }
 
 /*
  * public api
  */
 
-void Pixeleds::setup() {
-    pixelStrip->setup();
+int Pixeleds::setup() {
+    if (pixelStrip) pixelStrip->setup();
+    return getStatus();
+}
+
+int Pixeleds::getStatus() const {
+    if (!pixelStrip) return PIXELEDS_NO_MEMORY;
+    int status = pixelStrip->getStatus();
+    if (status != PIXELEDS_OK) return status;
+    return (animationData.pixels && stateArena) ? PIXELEDS_OK : PIXELEDS_NO_MEMORY;
+}
+
+// bytes of palette colors on the heap, wrapped palettes reference the application's colors
+static size_t paletteBytes(const PixPal *palette) {
+    return (palette && palette->owned) ? palette->count * sizeof(PixCol) : 0;
+}
+
+PixFootprint Pixeleds::getFootprint() const {
+    size_t frameBytes = animationData.pixelCount * sizeof(PixCol);
+    PixFootprint footprint = {};
+    footprint.pixels = frameBytes + (animationData.pixels16 ? animationData.pixelCount * sizeof(PixCol16) : 0);
+    footprint.transition = transitionPixels ? 2 * frameBytes : 0;
+    footprint.state = stateArena ? 2 * stateSlotSize : 0;
+    footprint.encode = pixelStrip ? pixelStrip->getEncodeBytes() : 0;
+    footprint.resetPadding = pixelStrip ? pixelStrip->getResetBytes() : 0;
+    footprint.palettes = paletteBytes(animationData.palette);
+    if (outgoingFunction && outgoingData.palette != animationData.palette) {
+        footprint.palettes += paletteBytes(outgoingData.palette);
+    }
+    footprint.caches = frameCache.bytesAllocated() + (keyframePixels ? 2 * frameBytes : 0) +
+                       (pixelStrip ? pixelStrip->getChangeDetector().bytesAllocated() : 0);
+    footprint.objects = sizeof(Pixeleds) + (pixelStrip ? sizeof(ParticlePixels) : 0);
+    return footprint;
+}
+
+int Pixeleds::checkMemory(int pixelCount, byte type, byte order, int outputCount, int paletteColors) {
+    if (!ParticlePixels::isSupported(type)) return PIXELEDS_UNSUPPORTED;
+#if !PIXELEDS_HOST
+    // free heap in total, the largest block can be smaller when the heap is fragmented
+    if (pixeledsFootprint(pixelCount, type, order, outputCount, paletteColors).total() > (size_t) System.freeMemory()) {
+        return PIXELEDS_NO_MEMORY;
+    }
+#endif
+    return PIXELEDS_OK;
 }
 
 void Pixeleds::update(system_tick_t millis) {
+    if (getStatus() != PIXELEDS_OK) return;  // nothing to show, see getStatus()
+    PixelsGuard guard(*this);
+    updateSequence(millis);
+    system_tick_t fired = animationData.updated;
+    unsigned long wait = fireWait(animationData);
     updateAnimation(millis);
+    if (animationData.updated != fired) recordFrame(wait);
     pixelStrip->update();
 }
 
@@ -75,100 +170,958 @@ void Pixeleds::setPixel(int pixel, byte r, byte g, byte b) {
 }
 
 void Pixeleds::setPixel(int pixel, PixCol color) {
-    animationFunction = nullptr;
+    PixelsGuard guard(*this);
+    if (getStatus() != PIXELEDS_OK) return;
+    stopForPixels();
     pixelStrip->setPixelColor(pixel, color);
+    setPixel16(pixel, color);
 }
 
 void Pixeleds::setPixels(PixCol color) {
-    animationFunction = nullptr;
-    for (int idx = 0; idx < animationData.pixelCount; idx++) { pixelStrip->setPixelColor(idx, color); }
+    PixelsGuard guard(*this);
+    if (getStatus() != PIXELEDS_OK) return;
+    stopForPixels();
+    for (int idx = 0; idx < animationData.pixelCount; idx++) {
+        pixelStrip->setPixelColor(idx, color);
+        setPixel16(idx, color);
+    }
 }
 
 void Pixeleds::setPixels(PixPal *palette) {
-    animationFunction = nullptr;
-    for (int idx = 0; idx < animationData.pixelCount; idx++) { pixelStrip->setPixelColor(idx, palette->determineColorAt(idx)); }
+    PixelsGuard guard(*this);
+    if (getStatus() != PIXELEDS_OK) return;
+    stopForPixels();
+    for (int idx = 0; idx < animationData.pixelCount; idx++) {
+        PixCol color = palette->determineColorAt(idx);
+        pixelStrip->setPixelColor(idx, color);
+        setPixel16(idx, color);
+    }
 }
 
 void Pixeleds::updatePixel(int pixel, PixCol color) {
+    PixelsGuard guard(*this);
+    if (getStatus() != PIXELEDS_OK) return;
     pixelStrip->setPixelColor(pixel, color);
+    setPixel16(pixel, color);
     pixelStrip->update(true);
 }
 
 void Pixeleds::updatePixels(PixCol color) {
-    for (int idx = 0; idx < animationData.pixelCount; idx++) { pixelStrip->setPixelColor(idx, color); }
+    PixelsGuard guard(*this);
+    if (getStatus() != PIXELEDS_OK) return;
+    for (int idx = 0; idx < animationData.pixelCount; idx++) {
+        pixelStrip->setPixelColor(idx, color);
+        setPixel16(idx, color);
+    }
     pixelStrip->update(true);
 }
 
+PixCol* Pixeleds::getPixels() const {
+    return animationData.pixels;
+}
+
+int Pixeleds::getPixelCount() const {
+    return animationData.pixelCount;
+}
+
+void Pixeleds::setHsvPixels(const PixHsvTable *table) {
+    PixelsGuard guard(*this);
+    if (getStatus() != PIXELEDS_OK) return;
+    pixelStrip->setHsvTable(table);
+}
+
+PixHsv* Pixeleds::getHsvPixels() const {
+    return (PixHsv*) animationData.pixels;
+}
+
+bool Pixeleds::setPixels16(bool enable) {
+    PixelsGuard guard(*this);
+    if (getStatus() != PIXELEDS_OK) return false;
+    if (!enable) {
+        pixelStrip->setPixels16(nullptr);
+        delete[] animationData.pixels16;
+        animationData.pixels16 = nullptr;
+        return true;
+    }
+    if (animationData.pixels16) return true;
+    const PixGamma16 *gamma = pixelStrip->getGamma16();
+    if (!gamma || pixelStrip->getHsvTable() || pixelStrip->hasFrameExchange()) {
+        Log.error("16-bit pixels need a WS2816 or HD108 strip without HSV pixels or a frame exchange");
+        return false;
+    }
+    PixCol16 *pixels16 = new (std::nothrow) PixCol16[animationData.pixelCount];
+    if (!pixels16) {
+        Log.error("Not enough memory available for 16-bit pixels!");
+        return false;
+    }
+    // starts with the frame shown now, the 16-bit frame is shown as it is rendered
+    endTransition();
+    endKeyframes();
+    frameCache.clear();
+    for (int idx = 0; idx < animationData.pixelCount; idx++) { pixels16[idx] = gamma->expand(animationData.pixels[idx]); }
+    animationData.pixels16 = pixels16;
+    pixelStrip->setPixels16(pixels16);
+    return true;
+}
+
+PixCol16* Pixeleds::getPixels16() const {
+    return animationData.pixels16;
+}
+
+void Pixeleds::showPixels() {
+    PixelsGuard guard(*this);
+    if (getStatus() != PIXELEDS_OK) return;
+    stopForPixels();
+    pixelStrip->triggerRefresh();
+}
+
 PixAniData* Pixeleds::startAnimation(PixAniFunc *animation, PixPal *palette,
-                                     long cycle, long duration, int data) {
+                                     long cycle, long duration, intptr_t data,
+                                     long transition, byte transitionType) {
+    PixelsGuard guard(*this);
+    if (getStatus() != PIXELEDS_OK) return nullptr;
+    stopSequence();
+    return beginAnimation(animation, palette, cycle, duration, data, transition, transitionType, millis());
+}
+
+void Pixeleds::startSequence(const PixSeqStep *steps, int stepCount, bool loop) {
+    PixelsGuard guard(*this);
+    if (!steps || stepCount <= 0 || getStatus() != PIXELEDS_OK) return;
+    sequenceSteps = steps;
+    sequenceCount = stepCount;
+    sequenceIndex = 0;
+    sequenceLoop = loop;
+    system_tick_t start = millis();
+    const PixSeqStep &step = steps[0];
+    sequenceSwitch = start + (step.duration > 0 ? step.duration : 1);
+    beginAnimation(step.animation, step.palette, step.cycle, -1, step.data, step.transition, step.transitionType, start);
+}
+
+void Pixeleds::stopSequence() {
+    PixelsGuard guard(*this);
+    sequenceSteps = nullptr;
+}
+
+bool Pixeleds::isSequenceActive() const {
+    return sequenceSteps != nullptr;
+}
+
+int Pixeleds::getSequenceStep() const {
+    return sequenceIndex;
+}
+
+system_tick_t Pixeleds::getSequenceSwitch() const {
+    return sequenceSwitch;
+}
+
+void Pixeleds::setAnimationRefresh(int refresh) {
+    PixelsGuard guard(*this);
+    animationRefresh = refresh;
+}
+
+bool Pixeleds::setKeyframeRefresh(int keyframeMillis) {
+    PixelsGuard guard(*this);
+    endKeyframes();
+    keyframeRefresh = max(keyframeMillis, 0);
+    if (keyframeRefresh && !keyframePixels) {
+        keyframePixels = new (std::nothrow) PixCol[animationData.pixelCount * 2];
+        if (!keyframePixels) {
+            Log.error("Not enough memory available for keyframes!");
+            keyframeRefresh = 0;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Pixeleds::setFrameCache(size_t maxBytes) {
+    PixelsGuard guard(*this);
+    frameCache.clear();
+    return frameCache.allocate(maxBytes);
+}
+
+void Pixeleds::setFrameCache(uint8_t *memory, size_t size) {
+    PixelsGuard guard(*this);
+    frameCache.clear();
+    frameCache.use(memory, size);
+}
+
+unsigned long Pixeleds::getFrameCacheHits() const {
+    return frameCache.hits;
+}
+
+unsigned long Pixeleds::getFrameCacheMisses() const {
+    return frameCache.misses;
+}
+
+size_t Pixeleds::getFrameCacheBytes() const {
+    return frameCache.bytesUsed();
+}
+
+bool Pixeleds::setChangeDetection(bool enable, unsigned long keepAlive) {
+    PixelsGuard guard(*this);
+    if (!pixelStrip) return false;
+    return pixelStrip->getChangeDetector().setEnabled(enable, keepAlive, pixelStrip->getPixelCount());
+}
+
+unsigned long Pixeleds::getSkippedFrames() const {
+    if (!pixelStrip) return 0;
+    return pixelStrip->getChangeDetector().getSkippedFrames();
+}
+
+unsigned long Pixeleds::getSentFrames() const {
+    if (!pixelStrip) return 0;
+    return pixelStrip->getChangeDetector().getSentFrames();
+}
+
+bool Pixeleds::setOutputMapping(byte mapping, int outputCount) {
+    PixelsGuard guard(*this);
+    if (!pixelStrip) return false;
+    return pixelStrip->setOutputMapping(mapping, outputCount);
+}
+
+bool Pixeleds::setLayout(PixLayout *layout) {
+    PixelsGuard guard(*this);
+    if (layout) {
+        if (!layout->indexes) {
+            Log.error("Layout has no index table");
+            return false;
+        }
+        for (int idx = 0; idx < layout->count(); idx++) {
+            if (layout->indexes[idx] >= animationData.pixelCount) {
+                Log.error("Layout index %d is outside of %d pixels", layout->indexes[idx], animationData.pixelCount);
+                return false;
+            }
+        }
+    }
+    animationData.layout = layout;
+    return true;
+}
+
+bool Pixeleds::setFrameExchange(PixFrameExchange *exchange) {
+    PixelsGuard guard(*this);
+    if (!pixelStrip) return false;
+    if (exchange && animationData.pixels16) {
+        Log.error("Frame exchange frames are 8-bit, turn off the 16-bit pixels first");
+        return false;
+    }
+    if (exchange && exchange->getPixelCount() != animationData.pixelCount) {
+        Log.error("Frame exchange has %d pixels, strip has %d", exchange->getPixelCount(), animationData.pixelCount);
+        return false;
+    }
+    pixelStrip->setFrameExchange(exchange);
+    return true;
+}
+
+#if PIXELEDS_HOST
+// priority and stack size are left to the OS
+bool Pixeleds::startThread(__unused os_thread_prio_t priority, __unused size_t stackSize) {
+    if (threadRunning) return true;
+    threadRunning = true;
+    thread = std::thread(renderThread, this);
+    return true;
+}
+
+void Pixeleds::stopThread() {
+    if (!threadRunning) return;
+    threadRunning = false;
+    thread.join();
+}
+
+void Pixeleds::lock() {
+    mutex.lock();
+}
+
+void Pixeleds::unlock() {
+    mutex.unlock();
+}
+#else
+bool Pixeleds::startThread(os_thread_prio_t priority, size_t stackSize) {
+    if (threadRunning) return true;
+    if (!mutex) {
+        Log.error("No render thread lock");
+        return false;
+    }
+    threadRunning = true;
+    if (os_thread_create(&thread, "pixeleds", priority, renderThread, this, stackSize) != 0) {
+        threadRunning = false;
+        Log.error("Unable to start the render thread");
+        return false;
+    }
+    return true;
+}
+
+void Pixeleds::stopThread() {
+    if (!threadRunning) return;
+    threadRunning = false;
+    os_thread_join(thread);
+    os_thread_cleanup(thread);
+    thread = nullptr;
+}
+
+void Pixeleds::lock() {
+    if (mutex) os_mutex_recursive_lock(mutex);
+}
+
+void Pixeleds::unlock() {
+    if (mutex) os_mutex_recursive_unlock(mutex);
+}
+#endif
+
+bool Pixeleds::isThreadRunning() const {
+    return threadRunning;
+}
+
+PixFrameStats Pixeleds::getFrameStats() {
+    PixelsGuard guard(*this);
+    PixFrameStats stats = frameStats;
+    stats.period = animationRefresh * 1000UL;
+    return stats;
+}
+
+void Pixeleds::resetFrameStats() {
+    PixelsGuard guard(*this);
+    frameStats = PixFrameStats();
+    lastFrameMicros = 0;
+}
+
+bool Pixeleds::isAnimationActive() const {
+    return (bool) (*animationFunction);
+}
+
+bool Pixeleds::isTransitionActive() const {
+    return transitionDuration > 0;
+}
+
+system_tick_t Pixeleds::getIdleMillis(system_tick_t millis) {
+    PixelsGuard guard(*this);
+    if (getStatus() != PIXELEDS_OK) return (system_tick_t) PIXELEDS_IDLE_FOREVER;
+    if (pixelStrip->isRefreshPending()) return 0;
+    system_tick_t idle = (system_tick_t) PIXELEDS_IDLE_FOREVER;
+    if (animationFunction) idle = min(idle, untilDue(animationData.updated + fireWait(animationData), millis));
+    if (isTransitionActive()) {
+        if (outgoingFunction) idle = min(idle, untilDue(outgoingData.updated + fireWait(outgoingData), millis));
+        idle = min(idle, untilDue(transitionUpdated + animationRefresh + 1, millis));
+        idle = min(idle, untilDue(transitionStart + transitionDuration, millis));
+    }
+    if (isKeyframing() && keyframeValid) {
+        idle = min(idle, untilDue(keyframeUpdated + animationRefresh, millis));
+        idle = min(idle, untilDue(keyframeStart + keyframeRefresh, millis));
+    }
+    if (sequenceSteps) idle = min(idle, untilDue(sequenceSwitch, millis));
+    idle = min(idle, pixelStrip->getChangeDetector().getKeepAliveIdle(millis));
+    if (pixelStrip->hasFrameExchange()) idle = min(idle, (system_tick_t) animationRefresh);  // published at any time
+    return idle;
+}
+
+/*
+ * private helpers
+ */
+
+PixAniData* Pixeleds::beginAnimation(PixAniFunc *animation, PixPal *palette, long cycle, long duration, intptr_t data,
+                                     long transition, byte transitionType, system_tick_t start) {
+    endTransition();
+    endKeyframes();
+    if (transition > 0 && !animationData.pixels16) {
+        // the outgoing animation keeps its state, the new one uses the other slot
+        startTransition(transition, transitionType, start);
+        resetAnimationState(1 - stateSlot);
+    }
+    else {
+        resetAnimationState(stateSlot);
+    }
     animationFunction = (duration != 0) ? animation : nullptr; // duration 0, only fire once (no updates)
     animationData.palette = palette;
     animationData.cycleDuration = cycle > 0 ? cycle : 1; // can't be zero or negative
-    animationData.start = millis();
+    animationData.start = start;
     animationData.stop = animationData.start + duration;
     animationData.data = data;
     animationData.updated = animationData.start;  // detect first fire when these are equal
     animationData.cycleMillis = 0;
     animationData.cycleCount = 0;
     animationData.cyclePct = 0.0;
-    animation(&animationData); // first fire
-    pixelStrip->triggerRefresh();
+    animationData.offset = 0;
+    animationData.offsetBlend = 0;
+    animationData.hold = 0;
+    lastFrameMicros = 0;  // the interval to the first frame isn't a frame interval
+    frameCache.clear();
+    if (frameCache.isEnabled() && animationFunction && isCacheable(animation) && !animationData.pixels16
+            && frameCache.begin(animationData, max(animationRefresh, 1))) {
+        frameCache.record(animation, animationData); // first fire, the first frame of the cycle
+    }
+    else {
+        animation(&animationData); // first fire
+    }
+    if (isTransitionActive()) {
+        blendTransition(0);
+    }
+    else {
+        pixelStrip->setOffset(animationData.offset, animationData.offsetBlend);
+        pixelStrip->triggerRefresh();
+    }
     return &animationData;
 }
 
-void Pixeleds::setAnimationRefresh(int refresh) {
-    animationRefresh = refresh;
+// start the next sequence step(s) that are due, each step starts at its scheduled time
+// the 16-bit pixel of a pixel set directly (see setPixels16())
+void Pixeleds::setPixel16(int pixel, PixCol color) {
+    if (!animationData.pixels16 || pixel < 0 || pixel >= animationData.pixelCount) return;
+    animationData.pixels16[pixel] = pixelStrip->getGamma16()->expand(color);
 }
 
-bool Pixeleds::isAnimationActive() const {
-    return (bool) (*animationFunction);
+// stop the animation for pixels set directly, they are shown and transitioned from without an offset
+void Pixeleds::stopForPixels() {
+    stopSequence();
+    endTransition();
+    endKeyframes();
+    animationFunction = nullptr;
+    animationData.offset = 0;
+    animationData.offsetBlend = 0;
+    pixelStrip->setOffset(0);
 }
 
-/*
- * private helpers
- */
+void Pixeleds::updateSequence(system_tick_t millis) {
+    if (!sequenceSteps || (int32_t) (millis - sequenceSwitch) < 0) return;
+    const PixSeqStep *step;
+    system_tick_t start;
+    do {
+        if (++sequenceIndex >= sequenceCount) {
+            if (!sequenceLoop) {
+                stopSequence();
+                sequenceIndex = sequenceCount - 1;
+                animationFunction = nullptr;  // last step is done
+                return;
+            }
+            sequenceIndex = 0;
+        }
+        step = &sequenceSteps[sequenceIndex];
+        start = sequenceSwitch;
+        sequenceSwitch += (step->duration > 0 ? step->duration : 1);
+    } while ((int32_t) (millis - sequenceSwitch) >= 0);  // skip steps that were missed entirely
+    beginAnimation(step->animation, step->palette, step->cycle, -1, step->data, step->transition, step->transitionType, start);
+}
 
-void Pixeleds::initializeAnimation(PixCol* pixels, int pixelCount) {
+void Pixeleds::initializeAnimation(PixCol* pixels, int pixelCount, byte* stateMemory) {
     animationData.pixels = pixels;
     animationData.pixelCount = pixelCount;
+    // slots stay aligned for any state type
+    stateSlotSize = stateArenaSize(pixelCount) / 2;
+    stateArena = stateMemory ? stateMemory : new (std::nothrow) byte[stateSlotSize * 2];
+    if (!stateArena) {
+        Log.error("Not enough memory available for animation state!");
+    }
+#if !PIXELEDS_HOST
+    // before any thread can see this object, lock() and startThread() only read it
+    if (os_mutex_recursive_create(&mutex) != 0) {
+        mutex = nullptr;
+        Log.error("Unable to create the render thread lock");
+    }
+#endif
     setAnimationRefresh();
 }
 
+// point the animation at a zeroed state slot, its state object is constructed on first use
+void Pixeleds::resetAnimationState(int slot) {
+    stateSlot = slot;
+    animationData.stateCreated = false;
+    if (!stateArena) return;
+    byte *memory = stateArena + slot * stateSlotSize;
+    memset(memory, 0, stateSlotSize);
+    animationData.stateMemory = memory;
+    animationData.pixelStateMemory = memory + PIXELEDS_STATE_SIZE;
+}
+
+// the render thread, wakes up on absolute deadlines one refresh period apart so the frame rate doesn't
+// drift with the time a frame takes (a late frame is followed by the next one straight away)
+#if PIXELEDS_HOST
+void Pixeleds::renderThread(void *param) {
+    Pixeleds *pixeleds = (Pixeleds*) param;
+    std::chrono::steady_clock::time_point wake = std::chrono::steady_clock::now();
+    while (pixeleds->threadRunning) {
+        int refresh;
+        {
+            PixelsGuard guard(*pixeleds);
+            pixeleds->update(millis());
+            refresh = max(pixeleds->animationRefresh, 1);
+        }
+        wake += std::chrono::milliseconds(refresh);
+        std::this_thread::sleep_until(wake);
+    }
+}
+#else
+void Pixeleds::renderThread(void *param) {
+    Pixeleds *pixeleds = (Pixeleds*) param;
+    system_tick_t wake = millis();
+    while (pixeleds->threadRunning) {
+        int refresh;
+        {
+            PixelsGuard guard(*pixeleds);
+            pixeleds->update(millis());
+            refresh = max(pixeleds->animationRefresh, 1);
+        }
+        os_thread_delay_until(&wake, refresh);
+    }
+    os_thread_exit(nullptr);
+}
+#endif
+
+// add the interval since the previous animation frame to the frame stats, wait is the ms it was due after
+void Pixeleds::recordFrame(unsigned long wait) {
+    unsigned long now = micros();
+    if (lastFrameMicros) {
+        unsigned long interval = now - lastFrameMicros;
+        if (!frameStats.intervals || interval < frameStats.minInterval) frameStats.minInterval = interval;
+        if (interval > frameStats.maxInterval) frameStats.maxInterval = interval;
+        frameStats.totalInterval += interval;
+        if (interval > wait * 1000UL + animationRefresh * 500UL) frameStats.late++;
+        frameStats.intervals++;
+    }
+    frameStats.frames++;
+    lastFrameMicros = isAnimationActive() ? now : 0;
+}
+
 void Pixeleds::updateAnimation(system_tick_t millis) {
-    if ((*animationFunction) && (millis > animationData.updated + animationRefresh)) {
+    if (isTransitionActive()) {
+        fireAnimation(outgoingFunction, outgoingData, millis);
+        fireAnimation(animationFunction, animationData, millis);
+        updateTransition(millis);
+    }
+    else if (isKeyframing()) {
+        updateKeyframes(millis);
+    }
+    else if (fireAnimation(animationFunction, animationData, millis)) {
+        pixelStrip->setOffset(animationData.offset, animationData.offsetBlend);
+        pixelStrip->triggerRefresh();
+    }
+}
+
+// ms after its last update the animation is fired again: the refresh period or its hold, not past its stop
+unsigned long Pixeleds::fireWait(const PixAniData &data) const {
+    unsigned long wait = max((unsigned long) animationRefresh, data.hold);
+    if (data.stop > data.start && data.updated + wait > data.stop + 1) {
+        wait = max((unsigned long) animationRefresh, data.stop + 1 - data.updated);
+    }
+    return wait;
+}
+
+// advance the animation's timing and fire it if it is due, returns true if it was fired
+bool Pixeleds::fireAnimation(PixAniFunc *&function, PixAniData &data, system_tick_t millis) {
+    if ((*function) && (millis >= data.updated + fireWait(data))) {
 #ifdef PIXELEDS_SERIAL_DEBUG
         Serial.printlnf("updateAnimation: %ld", millis);
 #endif
-        if (animationData.stop > animationData.start && millis > animationData.stop) {
-            animationFunction = nullptr;
+        if (data.stop > data.start && millis > data.stop) {
+            function = nullptr;
         }
         else {
-            animationData.updated = millis;
-            long millisSinceStart = millis - animationData.start;
-            animationData.cycleMillis = millisSinceStart % animationData.cycleDuration;
-            animationData.cycleCount = millisSinceStart / animationData.cycleDuration;
-            animationData.cyclePct = (float)animationData.cycleMillis / (float)animationData.cycleDuration;
+            data.updated = millis;
+            long millisSinceStart = millis - data.start;
+            data.cycleMillis = millisSinceStart % data.cycleDuration;
+            data.cycleCount = millisSinceStart / data.cycleDuration;
+            data.cyclePct = (float)data.cycleMillis / (float)data.cycleDuration;
 #ifdef PIXELEDS_SERIAL_DEBUG
-            Serial.printlnf("updateAnimation: millis=%d, count=%d, pct=%f", animationData.cycleMillis, animationData.cycleCount, animationData.cyclePct);
+            Serial.printlnf("updateAnimation: millis=%d, count=%d, pct=%f", data.cycleMillis, data.cycleCount, data.cyclePct);
 #endif
-            animationFunction(&animationData);
-            pixelStrip->triggerRefresh();
+            data.hold = 0;
+            if (&data == &animationData && frameCache.isReady()) {
+                frameCache.replay(data);
+            }
+            else if (&data == &animationData && frameCache.isRecording()) {
+                frameCache.misses++;
+                frameCache.record(function, data);
+            }
+            else {
+                if (&data == &animationData && frameCache.isEnabled()) frameCache.misses++;
+                function(&data);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+// animations that aren't a pure function of the cycle position can't be cached
+bool Pixeleds::isCacheable(PixAniFunc *animation) {
+    return animation != &animation_sparkle && animation != &animation_strobe && animation != &animation_random;
+}
+
+// keep the current animation (or static pixels) running into the transition buffer
+void Pixeleds::startTransition(long transition, byte transitionType, system_tick_t start) {
+    int pixelCount = animationData.pixelCount;
+    if (!transitionPixels) {
+        transitionPixels = new (std::nothrow) PixCol[pixelCount * 2];
+        if (!transitionPixels) {
+            Log.error("Not enough memory available for transition!");
+            return;
+        }
+    }
+    memcpy(transitionPixels, animationData.pixels, pixelCount * sizeof(PixCol));
+    outgoingFunction = animationFunction;
+    outgoingData = animationData;
+    outgoingData.pixels = transitionPixels;
+    this->transitionType = transitionType;
+    transitionDuration = transition;
+    transitionStart = start;
+    transitionUpdated = transitionStart;
+    // the strip shows the blended frame until the transition is done
+    pixelStrip->setPixels(transitionPixels + pixelCount);
+    pixelStrip->setOffset(0);
+}
+
+// ends the transition when done, otherwise blends a new transition frame at the animation refresh rate
+void Pixeleds::updateTransition(system_tick_t millis) {
+    unsigned long elapsed = millis - transitionStart;
+    if (elapsed >= transitionDuration) {
+        endTransition();
+    }
+    else if (millis > transitionUpdated + animationRefresh) {
+        transitionUpdated = millis;
+        blendTransition((uint16_t) (elapsed * 256 / transitionDuration));
+    }
+}
+
+// the next pixel of a walk over rendered pixels, HSV pixels stay HSV (the strip converts them)
+static inline PixCol walkPixel(PixOutputWalk &walk, bool hsv) {
+    if (!hsv) return walk.next();
+    PixHsv pixel = walk.nextHsv();
+    return PixCol(pixel.h, pixel.s, pixel.v);
+}
+
+// blend two rendered pixels by alpha (0..256), HSV pixels take the hue the short way around the wheel
+static inline PixCol blendPixel(PixCol from, PixCol to, uint16_t alpha, bool hsv) {
+    if (!hsv) return from.blend(to, alpha);
+    PixHsv pixel = PixHsv(from.r, from.g, from.b).blend(PixHsv(to.r, to.g, to.b), alpha);
+    return PixCol(pixel.h, pixel.s, pixel.v);
+}
+
+// blend the outgoing and new animation into the transition frame, alpha 0..255 (256 is all new)
+void Pixeleds::blendTransition(uint16_t alpha) {
+    int pixelCount = animationData.pixelCount;
+    PixCol *blended = transitionPixels + pixelCount;
+    // read both through their output offsets so scrolling animations keep scrolling
+    PixOutputWalk from(outgoingData.pixels, pixelCount, OUTPUT_DIRECT, outgoingData.offset, outgoingData.offsetBlend);
+    PixOutputWalk to(animationData.pixels, pixelCount, OUTPUT_DIRECT, animationData.offset, animationData.offsetBlend);
+    bool hsv = pixelStrip->getHsvTable() != nullptr;
+    switch (transitionType) {
+        case TRANSITION_WIPE: {
+            int edge = pixelCount * alpha / 256;
+            for (int idx = 0; idx < pixelCount; idx++) {
+                PixCol fromColor = walkPixel(from, hsv), toColor = walkPixel(to, hsv);
+                blended[idx] = (idx < edge) ? toColor : fromColor;
+            }
+        } break;
+        case TRANSITION_DISSOLVE: {
+            for (int idx = 0; idx < pixelCount; idx++) {
+                PixCol fromColor = walkPixel(from, hsv), toColor = walkPixel(to, hsv);
+                byte threshold = (byte) ((idx * 2654435761u) >> 24);  // scatter pixels evenly over 0..255
+                blended[idx] = (threshold < alpha) ? toColor : fromColor;
+            }
+        } break;
+        default: {
+            for (int idx = 0; idx < pixelCount; idx++) {
+                PixCol fromColor = walkPixel(from, hsv);
+                blended[idx] = blendPixel(fromColor, walkPixel(to, hsv), alpha, hsv);
+            }
+        } break;
+    }
+    pixelStrip->triggerRefresh();
+}
+
+// show the new animation's pixels again
+void Pixeleds::endTransition() {
+    if (!isTransitionActive()) return;
+    transitionDuration = 0;
+    outgoingFunction = nullptr;
+    pixelStrip->setPixels(animationData.pixels);
+    pixelStrip->setOffset(animationData.offset, animationData.offsetBlend);
+    pixelStrip->triggerRefresh();
+}
+
+
+// keyframes are rendered live (frame cache replay is cheaper than interpolating), not during transitions
+bool Pixeleds::isKeyframing() const {
+    return keyframeRefresh > animationRefresh && keyframePixels && animationFunction && !animationData.pixels16
+           && !frameCache.isReady() && !frameCache.isRecording();
+}
+
+// at each keyframe the animation renders the frame a keyframe period ahead, in between the shown frame is
+// blended from the previous keyframe towards it at the animation refresh rate
+void Pixeleds::updateKeyframes(system_tick_t millis) {
+    int pixelCount = animationData.pixelCount;
+    bool due = !keyframeValid || millis >= keyframeStart + keyframeRefresh;
+    if (due) {
+        // the keyframe the output reached becomes the previous one (the first one is the animation's current frame)
+        memcpy(keyframePixels, animationData.pixels, pixelCount * sizeof(PixCol));
+        keyframeOffset = animationData.offset;
+        keyframeBlend = animationData.offsetBlend;
+        keyframeStart = keyframeValid ? millis : animationData.updated;
+        if (!keyframeValid) {
+            keyframeValid = true;
+            pixelStrip->setPixels(keyframePixels + pixelCount);
+            pixelStrip->setOffset(0);
+        }
+        // render up to the stop time, the final keyframe is the last frame before stop (at stop the cycle wraps to 0)
+        system_tick_t target = keyframeStart + keyframeRefresh;
+        system_tick_t last = animationData.stop - 1;
+        if (animationData.stop > animationData.start && target > last && keyframeStart < last) {
+            target = last;
+        }
+        fireAnimation(animationFunction, animationData, target);
+        if (!animationFunction) {
+            endKeyframes();
+            return;
+        }
+    }
+    if (due || millis >= keyframeUpdated + animationRefresh) {
+        keyframeUpdated = millis;
+        unsigned long elapsed = millis - keyframeStart;
+        uint16_t alpha = (elapsed >= (unsigned long) keyframeRefresh) ? 256 : elapsed * 256 / keyframeRefresh;
+        // read both through their output offsets so scrolling animations keep scrolling
+        PixCol *blended = keyframePixels + pixelCount;
+        PixOutputWalk from(keyframePixels, pixelCount, OUTPUT_DIRECT, keyframeOffset, keyframeBlend);
+        PixOutputWalk to(animationData.pixels, pixelCount, OUTPUT_DIRECT, animationData.offset, animationData.offsetBlend);
+        bool hsv = pixelStrip->getHsvTable() != nullptr;
+        for (int idx = 0; idx < pixelCount; idx++) {
+            PixCol fromColor = walkPixel(from, hsv);
+            blended[idx] = blendPixel(fromColor, walkPixel(to, hsv), alpha, hsv);
+        }
+        pixelStrip->triggerRefresh();
+    }
+}
+
+// show the animation's pixels again
+void Pixeleds::endKeyframes() {
+    if (!keyframeValid) return;
+    keyframeValid = false;
+    pixelStrip->setPixels(animationData.pixels);
+    pixelStrip->setOffset(animationData.offset, animationData.offsetBlend);
+    pixelStrip->triggerRefresh();
+}
+
+
+/*
+ * frame cache
+ */
+
+PixFrameCache::~PixFrameCache() {
+    if (owned) free(store);
+}
+
+bool PixFrameCache::allocate(size_t size) {
+    if (owned) free(store);
+    store = nullptr;
+    this->size = 0;
+    owned = false;
+    if (size == 0) return true;
+    store = (uint8_t*) malloc(size);
+    if (!store) {
+        Log.error("Not enough memory available for frame cache!");
+        return false;
+    }
+    this->size = size;
+    owned = true;
+    return true;
+}
+
+void PixFrameCache::use(uint8_t *memory, size_t size) {
+    if (owned) free(store);
+    store = memory;
+    this->size = memory ? size : 0;
+    owned = false;
+}
+
+// little endian helpers, the store has no alignment
+static inline void putWord(uint8_t *pos, uint16_t value) { pos[0] = value & 0xFF; pos[1] = value >> 8; }
+static inline uint16_t getWord(const uint8_t *pos) { return pos[0] | (pos[1] << 8); }
+
+bool PixFrameCache::begin(const PixAniData &data, int frameMillis) {
+    clear();
+    int pixelCount = data.pixelCount;
+    size_t frameBytes = pixelCount * sizeof(PixCol);
+    if (!store || pixelCount > 0x7FFF || size <= frameBytes) return false;
+    this->frameMillis = frameMillis;
+    cycleFrames = (data.cycleDuration + frameMillis - 1) / frameMillis;
+    recordedFrames = 0;
+    recording = true;
+    return true;
+}
+
+void PixFrameCache::record(PixAniFunc *animation, PixAniData &data) {
+    int pixelCount = data.pixelCount;
+    size_t frameBytes = pixelCount * sizeof(PixCol);
+    // the end of the store holds the previous frame while recording
+    size_t limit = size - frameBytes;
+    PixCol *previous = (PixCol*) (store + limit);
+
+    // the frames up to the current position, or to the end of the cycle once it wrapped
+    unsigned long cycleMillis = data.cycleMillis, cycleCount = data.cycleCount;
+    float cyclePct = data.cyclePct;
+    int target = cycleCount > 0 ? cycleFrames - 1 : min((int) (cycleMillis / frameMillis), cycleFrames - 1);
+    while (recordedFrames <= target) {
+        int idx = recordedFrames;
+        data.cycleMillis = idx * frameMillis;
+        data.cycleCount = 0;
+        data.cyclePct = (float) data.cycleMillis / (float) data.cycleDuration;
+        animation(&data);
+        size_t length = encodeFrame(used, data.pixels, idx ? previous : nullptr, pixelCount, data);
+        if (length == 0 || used + length > limit) {
+            clear();  // rendered live from here on, the pixels hold the frame just rendered
+            break;
+        }
+        used += length;
+        memcpy(previous, data.pixels, frameBytes);
+        recordedFrames++;
+    }
+    data.cycleMillis = cycleMillis;
+    data.cycleCount = cycleCount;
+    data.cyclePct = cyclePct;
+    data.hold = 0;  // held frames are recorded when they are reached, the replay doesn't hold either
+
+    if (recording && recordedFrames == cycleFrames) {
+        recording = false;
+        frameCount = cycleFrames;
+        currentFrame = frameCount - 1;  // the pixels hold the last frame
+        nextRecord = used;
+        if (cycleCount > 0) replay(data);
+    }
+}
+
+void PixFrameCache::replay(PixAniData &data) {
+    int target = data.cycleMillis / frameMillis;
+    if (target >= frameCount) target = frameCount - 1;
+    if (target < currentFrame || nextRecord >= used) {
+        nextRecord = decodeFrame(0, data);  // start over from the keyframe
+        currentFrame = 0;
+    }
+    while (currentFrame < target) {
+        nextRecord = decodeFrame(nextRecord, data);
+        currentFrame++;
+    }
+    hits++;
+}
+
+// write the ops for the pixels that differ from previous (all pixels if previous is nullptr), returns 0 if it doesn't fit
+size_t PixFrameCache::encodeFrame(size_t pos, const PixCol *current, const PixCol *previous, int pixelCount, const PixAniData &data) {
+    size_t limit = size - pixelCount * sizeof(PixCol);
+    size_t start = pos;
+    if (pos + 3 > limit) return 0;
+    int offset = data.offset % pixelCount;
+    putWord(store + pos, offset < 0 ? offset + pixelCount : offset);
+    store[pos + 2] = data.offsetBlend;
+    pos += 3;
+
+    int idx = 0;
+    while (idx < pixelCount) {
+        int skip = 0;
+        while (previous && idx < pixelCount && current[idx] == previous[idx]) { idx++; skip++; }
+        // changed pixels up to the next two unchanged ones (a shorter gap is cheaper as part of the run)
+        int count = 0;
+        while (idx + count < pixelCount && (!previous || current[idx + count] != previous[idx + count]
+                || (idx + count + 1 < pixelCount && current[idx + count + 1] != previous[idx + count + 1]))) {
+            count++;
+        }
+        bool fill = count > 1;
+        for (int run = 1; fill && run < count; run++) { fill = current[idx + run] == current[idx]; }
+        size_t length = 4 + (fill ? 1 : count) * sizeof(PixCol);
+        if (pos + length > limit) return 0;
+        putWord(store + pos, skip);
+        putWord(store + pos + 2, count | (fill ? 0x8000 : 0));
+        memcpy(store + pos + 4, current + idx, (fill ? 1 : count) * sizeof(PixCol));
+        pos += length;
+        idx += count;
+    }
+    return pos - start;
+}
+
+// apply the record at pos to data.pixels, returns the position of the next record
+size_t PixFrameCache::decodeFrame(size_t pos, PixAniData &data) {
+    data.offset = getWord(store + pos);
+    data.offsetBlend = store[pos + 2];
+    pos += 3;
+    int idx = 0;
+    while (idx < data.pixelCount) {
+        idx += getWord(store + pos);
+        uint16_t count = getWord(store + pos + 2);
+        pos += 4;
+        if (count & 0x8000) {
+            count &= 0x7FFF;
+            PixCol color = *(const PixCol*) (store + pos);
+            for (int end = idx + count; idx < end; idx++) { data.pixels[idx] = color; }
+            pos += sizeof(PixCol);
+        }
+        else {
+            memcpy(data.pixels + idx, store + pos, count * sizeof(PixCol));
+            idx += count;
+            pos += count * sizeof(PixCol);
         }
     }
+    return pos;
 }
 
 
 
+
+/*************************
+ * frame exchange
+ */
+
+PixFrameExchange::PixFrameExchange(int pixelCount) : pixelCount(pixelCount) {
+    // one block so the three frames are allocated (or not) together
+    PixCol *block = new (std::nothrow) PixCol[pixelCount * 3];
+    if (!block) {
+        Log.error("Not enough memory available for frame exchange!");
+        this->pixelCount = 0;
+    }
+    for (int idx = 0; idx < 3; idx++) { frames[idx] = block ? block + idx * pixelCount : nullptr; }
+}
+
+PixFrameExchange::~PixFrameExchange() {
+    delete[] frames[0];
+}
+
+bool PixFrameExchange::publish(const PixCol *pixels, int offset, byte offsetBlend) {
+    PixCol *frame = beginFrame();
+    if (!frame) return false;
+    memcpy(frame, pixels, pixelCount * sizeof(PixCol));
+    endFrame(offset, offsetBlend);
+    return true;
+}
+
+PixCol* PixFrameExchange::beginFrame() {
+    if (!frames[0] || writing.test_and_set(std::memory_order_acquire)) {
+        collisions++;
+        return nullptr;
+    }
+    return frames[backIndex];
+}
+
+void PixFrameExchange::endFrame(int offset, byte offsetBlend) {
+    offsets[backIndex] = offset;
+    blends[backIndex] = offsetBlend;
+    backIndex = middle.exchange(backIndex | FRESH, std::memory_order_acq_rel) & ~FRESH;
+    published++;
+    writing.clear(std::memory_order_release);
+}
+
+bool PixFrameExchange::acquire() {
+    if (!(middle.load(std::memory_order_relaxed) & FRESH)) return false;
+    frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & ~FRESH;
+    acquired++;
+    return true;
+}
+
 /*************************
  * animations
  */
 
 void __unused animation_blink(PixAniData* data) {
     data->setPixels(data->paletteColor(0).scale((data->step(2) + 1) % 2));
+    data->holdSteps(2);
 }
 
 void __unused animation_alternating(PixAniData* data) {
     int step = data->step(2);
+    data->holdSteps(2);
     for (int idx = 0; idx < data->pixelCount; idx++) {
     data->pixels[idx] = data->paletteColor(0).scale((step + idx) % 2);
 }
@@ -189,17 +1142,31 @@ void __unused animation_glow(PixAniData* data) {
 
 void __unused animation_strobe(PixAniData* data) {
     int step = data->step(10);  // 1/10th of the cycle
-    if (step != data->data) {
-        data->data = step;
+    int *lastStep = data->state<int>();
+    if (!lastStep || step != *lastStep || data->firstFire()) {
+        if (lastStep) *lastStep = step;
         data->setPixels(data->randomColor().scale(step==0));
     }
+    data->holdSteps(10);
 }
 
+// data: sparkles per pixel per cycle (default 10), each sparkle fades out by 10% per frame
 void __unused animation_sparkle(PixAniData* data) {
-    if (data->data == 0 && data->start == data->cycleDuration) { data->data = 10; }
-    int step = (int) (data->cycleDuration / data->data);
+    struct Sparkle { byte color; byte level; };
+    Sparkle *sparkles = data->pixelState<Sparkle>();
+    if (!sparkles) return;
+    int rate = data->data > 0 ? data->data : 10;
+    int step = max((int) (data->cycleDuration / rate), 1);
     for (int idx = 0; idx < data->pixelCount; idx++) {
-        data->pixels[idx] = (random(step) == 0) ? data->randomColor() : data->pixelColor(idx).scale(0.90);
+        Sparkle &sparkle = sparkles[idx];
+        if (random(step) == 0) {
+            sparkle.color = random(data->paletteCount());
+            sparkle.level = 255;
+        }
+        else {
+            sparkle.level = sparkle.level * 230 >> 8;
+        }
+        data->pixels[idx] = data->paletteColor(sparkle.color % data->paletteCount()).scale(sparkle.level / 255.0f);
     }
 }
 
@@ -209,12 +1176,20 @@ void __unused animation_fader(PixAniData* data) {
 
 void __unused animation_cycle(PixAniData* data) {
     data->setPixels(data->paletteStepColor());
+    data->holdSteps(data->paletteCount());
 }
 
 void __unused animation_random(PixAniData* data) {
+    struct RandomState { int step; PixCol color; };
+    RandomState *state = data->state<RandomState>();
+    if (!state) return;
     int step = data->paletteStep();
-    data->setPixels((step != data->data) ? data->randomColor() : data->pixelColor(0));
-    data->data = step;
+    if (step != state->step || data->firstFire()) {
+        state->step = step;
+        state->color = data->randomColor();
+    }
+    data->setPixels(state->color);
+    data->holdSteps(data->paletteCount());
 }
 
 void __unused animation_increment(PixAniData* data) {
@@ -265,15 +1240,47 @@ void __unused animation_comet(PixAniData* data) {
 }
 
 void __unused animation_bars(PixAniData* data) {
-    int step = data->pixelStep();
-    for (int idx = 0; idx < data->pixelCount; idx++) {
-        data->pixels[idx] = data->paletteColor((step + idx) * data->paletteCount() / data->pixelCount);
+    if (data->firstFire()) {  // render once, after that only the output offset moves
+        for (int idx = 0; idx < data->pixelCount; idx++) {
+            data->pixels[idx] = data->paletteColor(idx * data->paletteCount() / data->pixelCount);
+        }
     }
+    data->offset = data->pixelStep();
+    data->holdSteps(data->pixelCount);
 }
 
 void __unused animation_gradient(PixAniData* data) {
-    float step = data->pixelStep();
-    for (int idx = 0; idx < data->pixelCount; idx++) {
-       data->pixels[idx] = data->paletteColor((step + idx) * data->paletteCount() / data->pixelCount);
+    if (data->firstFire()) {  // render once, after that only the output offset moves
+        for (int idx = 0; idx < data->pixelCount; idx++) {
+           data->pixels[idx] = data->paletteColor((float) idx * data->paletteCount() / data->pixelCount);
+        }
+    }
+    data->scrollTo(data->step((float) data->pixelCount));
+}
+
+void __unused animation_gradient2d(PixAniData* data) {
+    int width = data->width();
+    int height = data->height();
+    float span = width + height - 1;  // diagonal distance
+    float step = data->step(span);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            data->pixelXY(x, y) = data->paletteColor((step + x + y) * data->paletteCount() / span);
+        }
+    }
+}
+
+void __unused animation_scanner2d(PixAniData* data) {
+    int width = data->width();
+    int height = data->height();
+    float tail = width / 4;
+    float step = data->step(2 * width + ((tail * 4) - 1));
+    PixCol color = data->palettePartialStepColor();
+    for (int x = 0; x < width; x++) {
+        float scale = constrain(-abs((int) (abs((int) (step - width - 2 * tail)) - x - tail)) + tail, 0, 1);
+        PixCol columnColor = color.scale(scale);
+        for (int y = 0; y < height; y++) {
+            data->pixelXY(x, y) = columnColor;
+        }
     }
 }
@@ -17,6 +17,14 @@ limitations under the License.
 
 #include "Particle.h"
 #include <cmath>
+#include <cstddef>
+#include <atomic>
+#include <new>
+#include <type_traits>
+#if PIXELEDS_HOST
+    #include <mutex>
+    #include <thread>
+#endif
 
 #define M_2XPI 2 * M_PI
 
@@ -30,6 +38,18 @@ limitations under the License.
 // #define WS2812B_FAST 0x07  // use ORDER_GRB  // (not supported)
 // #define WS2812B2_FAST 0x07 // use ORDER_GRB  // (not supported)
 
+// clocked (data + clock) types on the SPI MOSI and SCK pins, with a 5-bit global brightness per LED
+#define APA102 0x10        // use ORDER_BGR
+#define SK9822 0x11        // use ORDER_BGR
+#define HD107S 0x12        // use ORDER_BGR
+#define HD108 0x13         // use ORDER_RGB, 16 bits per channel
+#define PIXEL_TYPE_CLOCKED(type) (((type) & 0xF0) == 0x10)
+
+// 16 bits per channel, 8-bit pixels are expanded with a gamma table (see PixGamma16)
+#define WS2816 0x08        // use ORDER_GRB
+#define PIXEL_TYPE_16BIT(type) ((type) == WS2816 || (type) == HD108)
+#define PIXEL_GAMMA_16 2.2f
+
 // (rOffset | rOffset | rOffset | wOffset) each offset is 2 bits, 0-3
 #define ORDER_RGB (0 | (1 << 2) | (2 << 4))  // 0,1,2
 #define ORDER_RBG (0 | (2 << 2) | (1 << 4))  // 0,2,1
@@ -42,6 +62,44 @@ limitations under the License.
 
 #define PIXEL_BYTES_PER_COLOR 3
 
+// matrix layouts for PixLayout, how the strip's pixel index runs across a width x height panel
+#define LAYOUT_ROWS 0                 // row by row, every row left to right
+#define LAYOUT_SERPENTINE 1           // row by row, odd rows right to left
+#define LAYOUT_COLUMNS 2              // column by column, every column top to bottom
+#define LAYOUT_COLUMNS_SERPENTINE 3   // column by column, odd columns bottom to top
+
+// output mappings for setOutputMapping(), how the rendered pixels are emitted on a (longer) physical strip
+#define OUTPUT_DIRECT 0    // as rendered: 0..n-1
+#define OUTPUT_TILE 1      // repeated: 0..n-1, 0..n-1, ...
+#define OUTPUT_MIRROR 2    // mirrored: 0..n-1, n-1..0, 0..n-1, ...
+#define OUTPUT_REVERSE 3   // reversed: n-1..0, n-1..0, ...
+
+// transitions for startAnimation(), how the outgoing animation is replaced by the new one
+#define TRANSITION_CROSSFADE 0   // blend all pixels from the outgoing to the new animation
+#define TRANSITION_WIPE 1        // new animation replaces the outgoing one from the first to the last pixel
+#define TRANSITION_DISSOLVE 2    // new animation replaces the outgoing one pixel by pixel in a scattered order
+
+// hue to color conversions for PixHsvTable
+#define HSV_SPECTRUM 0   // hue spread evenly over red, green and blue (as PixCol::hsv)
+#define HSV_RAINBOW 1    // more of the hue range in orange and yellow, closer to an even perceived rainbow
+
+// state storage of each running animation (see PixAniData::state, PixAniData::pixelState)
+#define PIXELEDS_STATE_SIZE 128       // bytes of typed state
+#define PIXELEDS_PIXEL_STATE_SIZE 2   // bytes of state per pixel
+
+// returned by Pixeleds::getIdleMillis() when nothing is scheduled
+#define PIXELEDS_IDLE_FOREVER 0xFFFFFFFFUL
+
+// status of a strip (ParticlePixels::getStatus) or of Pixeleds (Pixeleds::getStatus, Pixeleds::checkMemory)
+#define PIXELEDS_OK 0
+#define PIXELEDS_NO_MEMORY 1        // a buffer could not be allocated, or the given memory is too small
+#define PIXELEDS_UNSUPPORTED 2      // the LED type is not supported on this platform
+#define PIXELEDS_NO_INTERFACE 3     // the SPI interface of the pin doesn't exist
+
+// render thread defaults (see Pixeleds::startThread)
+#define PIXELEDS_THREAD_PRIORITY (OS_THREAD_PRIORITY_DEFAULT + 1)
+#define PIXELEDS_THREAD_STACK_SIZE 3072
+
 // forward declarations
 class ParticlePixels;
 
@@ -138,6 +196,19 @@ struct PixCol {
                       (byte) (value * (b - color.b) + color.b));
     }
 
+    /**
+     * @brief Integer blend between this color and another
+     * 
+     * @param color Target color to blend towards
+     * @param amount Blend amount (0 = this color, 256 = target color)
+     * @return PixCol The blended color
+     */
+    inline PixCol blend(PixCol color, uint16_t amount) const __attribute__((always_inline)) {
+        return PixCol((byte) (r + (((int) color.r - r) * amount) / 256),
+                      (byte) (g + (((int) color.g - g) * amount) / 256),
+                      (byte) (b + (((int) color.b - b) * amount) / 256));
+    }
+
     /**
      * @brief Scale the brightness of the color
      * 
@@ -310,9 +381,257 @@ struct PixCol {
 };
 
 
+
+/**
+ * @struct PixCol16
+ * @brief An RGB color with 16 bits per channel, as sent to 16-bit LEDs (WS2816, HD108).
+ *
+ * Animations write these into PixAniData::pixels16 when Pixeleds::setPixels16() is on, the
+ * encoders send them as they are (no gamma table is applied). Use PixGamma16::expand() for the
+ * gamma corrected value of an 8-bit color.
+ */
+struct PixCol16 {
+    uint16_t r;
+    uint16_t g;
+    uint16_t b;
+
+    PixCol16() : r(0), g(0), b(0) { }
+    PixCol16(uint16_t r, uint16_t g, uint16_t b) : r(r), g(g), b(b) { }
+
+    bool operator==(const PixCol16& other) const { return r == other.r && g == other.g && b == other.b; }
+    bool operator!=(const PixCol16& other) const { return !(*this == other); }
+
+    /* blend towards the given color by amount (0-256) */
+    inline PixCol16 blend(PixCol16 color, uint16_t amount) const __attribute__((always_inline)) {
+        return PixCol16((uint16_t) (r + (((int32_t) color.r - r) * amount) / 256),
+                        (uint16_t) (g + (((int32_t) color.g - g) * amount) / 256),
+                        (uint16_t) (b + (((int32_t) color.b - b) * amount) / 256));
+    }
+};
+
+
+/**
+ * @class PixGamma16
+ * @brief Lookup table expanding 8-bit channels to gamma corrected 16-bit channels.
+ *
+ * With 16 bits per channel the dim end of the curve keeps distinct steps (at gamma 2.2 an 8-bit
+ * table maps inputs 0-14 to 0, this one only inputs 0 and 1), so gamma correction can be
+ * applied at the LED without banding. Built once (256 powf calls), a lookup per channel while
+ * encoding 8-bit pixels. Those give at most 256 levels per channel, a 16-bit frame (see
+ * Pixeleds::setPixels16()) gives all 65536.
+ */
+class PixGamma16 {
+public:
+    PixGamma16(float gamma = PIXEL_GAMMA_16) { setGamma(gamma); }
+
+    void setGamma(float gamma) {
+        for (int i = 0; i < 256; i++) {
+            table[i] = (uint16_t) lroundf(powf(i / 255.0f, gamma) * 65535.0f);
+        }
+    }
+
+    inline uint16_t operator[](byte value) const __attribute__((always_inline)) { return table[value]; }
+    inline PixCol16 expand(const PixCol& color) const __attribute__((always_inline)) {
+        return PixCol16(table[color.r], table[color.g], table[color.b]);
+    }
+
+    // shared table with the default gamma, used by 16-bit strips unless another one is set
+    static const PixGamma16& standard() {
+        static PixGamma16 gamma;
+        return gamma;
+    }
+
+private:
+    uint16_t table[256];
+};
+
+
+/**
+ * @struct PixHsv
+ * @brief An 8-bit hue, saturation, value pixel, see Pixeleds::setHsvPixels().
+ *
+ * The hue runs 0-255 around the color wheel and wraps, so rotating a hue is a byte add and a
+ * saturation or brightness change is a byte write instead of a float RGB->HSV->RGB round trip.
+ * Same size and layout as PixCol, an HSV frame is kept in the same pixel buffer.
+ */
+struct PixHsv {
+    byte h;
+    byte s;
+    byte v;
+
+    inline PixHsv() : h(0), s(0), v(0) { }
+    inline PixHsv(byte hue, byte sat, byte val) : h(hue), s(sat), v(val) { }
+
+    /* blend towards the given pixel by amount (0-256), the hue the short way around the wheel */
+    inline PixHsv blend(PixHsv other, uint16_t amount) const __attribute__((always_inline)) {
+        return PixHsv((byte) (h + ((int8_t) (byte) (other.h - h) * (int) amount) / 256),
+                      (byte) (s + (((int) other.s - s) * amount) / 256),
+                      (byte) (v + (((int) other.v - v) * amount) / 256));
+    }
+};
+
+static_assert(sizeof(PixHsv) == sizeof(PixCol), "PixHsv must have the layout of PixCol");
+
+
+/**
+ * @class PixHsvTable
+ * @brief Integer HSV to RGB conversion with a 256-entry hue table.
+ *
+ * The table holds the fully saturated, full brightness color of every hue (HSV_SPECTRUM or
+ * HSV_RAINBOW), saturation and value are applied with two integer multiplies per channel. Used
+ * by the strip encoders so an HSV frame is converted once per pixel while it is encoded.
+ */
+class PixHsvTable {
+public:
+    PixHsvTable(byte style = HSV_SPECTRUM) { setStyle(style); }
+
+    void setStyle(byte style) {
+        if (style == HSV_RAINBOW) {
+            // red, orange, yellow, green, aqua, blue, purple, pink, 32 hues apart
+            static const PixCol anchors[9] = { {255, 0, 0}, {171, 85, 0}, {171, 171, 0}, {0, 255, 0}, {0, 171, 85},
+                                               {0, 0, 255}, {85, 0, 171}, {171, 0, 85}, {255, 0, 0} };
+            for (int i = 0; i < 256; i++) {
+                table[i] = anchors[i / 32].blend(anchors[i / 32 + 1], (i % 32) * 8);
+            }
+            return;
+        }
+        for (int i = 0; i < 256; i++) {
+            table[i] = PixCol::hsv(i * 360 / 256, 255, 255);
+        }
+    }
+
+    inline PixCol rgb(PixHsv hsv) const __attribute__((always_inline)) {
+        PixCol color = table[hsv.h];
+        // towards white by the missing saturation, then scaled by value (255 keeps the channel)
+        int white = 255 * (255 - hsv.s) + 255;
+        return PixCol((byte) ((((color.r * hsv.s + white) >> 8) * hsv.v + 255) >> 8),
+                      (byte) ((((color.g * hsv.s + white) >> 8) * hsv.v + 255) >> 8),
+                      (byte) ((((color.b * hsv.s + white) >> 8) * hsv.v + 255) >> 8));
+    }
+
+    // shared HSV_SPECTRUM table
+    static const PixHsvTable& standard() {
+        static PixHsvTable hsv;
+        return hsv;
+    }
+
+private:
+    PixCol table[256];
+};
+
+
+/* FNV-1a hash of the pixel bytes, used to recognize frames that were already encoded/transmitted */
+inline uint32_t pixelHash(const PixCol *pixels, int count, uint32_t hash = 2166136261u) {
+    const byte *data = (const byte*) pixels;
+    for (const byte *end = data + count * sizeof(PixCol); data < end; data++) {
+        hash = (hash ^ *data) * 16777619u;
+    }
+    return hash;
+}
+
+
+/**
+ * @struct PixOutputWalk
+ * @brief Walks the rendered pixels in the order they are emitted on the physical strip.
+ *
+ * Used by the platform encoders to emit the rendered buffer straight from the rendered pixels:
+ * - tiled, mirrored or reversed (see OUTPUT_*) on a longer strip, without an intermediate copy
+ * - as a ring starting at an offset, with an optional sub-pixel blend towards the next pixel,
+ *   so a pattern rendered once can be scrolled by only changing the offset (see PixAniData::scrollTo)
+ * - converted from HSV pixels (see PixHsvTable) as they are emitted, without an RGB frame
+ * - read from a 16-bit frame at the same positions (see wide, next16())
+ *
+ * The walk is made of runs of pixelCount pixels, the only per-pixel work is a pointer step with
+ * a wrap check and a run counter, the direction/start of the next run is only decided at the end
+ * of a run.
+ */
+struct PixOutputWalk {
+    const PixCol* pixels;   // first rendered pixel
+    const PixCol* end;      // one past the last rendered pixel
+    const PixCol* start;    // first pixel of a forward run (pixels + offset)
+    int pixelCount;         // number of rendered pixels (one run)
+    byte mapping;           // OUTPUT_* mapping
+    byte blend;             // sub-pixel blend towards the next pixel (0-255)
+    const PixCol* pos;      // next pixel to emit
+    int dir;                // +1 forward, -1 reverse
+    int runLeft;            // pixels left in the current run
+    const PixHsvTable* hsv; // pixels are PixHsv converted with this table, nullptr for RGB
+    const PixCol16* wide = nullptr; // 16-bit frame of pixelCount pixels read by next16(), nullptr for 8-bit pixels
+
+    PixOutputWalk(const PixCol* pixels, int pixelCount, byte mapping, int offset = 0, byte blend = 0, const PixHsvTable* hsv = nullptr)
+            : pixels(pixels), end(pixels + pixelCount), pixelCount(pixelCount), mapping(mapping), blend(blend), hsv(hsv) {
+        offset %= pixelCount;
+        start = pixels + (offset < 0 ? offset + pixelCount : offset);
+        dir = (mapping == OUTPUT_REVERSE) ? -1 : 1;
+        pos = runStart();
+        runLeft = pixelCount;
+    }
+
+    /* return the next pixel to emit */
+    inline PixCol next() __attribute__((always_inline)) {
+        const PixCol* current = step();
+        if (!blend) return rgb(current);
+        // HSV neighbours are blended as RGB, blending the bytes would sweep the hues in between
+        return rgb(current).blend(rgb(following(current)), blend);
+    }
+
+    /* return the next HSV pixel unconverted, a sub-pixel blend takes the hue the short way (see PixHsv::blend) */
+    inline PixHsv nextHsv() __attribute__((always_inline)) {
+        const PixCol* current = step();
+        PixHsv pixel(current->r, current->g, current->b);
+        if (!blend) return pixel;
+        const PixCol* other = following(current);
+        return pixel.blend(PixHsv(other->r, other->g, other->b), blend);
+    }
+
+    /* return the next pixel with 16 bits per channel: from the 16-bit frame if there is one, else expanded by the gamma table */
+    inline PixCol16 next16(const PixGamma16& gamma) __attribute__((always_inline)) {
+        if (!wide) return gamma.expand(next());
+        const PixCol* current = step();
+        const PixCol16* pixel = wide + (current - pixels);
+        if (!blend) return *pixel;
+        return pixel->blend(wide[following(current) - pixels], blend);
+    }
+
+    /* the pixel as RGB */
+    inline PixCol rgb(const PixCol* pixel) const __attribute__((always_inline)) {
+        return hsv ? hsv->rgb(PixHsv(pixel->r, pixel->g, pixel->b)) : *pixel;
+    }
+
+    /* the pixel after the given one in the ring */
+    inline const PixCol* following(const PixCol* pixel) const { return pixel + 1 == end ? pixels : pixel + 1; }
+
+    /* advance to the next pixel, returns the current one */
+    inline const PixCol* step() __attribute__((always_inline)) {
+        const PixCol* current = pos;
+        if (--runLeft) {
+            if (dir > 0) { if (++pos == end) pos = pixels; }
+            else { pos = (pos == pixels ? end : pos) - 1; }
+        }
+        else { nextRun(); }
+        return current;
+    }
+
+    /* number of pixels emitted for the mapping when no output count is given */
+    static int defaultOutputCount(byte mapping, int pixelCount) {
+        return (mapping == OUTPUT_TILE || mapping == OUTPUT_MIRROR) ? pixelCount * 2 : pixelCount;
+    }
+
+    /* first pixel of a run in the current direction (a reverse run starts at the pixel before start) */
+    const PixCol* runStart() const { return (dir > 0) ? start : (start == pixels ? end : start) - 1; }
+
+    void nextRun() {
+        runLeft = pixelCount;
+        if (mapping == OUTPUT_MIRROR) { dir = -dir; }  // stay on the end pixel and turn around
+        else { pos = runStart(); }
+    }
+};
+
+
 struct PixPal {
     byte count;
     PixCol* colors;
+    bool owned = true;   // false if colors is referenced (see wrap), it isn't copied or freed
 
     // Default constructor
     PixPal() : count(0), colors(nullptr) {}
@@ -325,8 +644,12 @@ struct PixPal {
         }
     }
 
-    // Copy constructor
-    PixPal(const PixPal& other) : count(other.count) {
+    // Copy constructor (a copy of a wrapped palette references the same colors)
+    PixPal(const PixPal& other) : count(other.count), owned(other.owned) {
+        if (!owned) {
+            colors = other.colors;
+            return;
+        }
         colors = new PixCol[count];
         for(byte i = 0; i < count; i++) {
             colors[i] = other.colors[i];
@@ -336,8 +659,13 @@ struct PixPal {
     // Assignment operator
     PixPal& operator=(const PixPal& other) {
         if (this != &other) {
-            delete[] colors;
+            if (owned) delete[] colors;
             count = other.count;
+            owned = other.owned;
+            if (!owned) {
+                colors = other.colors;
+                return *this;
+            }
             colors = new PixCol[count];
             for(byte i = 0; i < count; i++) {
                 colors[i] = other.colors[i];
@@ -348,7 +676,7 @@ struct PixPal {
 
     // Destructor
     ~PixPal() {
-        delete[] colors;
+        if (owned) delete[] colors;
     }
 
     // Static creator method
@@ -357,6 +685,16 @@ struct PixPal {
         return PixPal(N, cols);
     }
 
+    // Static creator method referencing the colors without copying them (no heap), they must outlive the palette
+    template<size_t N>
+    static PixPal wrap(PixCol (&cols)[N]) {
+        PixPal palette;
+        palette.count = N;
+        palette.colors = cols;
+        palette.owned = false;
+        return palette;
+    }
+
     PixCol determineColorAt(int index) const {
         return colors[index % count];
     }
@@ -374,6 +712,101 @@ struct PixPal {
 };
 
 
+/**
+ * @struct PixLayout
+ * @brief Maps x,y positions on a 2D panel to pixel indexes of the strip.
+ *
+ * The x,y to index table is computed once when the layout is created so animations can address
+ * a matrix with a single table lookup per pixel (no per-pixel branching on the wiring pattern and
+ * no separate remap pass before output).
+ *
+ * Example Usage:
+ * @code
+ * PixLayout panel(16, 8, LAYOUT_SERPENTINE);   // 16x8 panel wired in a zig-zag
+ * px.setLayout(&panel);
+ * px.startAnimation(&animation_scanner2d, &Color::RAINBOW, 2000);
+ *
+ * // arbitrary wiring, table[y * width + x] is the strip index of x,y (referenced, not copied)
+ * const uint16_t ringTable[] = { ... };
+ * PixLayout rings(8, 4, ringTable);
+ * @endcode
+ */
+struct PixLayout {
+    uint16_t width;
+    uint16_t height;
+    const uint16_t* indexes;  // strip index for each x,y stored at [y * width + x], nullptr if it couldn't be allocated
+    bool owned = true;        // false if indexes is the caller's table (see the table constructor), it isn't copied or freed
+
+    // Default constructor
+    PixLayout() : width(0), height(0), indexes(nullptr) {}
+
+    // Constructor for one of the LAYOUT_* wiring patterns
+    PixLayout(uint16_t w, uint16_t h, byte layout = LAYOUT_ROWS) : width(w), height(h) {
+        uint16_t* table = allocate();
+        if (!table) return;
+        for (uint16_t y = 0; y < h; y++) {
+            for (uint16_t x = 0; x < w; x++) {
+                uint16_t index;
+                switch (layout) {
+                    case LAYOUT_SERPENTINE:         index = y * w + ((y & 1) ? w - 1 - x : x); break;
+                    case LAYOUT_COLUMNS:            index = x * h + y; break;
+                    case LAYOUT_COLUMNS_SERPENTINE: index = x * h + ((x & 1) ? h - 1 - y : y); break;
+                    default:                        index = y * w + x; break;
+                }
+                table[y * w + x] = index;
+            }
+        }
+    }
+
+    // Constructor referencing a table of strip indexes (table[y * width + x]) without copying it (no heap),
+    // e.g. a const array in flash; it must outlive the layout
+    PixLayout(uint16_t w, uint16_t h, const uint16_t* table) : width(w), height(h), indexes(table), owned(false) {}
+
+    // Copy constructor (a copy of a layout on the caller's table references the same table)
+    PixLayout(const PixLayout& other) : width(other.width), height(other.height), indexes(nullptr), owned(other.owned) {
+        copy(other);
+    }
+
+    // Assignment operator
+    PixLayout& operator=(const PixLayout& other) {
+        if (this != &other) {
+            if (owned) delete[] indexes;
+            width = other.width;
+            height = other.height;
+            owned = other.owned;
+            copy(other);
+        }
+        return *this;
+    }
+
+    // Destructor
+    ~PixLayout() {
+        if (owned) delete[] indexes;
+    }
+
+    /* number of positions in the layout (width * height) */
+    inline int count() const { return width * height; }
+
+    /* strip index of the pixel at x,y (no bounds checking) */
+    inline int index(int x, int y) const { return indexes[y * width + x]; }
+
+private:
+    // an owned table of width * height indexes, nullptr (and indexes) if it can't be allocated
+    uint16_t* allocate() {
+        uint16_t* table = new (std::nothrow) uint16_t[width * height];
+        indexes = table;
+        return table;
+    }
+
+    void copy(const PixLayout& other) {
+        indexes = other.indexes;
+        if (!owned || !other.indexes) return;
+        uint16_t* table = allocate();
+        if (table) memcpy(table, other.indexes, width * height * sizeof(uint16_t));
+    }
+};
+
+
 
 /**
  * @struct PixAniData
@@ -386,7 +819,9 @@ struct PixPal {
  * - Initialization:
  *   - int pixelCount: Number of pixels.
  *   - PixCol *pixels: Array of pixel data to manipulate.
+ *   - PixCol16 *pixels16: The 16-bit frame sent instead of pixels (see Pixeleds::setPixels16()), nullptr when off.
  *   - PixPal *palette: Color palette to work with.
+ *   - PixLayout *layout: Optional 2D layout of the pixels (nullptr for a plain strip).
  *   - long cycleDuration: Total duration of one cycle in milliseconds.
  *   - long start: Time (in milliseconds) the animation started.
  *   - long stop: Time (in milliseconds) the animation will stop.
@@ -395,13 +830,22 @@ struct PixPal {
  *   - long cycleMillis: Milliseconds into the current cycle.
  *   - long cycleCount: Number of cycles performed.
  *   - float cyclePct: Percentage of the way through the current cycle.
- *   - int data: Data to pass to the animation function.
+ *   - intptr_t data: Data to pass to the animation function (an int, or a pointer cast to intptr_t).
+ * - State of the running animation, reset when it is started (see state(), pixelState()):
+ *   - byte *stateMemory: PIXELEDS_STATE_SIZE bytes for a typed state object.
+ *   - byte *pixelStateMemory: PIXELEDS_PIXEL_STATE_SIZE bytes per pixel.
+ *   - int offset: Ring offset the output starts at, lets a pattern rendered once be scrolled.
+ *   - byte offsetBlend: Sub-pixel blend towards the next pixel at the offset (0-255).
+ * - Set by the animation each fire (see holdSteps()):
+ *   - unsigned long hold: Milliseconds the frame stays unchanged, the animation isn't fired again before then.
  */
 struct PixAniData {
     // set in initialization:
     int pixelCount;                 // number of pixels
     PixCol *pixels;                 // array of pixel data to manipulate
+    PixCol16 *pixels16;             // 16-bit frame sent instead of pixels, nullptr unless Pixeleds::setPixels16()
     PixPal *palette;                // color palette to work with
+    PixLayout *layout;              // optional 2D layout of the pixels (nullptr for a plain strip)
     unsigned long cycleDuration;    // total duration of one cycle in ms (1..)
     unsigned long start;            // time (in ms) the animation started
     unsigned long stop;             // time (in ms) the animation will stop (start + total duration, equal to start for infinite)
@@ -410,7 +854,37 @@ struct PixAniData {
     unsigned long cycleMillis;      // ms into the current cycle (0..cycleDuration)
     unsigned long cycleCount;       // number of cycles performed.  note: this count rolls over when system.millis() value rolls over
     float cyclePct;                 // percent of the way through the current cycle
-    int data;                       // data to pass to animation function
+    intptr_t data;                  // data to pass to animation function
+    int offset;                     // ring offset the output starts at (pixel offset is shown as pixel 0)
+    byte offsetBlend;               // sub-pixel blend of the offset towards the next pixel (0-255)
+    // state of the running animation, in the arena owned by Pixeleds (zeroed when the animation starts)
+    byte *stateMemory;              // PIXELEDS_STATE_SIZE bytes
+    byte *pixelStateMemory;         // PIXELEDS_PIXEL_STATE_SIZE bytes per pixel
+    bool stateCreated;              // the state object was constructed
+    // set by the animation, reset before each fire:
+    unsigned long hold;             // ms from updated the frame stays unchanged (0 = fire at the refresh rate)
+
+    /* the animation's state object, constructed (T()) on the first call after the animation started
+       (nullptr if the arena could not be allocated) */
+    template <typename T> T* state() {
+        static_assert(sizeof(T) <= PIXELEDS_STATE_SIZE, "Animation state is larger than PIXELEDS_STATE_SIZE");
+        static_assert(alignof(T) <= alignof(std::max_align_t), "Animation state is over-aligned");
+        static_assert(std::is_trivially_destructible<T>::value, "Animation state is never destroyed, it can't need a destructor");
+        if (!stateMemory) return nullptr;
+        if (!stateCreated) {
+            new (stateMemory) T();
+            stateCreated = true;
+        }
+        return (T*) stateMemory;
+    }
+
+    /* per-pixel state (pixelCount elements of up to PIXELEDS_PIXEL_STATE_SIZE bytes), zero when the animation
+       starts (nullptr if the arena could not be allocated) */
+    template <typename T> T* pixelState() {
+        static_assert(sizeof(T) <= PIXELEDS_PIXEL_STATE_SIZE, "Pixel state is larger than PIXELEDS_PIXEL_STATE_SIZE");
+        static_assert(std::is_trivially_copyable<T>::value, "Pixel state must be plain data");
+        return (T*) pixelStateMemory;
+    }
 
     /* return the current step, given the number of steps, based on time and cycle time */
     int step(int steps) { return (int) (cyclePct * steps); }
@@ -442,6 +916,38 @@ struct PixAniData {
 
     void setPixels(PixCol color) { for (int i = 0; i < pixelCount; ++i) { pixels[i] = color; } }
 
+    /* the pixels as HSV, for animations run with Pixeleds::setHsvPixels() */
+    inline PixHsv* hsvPixels() { return (PixHsv*) pixels; }
+
+    void fillHsv(PixHsv color) { for (int i = 0; i < pixelCount; ++i) { hsvPixels()[i] = color; } }
+
+    /* true the first time the animation is fired (from startAnimation) */
+    inline bool firstFire() { return updated == start; }
+
+    /* hint that the frame doesn't change until the next of the given number of steps in the cycle (see step()),
+       the animation isn't fired (and nothing is sent) before then */
+    void holdSteps(int steps) {
+        if (steps <= 0) return;
+        unsigned long next = ((unsigned long) step(steps) + 1) * cycleDuration;
+        hold = (next + steps - 1) / steps - cycleMillis;
+    }
+
+    /* scroll the rendered pixels so the (fractional) pixel position is shown as pixel 0, see offset */
+    void scrollTo(float position) {
+        offset = (int) position;
+        offsetBlend = (byte) ((position - offset) * 256);
+    }
+
+    /* 2D helpers, without a layout the strip is treated as pixelCount x 1 */
+    inline int width() { return layout ? layout->width : pixelCount; }
+    inline int height() { return layout ? layout->height : 1; }
+
+    /* return the strip index of x,y (no bounds checking) */
+    inline int xy(int x, int y) { return layout ? layout->index(x, y) : y * pixelCount + x; }
+
+    /* return the pixel at x,y (no bounds checking) */
+    inline PixCol& pixelXY(int x, int y) { return pixels[xy(x, y)]; }
+
     /* https://www.desmos.com/calculator/3modf4w7wj */
 
     /* returns y 0.0 to 1.0 sine wave for x in period.  y=0.5 at .25 & .75 y=1 at .5; y=0 at 0 & 1 */
@@ -474,6 +980,235 @@ struct PixAniData {
 typedef void (PixAniFunc)(PixAniData* data);
 
 
+/**
+ * @class PixFrameCache
+ * @brief Pre-rendered frames for one cycle of a periodic animation.
+ *
+ * Most animations are a pure function of the cycle position, so one cycle can be recorded once
+ * at the refresh rate and replayed afterwards without calling the animation function. Frames are
+ * stored compactly in a single block of memory (owned, or provided by the application e.g. in
+ * PSRAM): frame 0 is a keyframe and every following frame only stores the runs of pixels that
+ * changed since the previous one, runs of a single color are run length encoded.
+ *
+ * Record layout (little endian): [offset:2][offsetBlend:1] then ops until all pixels are covered,
+ * each op is [skip:2][count:2] followed by count colors, or one color if bit 15 of count is set.
+ *
+ * The first cycle is recorded while it is shown: each frame of the animation renders the next
+ * frame of the cycle at its exact position (and any it missed, if update() was late), so starting
+ * an animation costs no more than rendering it live. If the cycle doesn't fit in the memory,
+ * recording stops and the animation is rendered live.
+ */
+class PixFrameCache {
+public:
+    ~PixFrameCache();
+
+    // allocate (once) an owned store of the given size, 0 frees it and disables the cache
+    bool allocate(size_t size);
+
+    // use the given memory as the store, must outlive the cache
+    void use(uint8_t *memory, size_t size);
+
+    // true if the cache has a store
+    inline bool isEnabled() const { return store != nullptr; }
+
+    // true if a cycle is cached for the current animation
+    inline bool isReady() const { return frameCount > 0; }
+
+    // true while the first cycle of the current animation is recorded
+    inline bool isRecording() const { return recording; }
+
+    // record the cycle of the animation in data at frameMillis intervals from its next frame, false if the store
+    // can't even hold one frame
+    bool begin(const PixAniData &data, int frameMillis);
+
+    // fire the animation for the frames of the cycle up to data.cycleMillis and record them, the pixels are left at the
+    // latest one; when the cycle is complete the cache is ready, when it doesn't fit recording stops
+    void record(PixAniFunc *animation, PixAniData &data);
+
+    // bring data.pixels (and offsets) to the cached frame for data.cycleMillis
+    void replay(PixAniData &data);
+
+    // forget the cached cycle
+    inline void clear() { frameCount = 0; used = 0; recording = false; }
+
+    // replayed frames, live rendered frames (while enabled), bytes used by the cached cycle and the size of the store
+    unsigned long hits = 0;
+    unsigned long misses = 0;
+    inline size_t bytesUsed() const { return used; }
+    inline size_t bytesAllocated() const { return size; }
+
+private:
+    size_t encodeFrame(size_t pos, const PixCol *current, const PixCol *previous, int pixelCount, const PixAniData &data);
+    size_t decodeFrame(size_t pos, PixAniData &data);
+
+    uint8_t *store = nullptr;
+    size_t size = 0;
+    bool owned = false;
+    size_t used = 0;
+    int frameCount = 0;
+    int frameMillis = 1;
+    int currentFrame = 0;      // frame currently in the pixels
+    size_t nextRecord = 0;     // position of the record following currentFrame
+
+    // while recording: frames in the cycle, frames recorded so far
+    bool recording = false;
+    int cycleFrames = 0;
+    int recordedFrames = 0;
+};
+
+
+/**
+ * @class PixFrameExchange
+ * @brief Hands complete frames from any thread to the output without tearing and without locks.
+ *
+ * Three frame buffers rotate between the writers, a middle "latest" slot and the output: a
+ * writer fills the back buffer and publishes it by swapping it with the middle one, the output
+ * swaps its front buffer with the middle one when a newer frame is there. Both swaps are a single
+ * atomic exchange, so the output always encodes a complete frame and a newer frame simply
+ * replaces one that wasn't shown yet.
+ *
+ * Writers never wait: only one writer can fill the back buffer at a time, a second writer trying
+ * at the same moment gets false (or nullptr) and can retry on its next frame.
+ *
+ * Only frames passed through the exchange are safe from other threads. The Pixeleds setters write
+ * the pixel buffer that update() publishes, see Pixeleds::setFrameExchange().
+ *
+ * Example Usage:
+ * @code
+ * PixFrameExchange exchange(PIXEL_COUNT);
+ * px.setFrameExchange(&exchange);  // the strip now shows the latest published frame
+ *
+ * // any thread, e.g. a cloud function handler
+ * exchange.publish(myPixels);
+ *
+ * // or render straight into the back buffer
+ * PixCol *frame = exchange.beginFrame();
+ * if (frame) {
+ *     ...
+ *     exchange.endFrame();
+ * }
+ * @endcode
+ */
+class PixFrameExchange {
+public:
+    PixFrameExchange(int pixelCount);
+    ~PixFrameExchange();
+
+    PixFrameExchange(const PixFrameExchange&) = delete;
+    PixFrameExchange& operator=(const PixFrameExchange&) = delete;
+
+    inline int getPixelCount() const { return pixelCount; }
+
+    // copy a complete frame (pixelCount pixels, shown from the given ring offset), returns false if another writer is busy
+    bool publish(const PixCol *pixels, int offset = 0, byte offsetBlend = 0);
+
+    // the back buffer to render a frame into, nullptr if another writer is busy; must be followed by endFrame()
+    PixCol* beginFrame();
+
+    // publish the frame rendered since beginFrame()
+    void endFrame(int offset = 0, byte offsetBlend = 0);
+
+    // output side (a single thread): take the latest published frame, returns false if there is nothing newer
+    bool acquire();
+
+    // the frame taken by the last acquire()
+    inline const PixCol* front() const { return frames[frontIndex]; }
+    inline int frontOffset() const { return offsets[frontIndex]; }
+    inline byte frontOffsetBlend() const { return blends[frontIndex]; }
+
+    // frames published, frames acquired, writes refused because another writer was busy
+    std::atomic<unsigned long> published {0};
+    unsigned long acquired = 0;
+    std::atomic<unsigned long> collisions {0};
+
+private:
+    static const uint8_t FRESH = 0x80;   // the middle slot holds a frame that wasn't acquired yet
+
+    int pixelCount;
+    PixCol *frames[3];
+    int offsets[3] {};
+    byte blends[3] {};
+    uint8_t backIndex = 0;               // owned by the writer holding writing
+    std::atomic<uint8_t> middle {1};     // index of the latest frame, | FRESH
+    uint8_t frontIndex = 2;              // owned by the output
+    std::atomic_flag writing = ATOMIC_FLAG_INIT;
+};
+
+
+/**
+ * @struct PixSeqStep
+ * @brief One step of an animation sequence, see Pixeleds::startSequence().
+ *
+ * Steps only hold pointers and numbers, so a sequence can be a const array kept in flash.
+ *
+ * Example Usage:
+ * @code
+ * const PixSeqStep show[] = {
+ *     // animation,          palette,         cycle, duration, data, transition, transitionType
+ *     { &animation_gradient, &Color::RAINBOW,  4000,    16000,    0,          0, TRANSITION_CROSSFADE },
+ *     { &animation_glow,     &whitePal,        2000,     8000,    0,       1000, TRANSITION_CROSSFADE },
+ *     { &animation_sparkle,  &Color::BLUES,    1000,     8000,   10,        500, TRANSITION_DISSOLVE },
+ * };
+ * px.startSequence(show, 3);
+ * @endcode
+ */
+struct PixSeqStep {
+    PixAniFunc *animation;          // animation function
+    PixPal *palette;                // color palette for the animation
+    long cycle;                     // animation cycle time in ms
+    long duration;                  // time in ms this step runs before the next one starts (1..)
+    intptr_t data;                  // data to pass to the animation function
+    long transition;                // transition time in ms from the previous step (0 for an instant switch)
+    byte transitionType;            // TRANSITION_* used when transition > 0
+};
+
+
+/**
+ * @struct PixFootprint
+ * @brief RAM in bytes of a Pixeleds and its strip, see pixeledsFootprint() (compile time, for a configuration)
+ * and Pixeleds::getFootprint() (what is allocated at runtime).
+ */
+struct PixFootprint {
+    size_t pixels;          // rendered pixels
+    size_t transition;      // the two frames of a transition (allocated on the first transition)
+    size_t state;           // animation state arena
+    size_t encode;          // encoded LED data: SPI buffer or chunk ring and the encode cache (0 when bit-banged)
+    size_t resetPadding;    // part of encode: zeros of the reset periods, start and end frames
+    size_t palettes;        // palette colors on the heap
+    size_t caches;          // frame cache, keyframes and the last frame kept for change detection
+    size_t objects;         // the Pixeleds and ParticlePixels objects themselves
+
+    constexpr size_t total() const { return pixels + transition + state + encode + palettes + caches + objects; }
+};
+
+
+/**
+ * @struct PixFrameStats
+ * @brief Timing of the animation frames rendered by Pixeleds::update(), see Pixeleds::getFrameStats().
+ *
+ * Intervals are between the starts of consecutive frames of a running animation in microseconds,
+ * a frame is late if it started more than half a refresh period after it was due (held frames are due
+ * at the end of the hold, see PixAniData::holdSteps).
+ */
+struct PixFrameStats {
+    unsigned long period;           // refresh period
+    unsigned long frames;
+    unsigned long intervals;
+    unsigned long late;
+    unsigned long minInterval;
+    unsigned long maxInterval;
+    unsigned long long totalInterval;
+
+    inline unsigned long averageInterval() const { return intervals ? totalInterval / intervals : 0; }
+
+    // largest deviation of an interval from the refresh period
+    inline unsigned long jitter() const {
+        if (!intervals) return 0;
+        return max(maxInterval - min(maxInterval, period), period - min(minInterval, period));
+    }
+};
+
+
 /**
  * @class Pixeleds
  * @brief A class to manage and control a strip of addressable LEDs.
@@ -499,8 +1234,19 @@ public:
 
     ~Pixeleds();
 
-    // initialize all the things, must be called in application's setup()
-    void setup();
+    // initialize all the things, must be called in application's setup(), returns getStatus()
+    int setup();
+
+    // PIXELEDS_OK, or why the strip can't show anything (PIXELEDS_NO_MEMORY, PIXELEDS_UNSUPPORTED, PIXELEDS_NO_INTERFACE),
+    // until it is OK update(), the pixel setters, startAnimation() and startSequence() do nothing
+    int getStatus() const;
+
+    // RAM allocated now by this object and its strip
+    PixFootprint getFootprint() const;
+
+    // pre-flight check before constructing a Pixeleds on the heap: PIXELEDS_UNSUPPORTED for an LED type this platform
+    // can't drive, PIXELEDS_NO_MEMORY if pixeledsFootprint() of the configuration is more than the free heap
+    static int checkMemory(int pixelCount, byte type = WS2812B, byte order = ORDER_RGB, int outputCount = 0, int paletteColors = 0);
 
     // update pixels, call this from the application's loop()
     void update(system_tick_t millis);
@@ -525,28 +1271,232 @@ public:
     // like set but forces immediate refresh, does not disable animation
     void updatePixels(PixCol color);
 
-    // start a pixel animation using the given animation function
+    // the pixel buffer, for sources that write whole frames directly (e.g. network receivers)
+    PixCol* getPixels() const;
+    int getPixelCount() const;
+
+    // keep 8-bit hue, saturation, value pixels (see PixHsv, PixAniData::hsvPixels) instead of RGB, they are converted
+    // with the table while the frame is encoded; nullptr switches back to RGB. Only use animations that write
+    // hsvPixels() (the built-in animations write RGB). Transitions and keyframes blend the hue the short way
+    // around the wheel, a sub-pixel offset blends the two neighbours as RGB
+    void setHsvPixels(const PixHsvTable *table = &PixHsvTable::standard());
+    PixHsv* getHsvPixels() const;
+
+    // keep a 16-bit frame (see PixCol16, PixAniData::pixels16) for a WS2816 or HD108 strip, it is sent instead of the
+    // pixels expanded by the gamma table; the pixel setters write both. Only use animations that write pixels16,
+    // transitions cut and keyframes and the frame cache are off. false for other strips, HSV pixels, a frame
+    // exchange or if the frame can't be allocated
+    bool setPixels16(bool enable = true);
+    PixCol16* getPixels16() const;
+
+    // stop any animation and show the pixels written into getPixels() on next update()
+    void showPixels();
+
+    // start a pixel animation using the given animation function, with a transition time > 0 the
+    // outgoing animation keeps running while it is replaced using the given transition (TRANSITION_*),
+    // nullptr if getStatus() isn't PIXELEDS_OK
     PixAniData* startAnimation(PixAniFunc *animation, PixPal *palette,
-                               long cycle = 1000, long duration = -1, int data = 0);
+                               long cycle = 1000, long duration = -1, intptr_t data = 0,
+                               long transition = 0, byte transitionType = TRANSITION_CROSSFADE);
+
+    // run the sequence steps one after the other (from the start again if loop is true), each step starts
+    // exactly when the previous one is scheduled to end so the sequence doesn't drift, steps must outlive the sequence
+    void startSequence(const PixSeqStep *steps, int stepCount, bool loop = true);
+
+    // stop the sequence, the current animation keeps running
+    void stopSequence();
+
+    // true if a sequence is currently running
+    bool isSequenceActive() const;
+
+    // index of the current sequence step
+    int getSequenceStep() const;
+
+    // time (in ms) the next sequence step is scheduled to start
+    system_tick_t getSequenceSwitch() const;
 
     // set the rate the animation will be executed and refreshed
     void setAnimationRefresh(int refresh = 1000/50);
 
+    // render the animation only every keyframeMillis (longer than the animation refresh) and send frames interpolated
+    // between the last two keyframes at the refresh rate; each keyframe is rendered a keyframe period ahead so the
+    // output isn't delayed, 0 renders every frame (default); not used while the frame cache replays or a transition runs
+    bool setKeyframeRefresh(int keyframeMillis);
+
+    // cache one cycle of animations started from now on (rendered at the refresh rate and replayed by cycle position)
+    // in at most maxBytes, animations that don't fit are rendered live, 0 disables the cache
+    // note: sparkle, strobe and random are never cached, custom animations must be a pure function of the cycle
+    bool setFrameCache(size_t maxBytes);
+
+    // same as above using the given memory (e.g. PSRAM or a retained section), must outlive this object
+    void setFrameCache(uint8_t *memory, size_t size);
+
+    // frames replayed from the cache, frames rendered live while the cache is enabled, bytes used by the cached cycle
+    unsigned long getFrameCacheHits() const;
+    unsigned long getFrameCacheMisses() const;
+    size_t getFrameCacheBytes() const;
+
+    // skip encoding and sending frames identical to the one sent last (off by default, keeps a copy of the frame
+    // to compare with), with keepAlive > 0 an unchanged frame is sent again every keepAlive ms; false if the copy
+    // could not be allocated
+    bool setChangeDetection(bool enable, unsigned long keepAlive = 0);
+
+    // frames skipped because they were unchanged, frames sent to the strip
+    unsigned long getSkippedFrames() const;
+    unsigned long getSentFrames() const;
+
+    // emit the rendered pixels tiled, mirrored or reversed (OUTPUT_*) on a strip of outputCount pixels
+    // (0 = pixel count, or twice the pixel count for OUTPUT_TILE/OUTPUT_MIRROR), call before setup()
+    bool setOutputMapping(byte mapping, int outputCount = 0);
+
+    // use the given 2D layout for animations (nullptr for a plain strip), layout must outlive this object;
+    // false if an index is outside the pixels or the layout's table couldn't be allocated
+    bool setLayout(PixLayout *layout);
+
+    // show the latest frame published to the exchange (by any thread) instead of the pixels, frames rendered
+    // by this object are published to it on update(); exchange must outlive this object, nullptr to stop
+    // note: other threads must write with the exchange's publish() or beginFrame()/endFrame(); setPixel() and
+    // setPixels() take the lock but change the pixels update() copies into the exchange, and writes through
+    // getPixels() need WITH_LOCK(px)
+    bool setFrameExchange(PixFrameExchange *exchange);
+
+    /* render thread */
+
+    // run update() on its own thread at the animation refresh rate, scheduled on absolute deadlines so slow
+    // code in loop() doesn't cause stutter (don't call update() from loop() while it runs)
+    bool startThread(os_thread_prio_t priority = PIXELEDS_THREAD_PRIORITY, size_t stackSize = PIXELEDS_THREAD_STACK_SIZE);
+
+    // stop the render thread, waits for the frame being rendered
+    void stopThread();
+
+    // true while the render thread runs
+    bool isThreadRunning() const;
+
+    // held while a frame is rendered, the methods above take it as well; while the render thread runs wrap
+    // other changes the animation depends on (palette colors, getPixels()) in WITH_LOCK(px) { ... }
+    void lock();
+    void unlock();
+
+    // timing of the animation frames rendered since the last reset, with or without the render thread
+    PixFrameStats getFrameStats();
+    void resetFrameStats();
+
     // true if an animation is currently running
     bool isAnimationActive() const;
 
+    // true while a transition between animations is running
+    bool isTransitionActive() const;
+
+    // ms until update() next has something to do: an animation frame (after its hold, see PixAniData::holdSteps),
+    // the animation's stop, a transition frame or sequence step, the keep-alive (see setChangeDetection) or a pending
+    // refresh (0); PIXELEDS_IDLE_FOREVER if
+    // only a call changing the pixels would, the application can sleep or block this long between update() calls
+    system_tick_t getIdleMillis(system_tick_t millis);
+
+    // bytes of the animation state arena for pixelCount pixels (see PixAniData::state)
+    static constexpr size_t stateArenaSize(int pixelCount) {
+        return 2 * ((PIXELEDS_STATE_SIZE + pixelCount * PIXELEDS_PIXEL_STATE_SIZE + alignof(std::max_align_t) - 1)
+                    / alignof(std::max_align_t) * alignof(std::max_align_t));
+    }
+
+protected:
+    // use the given memory for the state arena (stateArenaSize bytes, max_align_t aligned) and the transition
+    // frames (2 x pixel count) instead of the heap, both must outlive this object (see StaticPixeleds)
+    Pixeleds(ParticlePixels *pixelStrip, byte *stateMemory, PixCol *transitionMemory);
+
 private:
-    void initializeAnimation(PixCol* pixels, int pixelCount);
+    void initializeAnimation(PixCol* pixels, int pixelCount, byte *stateMemory = nullptr);
+
+    PixAniData* beginAnimation(PixAniFunc *animation, PixPal *palette, long cycle, long duration, intptr_t data,
+                               long transition, byte transitionType, system_tick_t start);
+
+    void updateSequence(system_tick_t millis);
+
+    void stopForPixels();
+
+    void setPixel16(int pixel, PixCol color);
     
     void updateAnimation(system_tick_t millis);
 
+    bool fireAnimation(PixAniFunc *&function, PixAniData &data, system_tick_t millis);
+
+    unsigned long fireWait(const PixAniData &data) const;
+
+    static bool isCacheable(PixAniFunc *animation);
+
+    void startTransition(long transition, byte transitionType, system_tick_t start);
+
+    void updateTransition(system_tick_t millis);
+
+    void blendTransition(uint16_t alpha);
+
+    void endTransition();
+
+    bool isKeyframing() const;
+
+    void updateKeyframes(system_tick_t millis);
+
+    void endKeyframes();
+
     ParticlePixels *pixelStrip;
     bool ownPixels = false;
     bool ownPixelStrip = false;
+    bool ownBuffers = true;    // state arena and transition frames
 
     PixAniFunc *animationFunction {};
     PixAniData animationData = PixAniData();
+
+    // animation state arena, allocated once: two slots (the outgoing animation of a transition keeps
+    // its own) of PIXELEDS_STATE_SIZE bytes + PIXELEDS_PIXEL_STATE_SIZE bytes per pixel
+    void resetAnimationState(int slot);
+    byte *stateArena {};
+    size_t stateSlotSize{};
+    int stateSlot{};
     int animationRefresh{};
+    PixFrameCache frameCache;
+
+    // transition: the outgoing animation renders into transitionPixels[0..n), the blended frame
+    // shown during the transition is in transitionPixels[n..2n), allocated on first use and reused
+    PixCol *transitionPixels {};
+    PixAniFunc *outgoingFunction {};
+    PixAniData outgoingData = PixAniData();
+    system_tick_t transitionStart{};
+    system_tick_t transitionUpdated{};
+    unsigned long transitionDuration{};
+    byte transitionType{};
+
+    // keyframes: the previous keyframe is in keyframePixels[0..n) (shown from keyframeOffset), the interpolated frame
+    // shown in keyframePixels[n..2n), the next keyframe is rendered into the animation's pixels
+    PixCol *keyframePixels {};
+    int keyframeRefresh{};
+    bool keyframeValid{};
+    int keyframeOffset{};
+    byte keyframeBlend{};
+    system_tick_t keyframeStart{};
+    system_tick_t keyframeUpdated{};
+
+    // sequence: steps are run one after the other, the switch time is scheduled from the previous switch
+    const PixSeqStep *sequenceSteps {};
+    int sequenceCount{};
+    int sequenceIndex{};
+    bool sequenceLoop{};
+    system_tick_t sequenceSwitch{};
+
+    // render thread: update() runs every animationRefresh ms on its own thread, the mutex exists from the constructor
+    // on so lock() never races startThread() (on the device it is null only if it couldn't be created)
+    static void renderThread(void *param);
+    void recordFrame(unsigned long wait);
+#if PIXELEDS_HOST
+    std::thread thread;
+    std::recursive_mutex mutex;
+#else
+    os_thread_t thread {};
+    os_mutex_recursive_t mutex {};
+#endif
+    std::atomic<bool> threadRunning {false};
+
+    PixFrameStats frameStats {};
+    unsigned long lastFrameMicros{};
 };
 
 
@@ -572,3 +1522,7 @@ extern PixAniFunc animation_comet;
 extern PixAniFunc animation_bars;
 extern PixAniFunc animation_gradient;
 
+/* all palette colors, 2D (see PixLayout) */
+extern PixAniFunc animation_gradient2d;
+extern PixAniFunc animation_scanner2d;
+
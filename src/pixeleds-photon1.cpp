@@ -8,33 +8,136 @@ STM32_Pin_Info* BB_PIN_MAP = HAL_Pin_Map();
 #define bbPinHI(_pin) (BB_PIN_MAP[_pin].gpio_peripheral->BSRRL = BB_PIN_MAP[_pin].gpio_pin)
 
 
-ParticlePixels::ParticlePixels(PixCol *pixels, int pixelCount, byte pin, byte type, byte order) {
+ParticlePixels::ParticlePixels(PixCol *pixels, int pixelCount, byte pin, byte type, byte order, uint8_t *spiMemory, size_t spiMemorySize) {
     this->pixelCount = pixelCount;
     this->pixels = pixels;
+    this->mapping = OUTPUT_DIRECT;
+    this->outputCount = pixelCount;
+    this->offset = 0;
+    this->offsetBlend = 0;
     this->pin = pin;
     this->type = type;
-    this->rOfs = order & 3;
-    this->gOfs = ((order >> 2) & 3);
-    this->bOfs = ((order >> 4) & 3);
+    if (!isSupported(type)) {
+        Log.error("Only WS2812B, SK6812W, WS2816, APA102, SK9822, HD107S and HD108 supported on Photon");
+        this->status = PIXELEDS_UNSUPPORTED;
+    }
+    // shift of each channel in the word sent MSB first, 24 bits for WS2812B, 32 for SK6812W (W last),
+    // 48 bits for WS2816 (16 bits per channel)
+    this->rShift = pixelWordShift(type, order, 0);
+    this->gShift = pixelWordShift(type, order, 1);
+    this->bShift = pixelWordShift(type, order, 2);
+    if (PIXEL_TYPE_16BIT(type)) {
+        this->gamma16 = &PixGamma16::standard();
+    }
     this->refresh = true;
     this->endMicros = 0;
+    if (PIXEL_TYPE_CLOCKED(type)) {
+        // [0b111 + brightness][3 colors] per LED, see encodeClockedPixels()
+        // HD108: [header:2][3 x 16-bit colors] per LED, see encodeHd108Pixels()
+        byte first = (type == HD108) ? 2 : 1;
+        byte size = (type == HD108) ? 2 : 1;
+        this->spi = (pin == 0) ? &SPI : &SPI1;
+        this->spiMemory = spiMemory;
+        this->spiMemorySize = spiMemorySize;
+        this->rOffset = first + (order & 3) * size;
+        this->gOffset = first + ((order >> 2) & 3) * size;
+        this->bOffset = first + ((order >> 4) & 3) * size;
+        allocateSpiArray();
+    }
 }
 
 ParticlePixels::~ParticlePixels() {
+    if (spi) {
+        spi->end();
+        if (!spiMemory) free(spiArray);
+        return;
+    }
     pinMode(pin, INPUT);
 }
 
+/**
+* Allocates the buffer of a clocked strip: start frame, 4 (HD108: 8) bytes per LED, end frame.
+*/
+bool ParticlePixels::allocateSpiArray() {
+    if (!spiMemory) free(spiArray);
+    startBytes = (type == HD108) ? HD108_START_BYTES : CLOCKED_START_BYTES;
+    size_t ledSize = (type == HD108) ? HD108_BYTES_PER_LED : CLOCKED_BYTES_PER_LED;
+    spiArraySize = startBytes + outputCount * ledSize + clockedEndBytes(outputCount);
+    spiArray = spiMemory ? (spiArraySize <= spiMemorySize ? spiMemory : NULL) : (uint8_t*) malloc(spiArraySize);
+    if (spiArray == NULL) {
+        Log.error("Not enough memory available!");
+        status = PIXELEDS_NO_MEMORY;
+        return false;
+    }
+    memset(spiArray, 0, spiArraySize);  // start and end frames stay zero
+    status = PIXELEDS_OK;
+    return true;
+}
+
+bool ParticlePixels::setOutputMapping(byte mapping, int outputCount) {
+    this->mapping = mapping;
+    this->outputCount = outputCount > 0 ? outputCount : PixOutputWalk::defaultOutputCount(mapping, pixelCount);
+    changes.invalidate();
+    triggerRefresh();
+    return spi ? allocateSpiArray() : true;
+}
+
 void ParticlePixels::setup() {
+    if (spi) {
+        spi->begin();
+        spi->setClockSpeed(CLOCKED_CLOCK_SPEED);
+        spi->setBitOrder(MSBFIRST);
+        spi->setDataMode(SPI_MODE0);
+        return;
+    }
     pinMode(pin, OUTPUT);
     digitalWrite(pin, LOW);
 }
 
 void ParticlePixels::update(bool forceRefresh) {
-    if (!pixels || (!refresh && !forceRefresh)) return;
+    if (!pixels) return;
+
+    const PixCol *source = pixels;
+    int sourceOffset = offset;
+    byte sourceBlend = offsetBlend;
+    bool pending = false;
+    if (exchange) {
+        // this thread's frame is published like any other writer's (kept pending if a writer is busy)
+        if (refresh) pending = !exchange->publish(pixels, offset, offsetBlend);
+        if (!exchange->acquire() && !forceRefresh && !changes.keepAliveDue()) {
+            refresh = pending;
+            return;
+        }
+        source = exchange->front();
+        sourceOffset = exchange->frontOffset();
+        sourceBlend = exchange->frontOffsetBlend();
+    }
+    else if (!refresh && !forceRefresh && !changes.keepAliveDue()) return;
+
+    // a 16-bit frame isn't compared, only the 8-bit pixels are kept for that
+    if (!pixels16 && changes.skip(source, sourceOffset, sourceBlend, forceRefresh)) {
+        refresh = pending;
+        return;
+    }
+
+    if (spi) {
+        // clocked types latch on the next start frame, no reset period to wait for
+        if (!spiArray) return;
+        PixOutputWalk walk(source, pixelCount, mapping, sourceOffset, sourceBlend, hsvTable);
+        walk.wide = pixels16;
+        if (gamma16) encodeHd108Pixels(spiArray + startBytes, walk, outputCount, rOffset, gOffset, bOffset, brightness, *gamma16);
+        else encodeClockedPixels(spiArray + startBytes, walk, outputCount, rOffset, gOffset, bOffset, brightness);
+        spi->beginTransaction();
+        spi->transfer(spiArray, nullptr, spiArraySize, nullptr);
+        spi->endTransaction();
+        this->refresh = pending;
+        return;
+    }
 
     uint32_t wait_micros;
     switch(type) {
         case WS2812B: { wait_micros = 300L; } break;
+        case WS2816:  { wait_micros = 300L; } break;
         case SK6812W: { wait_micros = 80L; } break;
         default:      { wait_micros = 50L; } break;
     }
@@ -42,89 +145,99 @@ void ParticlePixels::update(bool forceRefresh) {
 
     bool irq = HAL_disable_irq();
 
-    volatile int count = pixelCount;
-    volatile PixCol *pPixels = pixels;
-    volatile uint32_t color, mask;
-    volatile uint8_t bits, r,g,b,w;
+    volatile int count = outputCount;
+    PixOutputWalk walk(source, pixelCount, mapping, sourceOffset, sourceBlend, hsvTable);
+    walk.wide = pixels16;
+    PixCol pixel;
+    volatile uint32_t color, second, mask;
+    volatile uint8_t bits, words;
 
-    if (type == WS2812B) {
+    if (type == WS2812B || type == WS2816) {
         while (count) {
             count--;
-            r = (*pPixels).r;
-            g = (*pPixels).g;
-            b = (*pPixels++).b;
-            color = (uint32_t)r << ((2-rOfs)*8) | (uint32_t)g << ((2-gOfs)*8) | (uint32_t)b << ((2-bOfs)*8);
+            uint64_t wide = gamma16 ? packPixelWord16(walk.next16(*gamma16), rShift, gShift, bShift)
+                                    : packPixelWord(walk.next(), rShift, gShift, bShift, nullptr);
+            if (gamma16) {
+                // 48 bits sent as two 24-bit words with the WS2812B timing
+                color = (uint32_t)(wide >> 24);
+                second = (uint32_t)wide & 0xFFFFFF;
+                words = 2;
+            }
+            else {
+                color = (uint32_t)wide;
+                words = 1;
+            }
 
-            mask = 0x800000;
-            bits = 0;
             do {
-                // base+mov ~50ns, nop ~10ns
-                // loop ~100ns (subtracted from LOW)
-                // e.g. 500ns HIGH would be (500-50)/10=45 nops
-                //      500ns LOW would be (500-150)/10=35 nops
+                mask = 0x800000;
+                bits = 0;
+                do {
+                    // base+mov ~50ns, nop ~10ns
+                    // loop ~100ns (subtracted from LOW)
+                    // e.g. 500ns HIGH would be (500-50)/10=45 nops
+                    //      500ns LOW would be (500-150)/10=35 nops
 
-                if (color & mask) {
-                    // masked bit is high
-                    // WS2812 spec 700ns HIGH (65nop), 600ns LOW (45nop)
-                    bbPinHI(pin);
-                    asm volatile(
-                            "mov r0, r0" "\n\t"
-                            "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
-                            "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
-                            "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
-                            "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
-                            "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
-                            "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
-                            "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
-                            ::: "r0", "cc", "memory"
-                            );
-                    bbPinLO(pin);
-                    asm volatile(
-                            "mov r0, r0" "\n\t"
-                            "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
-                            "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
-                            "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
-                            "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
-                            "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
-                            :: : "r0", "cc", "memory"
-                            );
-                } else {
-                    // masked bit is low
-                    // WS2812 spec 350ns HIGH (30nop), 800ns LOW (65nop)
-                    bbPinHI(pin);
-                    asm volatile(
-                            "mov r0, r0" "\n\t"
-                            "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
-                            "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
-                            "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
-                            :: : "r0", "cc", "memory"
-                            );
-                    bbPinLO(pin);
-                    asm volatile(
-                            "mov r0, r0" "\n\t"
-                            "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
-                            "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
-                            "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
-                            "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
-                            "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
-                            "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
-                            "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
-                            ::: "r0", "cc", "memory"
-                            );
-                }
-                mask >>= 1;
-            } while (++bits < 24); // do all 24 bits
+                    if (color & mask) {
+                        // masked bit is high
+                        // WS2812 spec 700ns HIGH (65nop), 600ns LOW (45nop)
+                        bbPinHI(pin);
+                        asm volatile(
+                                "mov r0, r0" "\n\t"
+                                "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
+                                "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
+                                "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
+                                "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
+                                "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
+                                "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
+                                "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
+                                ::: "r0", "cc", "memory"
+                                );
+                        bbPinLO(pin);
+                        asm volatile(
+                                "mov r0, r0" "\n\t"
+                                "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
+                                "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
+                                "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
+                                "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
+                                "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
+                                :: : "r0", "cc", "memory"
+                                );
+                    } else {
+                        // masked bit is low
+                        // WS2812 spec 350ns HIGH (30nop), 800ns LOW (65nop)
+                        bbPinHI(pin);
+                        asm volatile(
+                                "mov r0, r0" "\n\t"
+                                "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
+                                "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
+                                "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
+                                :: : "r0", "cc", "memory"
+                                );
+                        bbPinLO(pin);
+                        asm volatile(
+                                "mov r0, r0" "\n\t"
+                                "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
+                                "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
+                                "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
+                                "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
+                                "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
+                                "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
+                                "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t" "nop" "\n\t"
+                                ::: "r0", "cc", "memory"
+                                );
+                    }
+                    mask >>= 1;
+                } while (++bits < 24); // do all 24 bits
+                color = second;
+            } while (--words);
         } // no more pixels
     }
     else if (type == SK6812W) {
         while (count) {
             count--;
-            r = (*pPixels).r;
-            g = (*pPixels).g;
-            b = (*pPixels++).b;
-//            w = (*pPixels++).w;
-            w = 0x0;
-            color = (uint32_t)r << ((3-rOfs)*8) | (uint32_t)g << ((3-gOfs)*8) | (uint32_t)b << ((3-bOfs)*8) | w;
+            pixel = walk.next();
+            // the pixels have no white, it is sent as 0 in the low byte
+            color = (uint32_t)packPixelWord(pixel, rShift, gShift, bShift, nullptr);
 
             mask = 0x80000000;
             bits = 0;
@@ -186,7 +299,7 @@ void ParticlePixels::update(bool forceRefresh) {
 
     HAL_enable_irq(irq);
     endMicros = micros();
-    this->refresh = false;
+    this->refresh = pending;
 }
 
 #endif // PLATFORM_ID check
\ No newline at end of file
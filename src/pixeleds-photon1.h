@@ -3,19 +3,105 @@
 
 #include "Particle.h"
 #include "pixeleds-library.h"
+#include "pixeleds-encode.h"
 
 class ParticlePixels {
 public:
-    ParticlePixels(PixCol *pixels, int pixelCount, byte pin, byte type = WS2812B, byte order = ORDER_GRB);
+    // clocked types encode into spiMemory (if given) instead of a heap buffer, it must outlive the strip
+    ParticlePixels(PixCol *pixels, int pixelCount, byte pin, byte type = WS2812B, byte order = ORDER_GRB,
+                   uint8_t *spiMemory = nullptr, size_t spiMemorySize = 0);
     ~ParticlePixels();
 
+    // bytes of the encode buffer for outputCount LEDs (clocked types, the others are bit-banged from the pixels),
+    // and the part of it that is start and end frames (see pixeledsFootprint)
+    static constexpr size_t encodeBytes(byte type, byte order, int outputCount) {
+        return !PIXEL_TYPE_CLOCKED(type) ? 0
+             : type == HD108 ? HD108_START_BYTES + outputCount * HD108_BYTES_PER_LED + clockedEndBytes(outputCount)
+             : CLOCKED_START_BYTES + outputCount * CLOCKED_BYTES_PER_LED + clockedEndBytes(outputCount);
+    }
+    static constexpr size_t resetBytes(byte type, int outputCount) {
+        return !PIXEL_TYPE_CLOCKED(type) ? 0
+             : (type == HD108 ? HD108_START_BYTES : CLOCKED_START_BYTES) + clockedEndBytes(outputCount);
+    }
+    static constexpr bool isSupported(byte type) {
+        return type == WS2812B || type == SK6812W || type == WS2816 || PIXEL_TYPE_CLOCKED(type);
+    }
+
     void setup();
     void update(bool forceRefresh = false);
     inline void triggerRefresh() { refresh = true; }
 
+    // PIXELEDS_OK, or why nothing can be sent (PIXELEDS_UNSUPPORTED, PIXELEDS_NO_MEMORY)
+    int getStatus() { return status; }
+    // bytes allocated for the encoded frame of a clocked strip, of it the start and end frames
+    size_t getEncodeBytes() { return spiArray ? spiArraySize : 0; }
+    size_t getResetBytes() { return spiArray ? startBytes + clockedEndBytes(outputCount) : 0; }
+    bool isRefreshPending() { return refresh || changes.keepAliveDue(); }
+    bool hasFrameExchange() { return exchange != nullptr; }
+
+    // skips frames identical to the one sent last when enabled, off by default
+    PixChangeDetector& getChangeDetector() { return changes; }
+
     int getPixelCount() { return pixelCount; }
     PixCol* getPixels() { return pixels; }
 
+    // encode from a different buffer of pixelCount pixels (e.g. a transition frame)
+    void setPixels(PixCol* pixels) {
+        this->pixels = pixels;
+        triggerRefresh();
+    }
+
+    // emit the pixels tiled, mirrored or reversed (OUTPUT_*) on a strip of outputCount pixels
+    bool setOutputMapping(byte mapping, int outputCount = 0);
+    int getOutputCount() { return outputCount; }
+
+    // 5-bit global brightness (0-31) sent with every LED of a clocked strip (APA102, SK9822, HD107S, HD108)
+    void setGlobalBrightness(byte brightness) {
+        this->brightness = min(brightness, (byte) CLOCKED_MAX_BRIGHTNESS);
+        changes.invalidate();
+        triggerRefresh();
+    }
+
+    // gamma table expanding the 8-bit pixels for 16-bit strips (WS2816, HD108), must outlive the strip
+    void setGamma16(const PixGamma16 *gamma) {
+        if (gamma16 && gamma) gamma16 = gamma;
+        changes.invalidate();
+        triggerRefresh();
+    }
+
+    // send this 16-bit frame of pixelCount pixels (must outlive the strip) instead of the pixels expanded by the gamma
+    // table, false if the strip isn't 16-bit (WS2816, HD108); nullptr sends the pixels again
+    bool setPixels16(const PixCol16 *pixels16) {
+        if (pixels16 && !gamma16) return false;
+        this->pixels16 = pixels16;
+        changes.invalidate();
+        triggerRefresh();
+        return true;
+    }
+    const PixGamma16* getGamma16() const { return gamma16; }
+
+    // the pixels are PixHsv converted with the table while encoding, nullptr for RGB pixels (must outlive the strip)
+    void setHsvTable(const PixHsvTable * table) {
+        hsvTable = table;
+        changes.invalidate();
+        triggerRefresh();
+    }
+    const PixHsvTable* getHsvTable() const { return hsvTable; }
+
+    // encode the latest frame published to the exchange, frames set here are published to it
+    void setFrameExchange(PixFrameExchange *exchange) {
+        this->exchange = exchange;
+        triggerRefresh();
+    }
+
+    // start the output at the given ring offset, blending towards the next pixel (0-255)
+    void setOffset(int offset, byte blend = 0) {
+        if (offset == this->offset && blend == offsetBlend) return;
+        this->offset = offset;
+        this->offsetBlend = blend;
+        triggerRefresh();
+    }
+
     void setPixelColor(int pixel, PixCol pixelColor) {
         if (pixel >= pixelCount) return;
         pixels[pixel] = pixelColor;
@@ -28,13 +114,58 @@ public:
     };
 
 private:
+    bool allocateSpiArray();
+
     byte pin;
     PixCol *pixels;
     int pixelCount;
+    byte mapping;
+    int outputCount;
+    int offset;
+    byte offsetBlend;
+    PixFrameExchange *exchange = nullptr;
     byte type;
-    byte rOfs,gOfs,bOfs;
+    byte rShift, gShift, bShift;
+    const PixGamma16 *gamma16 = nullptr;    // set for 16-bit types
+    const PixCol16 *pixels16 = nullptr;     // 16-bit frame sent instead of the pixels
+    const PixHsvTable *hsvTable = nullptr;  // set for HSV pixels
     unsigned long endMicros;
     bool refresh;
+    int status = PIXELEDS_OK;
+
+    // change detection (see getChangeDetector)
+    PixChangeDetector changes;
+
+    // clocked types are sent with the SPI peripheral (pin 0 = SPI, 1 = SPI1) from an encoded buffer
+    SPIClass *spi = nullptr;
+    byte brightness = CLOCKED_MAX_BRIGHTNESS;
+    byte rOffset, gOffset, bOffset;
+    size_t startBytes = 0;
+    size_t spiArraySize = 0;
+    uint8_t *spiArray = nullptr;
+    uint8_t *spiMemory = nullptr;   // external buffer for spiArray, never freed
+    size_t spiMemorySize = 0;
+};
+
+
+/**
+ * @class FixedParticlePixels
+ * @brief A ParticlePixels strip with the LED type and color order fixed at compile time.
+ *
+ * An unsupported type or order fails to compile (see PixLedFormat). The bit-banged output is
+ * timed by the per-bit delays, so on the Photon the encode is the same as ParticlePixels; the
+ * class keeps sketches portable to the Photon 2, where the encoder is specialized.
+ */
+template <byte TYPE, byte ORDER>
+class FixedParticlePixels : public ParticlePixels {
+public:
+    typedef PixLedFormat<TYPE, ORDER> Format;
+
+    // bit-banged types don't use an encode buffer
+    static constexpr size_t spiBufferSize(int outputCount) { return 0; }
+
+    FixedParticlePixels(PixCol *pixels, int pixelCount, byte pin, uint8_t *spiMemory = nullptr, size_t spiMemorySize = 0)
+        : ParticlePixels(pixels, pixelCount, pin, TYPE, ORDER, spiMemory, spiMemorySize) { }
 };
 
 #endif
\ No newline at end of file
@@ -1,50 +1,182 @@
 #if HAL_PLATFORM_RTL872X || (PLATFORM_ID == 32)  // photon 2/p2, m-som
 #include "pixeleds-photon2.h"
 #include "pixeleds-library.h"
+#include "pixeleds-encode.h"
+#include <new>
 
 /**
- * Encodes a single byte into a 3-byte WS2812B bit pattern.
- *
- * Each bit in the input byte is encoded into a 3-bit pattern:
- * - '1' is encoded as '110'
- * - '0' is encoded as '100'
- *
- * The encoding is done in three bytes:
- * First byte:  Contains patterns for bits 7,6,5 (MSB)
- * Second byte: Contains patterns for bits 4,3,2
- * Third byte:  Contains patterns for bits 2(cont),1,0 (LSB)
- *
- * @param byte    The input byte to encode
- * @param target  Pointer to where the 3 encoded bytes should be written
- *
- * @note This function performs inlined bitwise operations for optimal timing
- *       in LED control via SPI. The target buffer must have space for 3 bytes.
- *
- * Example:
- * Input:  0b10110100
- * Output: 0b11010011  First byte  (bits 7,6,5)
- *         0b01001101  Second byte (bits 4,3,2)
- *         0b00100110  Third byte  (bits 2-cont,1,0)
- */
-inline void encodeByteTo3xBits(uint8_t byte, uint8_t* target) {
-    // 1 = 110, 0 = 100
-    // First byte: bits 7,6,5
-    *target++ = 
-        ((byte & 0b10000000) ? 0b11000000 : 0b10000000) | // bit 7 -> bits 7,6,5
-        ((byte & 0b01000000) ? 0b00011000 : 0b00010000) | // bit 6 -> bits 4,3,2
-        ((byte & 0b00100000) ? 0b00000011 : 0b00000010);  // bit 5 -> bits 1,0 (continues)
-
-    // Second byte: bits 4,3,2 (bit 5's continuation is always 0)
-    *target++ = 
-        ((byte & 0b00010000) ? 0b01100000 : 0b01000000) | // bit 4 -> bits 6,5,4
-        ((byte & 0b00001000) ? 0b00001100 : 0b00001000) | // bit 3 -> bits 3,2,1
-        ((byte & 0b00000100) ? 0b00000001 : 0b00000001);  // bit 2 -> bit 0 (continues)
-
-    // Third byte: continuation of bit 2, then bits 1,0
-    *target =
-        ((byte & 0b00000100) ? 0b10000000 : 0b00000000) | // bit 2 continues -> bits 7,6
-        ((byte & 0b00000010) ? 0b00110000 : 0b00100000) | // bit 1 -> bits 5,4,3
-        ((byte & 0b00000001) ? 0b00000110 : 0b00000100);  // bit 0 -> bits 2,1,0
+* Allocates the SPI bit pattern buffer for outputCount LEDs plus the leading/trailing reset periods.
+* 
+* @return false (and logs an error) if there is not enough memory
+*/
+bool ParticlePixels::allocateSpiArray() {
+    if (!spiMemory) {
+        free(spiArray);
+        free(chunkRing);
+    }
+    spiArray = nullptr;
+    chunkRing = nullptr;
+    // bytes per color, spi bits per color bit, plus reset offset (start and end)
+    // e.g. 10 pixels * 3 bytes per pixel * 3 spi bits per color bit + 300us reset = (10 * 3 * 3) + 120 + 120 = 540 bytes 
+    // clocked types: start frame, 4 bytes per LED, end frame e.g. 4 + (10 * 4) + 5 = 49 bytes
+    endOffset = clocked ? clockedEndBytes(outputCount) : resetOffset;
+    spiArraySize = (outputCount * ledSize) + resetOffset + endOffset;
+    if (chunkPixels) {
+        // chunked output only keeps the ring of chunks plus the zeros sent before and after the LED data
+        chunkSize = chunkPixels * ledSize;
+        chunkCount = (outputCount + chunkPixels - 1) / chunkPixels;
+        size_t ringSize = SPI_CHUNK_RING * chunkSize + max(resetOffset, endOffset);
+        chunkRing = spiMemory ? (ringSize <= spiMemorySize ? spiMemory : NULL) : (uint8_t*) malloc(ringSize);
+        if (chunkRing == NULL) {
+            Log.error("Not enough memory available!");
+            status = PIXELEDS_NO_MEMORY;
+            return false;
+        }
+        memset(chunkRing, 0, ringSize);
+        status = PIXELEDS_OK;
+        return true;
+    }
+    spiArray = spiMemory ? (spiArraySize <= spiMemorySize ? spiMemory : NULL) : (uint8_t*) malloc(spiArraySize);
+    if (spiArray == NULL) { 
+        Log.error("Not enough memory available!"); 
+        status = PIXELEDS_NO_MEMORY;
+        return false;
+    }
+    memset(spiArray, 0, spiArraySize);  // clear the array
+    status = PIXELEDS_OK;
+    return true;
+}
+
+/**
+* Bytes allocated for the output: the encoded frame (or the chunk ring with its reset padding) plus
+* the encode cache slots (see setEncodeCache()).
+*/
+size_t ParticlePixels::getEncodeBytes() {
+    size_t bytes = 0;
+    if (spiArray) bytes = spiArraySize;
+    else if (chunkRing) bytes = SPI_CHUNK_RING * chunkSize + max(resetOffset, endOffset);
+    if (encodeSlotCount) bytes += encodeSlotCount * (pixelCount * sizeof(PixCol) + spiArraySize + sizeof(EncodeSlot));
+    return bytes;
+}
+
+/**
+* Emits the pixels tiled, mirrored or reversed (see OUTPUT_*) on a strip of outputCount LEDs.
+* 
+* The animation only renders pixelCount pixels, update() encodes the longer strip directly from
+* them (see PixOutputWalk), only the SPI buffer grows to outputCount LEDs.
+* 
+* @param mapping     OUTPUT_DIRECT, OUTPUT_TILE, OUTPUT_MIRROR or OUTPUT_REVERSE
+* @param outputCount LEDs on the physical strip (0 = default for the mapping)
+* @return false if the SPI buffer could not be allocated
+*/
+bool ParticlePixels::setOutputMapping(byte mapping, int outputCount) {
+    this->mapping = mapping;
+    this->outputCount = outputCount > 0 ? outputCount : PixOutputWalk::defaultOutputCount(mapping, pixelCount);
+    changes.invalidate();
+    triggerRefresh();
+    setEncodeCache(0);  // cached frames no longer match the buffer size
+    return allocateSpiArray();
+}
+
+/**
+* Encodes the frame in chunks just ahead of the SPI DMA instead of into a buffer for the whole strip.
+* 
+* The leading reset, each chunk of LED data and the trailing reset are sent as separate DMA
+* transfers. When a transfer completes, its callback starts the next one if that chunk is already
+* encoded, while update() encodes into the free chunks of the ring. Between transfers the line
+* stays low for the interrupt latency (a few microseconds); the LEDs only latch after a low period
+* of 50-280us, so the frame is received as one. If a chunk isn't ready in time (an underrun, e.g.
+* update() was preempted for long) the low period grows; this is counted by getChunkUnderruns().
+* The encoder runs up to SPI_CHUNK_RING - 1 chunks ahead of the DMA, so a preemption shorter than
+* their transfer time (1.5ms for 32 RGB LEDs per chunk) goes unnoticed. If the line stayed low for
+* SPI_LATCH_MICROS the LEDs may have latched the first part of the frame and would take the rest
+* as the start of a new one: the transfer ends there and the whole frame is sent again (up to
+* SPI_CHUNK_RESENDS times, counted by getChunkResends()), so the LEDs show the first part of the
+* new frame for one frame time instead of a torn frame until the next update.
+* 
+* RAM use is SPI_CHUNK_RING * chunkPixels LEDs of SPI data plus one reset period, instead of the
+* whole strip. The encode cache needs full frames and is disabled in this mode.
+* 
+* @param chunkPixels LEDs per chunk (0 = encode into a full frame buffer)
+* @return false if the buffers could not be allocated
+*/
+bool ParticlePixels::setChunkedEncode(int chunkPixels) {
+    if (chunkPixels > 0) {
+        setEncodeCache(0);
+    }
+    this->chunkPixels = chunkPixels > 0 ? chunkPixels : 0;
+    triggerRefresh();
+    return allocateSpiArray();
+}
+
+/**
+* Keeps already encoded frames so update() can transmit them again without encoding.
+* 
+* Frames are recognized by a hash of the rendered pixels plus the ring offset, a hit is verified
+* against a copy of the pixels so a hash collision can't show a wrong frame. The memory is split
+* into as many slots as fit (source pixels + full SPI buffer each), slots are reused round robin.
+* Useful for periodic animations and for static scenes that are refreshed again.
+* 
+* @param maxBytes Memory budget for the cache (0 frees it)
+* @return false if the budget doesn't fit a single frame or can't be allocated
+*/
+bool ParticlePixels::setEncodeCache(size_t maxBytes) {
+    free(encodeCache);
+    delete[] encodeSlots;
+    encodeCache = nullptr;
+    encodeSlots = nullptr;
+    encodeSlotCount = 0;
+    nextEncodeSlot = 0;
+    if (maxBytes == 0) return true;
+    if (chunkPixels) {
+        Log.error("Encode cache needs full frames, not available with chunked encode");
+        return false;
+    }
+
+    size_t slotSize = pixelCount * sizeof(PixCol) + spiArraySize;
+    int slots = maxBytes / slotSize;
+    if (slots == 0) {
+        Log.error("Encode cache of %u bytes doesn't fit a frame of %u bytes", (unsigned) maxBytes, (unsigned) slotSize);
+        return false;
+    }
+    encodeCache = (uint8_t*) malloc(slots * slotSize);
+    encodeSlots = new (std::nothrow) EncodeSlot[slots];
+    if (encodeCache == NULL || encodeSlots == NULL) {
+        Log.error("Not enough memory available!");
+        setEncodeCache(0);
+        return false;
+    }
+    memset(encodeCache, 0, slots * slotSize);  // reset periods stay zero
+    memset(encodeSlots, 0, slots * sizeof(EncodeSlot));
+    encodeSlotCount = slots;
+    return true;
+}
+
+/**
+* Returns the encoded frame for the given pixels from the cache, encoding it into the
+* next slot if it isn't cached yet.
+*/
+uint8_t* ParticlePixels::encodeCached(const PixCol* source, int sourceOffset, byte sourceBlend) {
+    size_t pixelBytes = pixelCount * sizeof(PixCol);
+    size_t slotSize = pixelBytes + spiArraySize;
+    uint32_t hash = pixelHash(source, pixelCount);
+    for (int i = 0; i < encodeSlotCount; i++) {
+        EncodeSlot &slot = encodeSlots[i];
+        uint8_t* cached = encodeCache + i * slotSize;
+        if (slot.valid && slot.hash == hash && slot.offset == sourceOffset && slot.blend == sourceBlend
+                && memcmp(cached, source, pixelBytes) == 0) {
+            encodeCacheHits++;
+            return cached + pixelBytes;
+        }
+    }
+    encodeCacheMisses++;
+    int i = nextEncodeSlot;
+    nextEncodeSlot = (nextEncodeSlot + 1) % encodeSlotCount;
+    uint8_t* cached = encodeCache + i * slotSize;
+    memcpy(cached, source, pixelBytes);
+    encodeFrame(cached + pixelBytes, source, sourceOffset, sourceBlend);
+    encodeSlots[i] = { hash, sourceOffset, sourceBlend, true };
+    return cached + pixelBytes;
 }
 
 /**
@@ -65,11 +197,25 @@ inline void encodeByteTo3xBits(uint8_t byte, uint8_t* target) {
 * This allows other pins on the SPI interface to be used for different purposes
 * while dedicating MOSI for LED control.
 * 
-* @note SCK and MISO pins are freed for GPIO use after setup
+* Clocked types (see PIXEL_TYPE_CLOCKED) use SPI normally, with SCK driving the LED clock.
+* 
+* @note SCK and MISO pins are freed for GPIO use after setup (single-wire types)
 * @note Clock speed must be set after begin() due to Device OS 5.7.0 requirement
 * @note Uses PIN_INVALID to prevent automatic SS pin configuration
 */
 void ParticlePixels::setup() {
+    if (!spi) return;  // unsupported type or interface, see getStatus()
+    if (clocked) {
+        // clocked types need SCK as well, standard SPI mode 0 without a chip select
+        hal_spi_config_t spi_config = {};
+        spi_config.size = sizeof(spi_config);
+        spi_config.version = HAL_SPI_CONFIG_VERSION;
+        hal_spi_begin_ext(spi->interface(), SPI_MODE_MASTER, PIN_INVALID, &spi_config);
+        spi->setClockSpeed(CLOCKED_CLOCK_SPEED);
+        spi->setBitOrder(MSBFIRST);
+        spi->setDataMode(SPI_MODE0);
+        return;
+    }
     pin_t sckPin = SCK;
     pin_t misoPin = MISO;
     if (spi->interface() == HAL_SPI_INTERFACE2) {
@@ -114,6 +260,8 @@ void ParticlePixels::setup() {
 *    - '0' bit encoded as '100'
 *    - RGB pixels: 9 bytes output per pixel (3 colors * 3 bytes each)
 *    - RGBW pixels: 12 bytes output per pixel (4 colors * 3 bytes each)
+*    - Clocked types (APA102, SK9822, HD107S) instead send 4 raw bytes per pixel
+*      (brightness + 3 colors) between a start and an end frame
 * 
 * 2. SPI transmission:
 *    - Sends complete buffer including reset periods
@@ -127,44 +275,169 @@ void ParticlePixels::setup() {
 * @note Returns early if no pixels or no update needed
 */
 void ParticlePixels::update(bool forceRefresh) {
-    if (!pixels || (!refresh && !forceRefresh)) return;
+    if (!pixels || !(spiArray || chunkRing)) return;
 
-    // start LED data after reset offset, yay pointer math
-    uint8_t* pos = spiArray + resetOffset;
-    uint8_t* colorData = (uint8_t*) pixels;
-
-    // Convert RGB(W) pixel data into LED control SPI bit patterns
-    // Each LED color bit needs to be expanded into a 3-bit SPI pattern:
-    // LED '1' bit -> SPI '110'
-    // LED '0' bit -> SPI '100'
-    //
-    // Example for one RGB pixel:
-    // Input: [R:0xA5][G:0x1F][B:0xC0]  (3 bytes, one per color)
-    // Output: [R:x3][G:x3][B:x3]       (9 bytes total, each input byte encoded to 3 bytes)
-    //
-    // For RGBW pixels, adds a 4th white component, producing 12 output bytes per pixel
-    // The color order (rOffset,gOffset,bOffset,wOffset) determines final byte arrangement (e.g. ORDER_GRBW)
-    // but the incoming colorData is always RGB (3 bytes per pixel) or RGBW (4 bytes per pixel)
-    volatile size_t pixelStart = 0;
-    for (int i = 0; i < pixelCount; i++) {
-        pixelStart = i * PIXEL_BYTES_PER_COLOR;
-        encodeByteTo3xBits(colorData[pixelStart], pos+rOffset);  // R
-        encodeByteTo3xBits(colorData[pixelStart+1], pos+gOffset);  // G
-        encodeByteTo3xBits(colorData[pixelStart+2], pos+bOffset);  // B
-        if (wOffset) {
-            // if pixel data has a 4th byte, encode it otherwise encode 0
-            encodeByteTo3xBits((PIXEL_BYTES_PER_COLOR == 4) ? colorData[pixelStart+3] : 0, pos+wOffset);  // W
-            pos += 12; // 4 color bytes * 3 led bits per color bit
-        } else {
-            pos += 9; // 3 color bytes * 3 led bits per color bit
+    const PixCol* source = pixels;
+    int sourceOffset = offset;
+    byte sourceBlend = offsetBlend;
+    bool pending = false;
+    if (exchange) {
+        // this thread's frame is published like any other writer's (kept pending if a writer is busy)
+        if (refresh) pending = !exchange->publish(pixels, offset, offsetBlend);
+        if (!exchange->acquire() && !forceRefresh && !changes.keepAliveDue()) {
+            refresh = pending;
+            return;
         }
+        source = exchange->front();
+        sourceOffset = exchange->frontOffset();
+        sourceBlend = exchange->frontOffsetBlend();
     }
-    
+    else if (!refresh && !forceRefresh && !changes.keepAliveDue()) return;
+
+    // a 16-bit frame isn't compared, only the 8-bit pixels are kept for that
+    if (!pixels16 && changes.skip(source, sourceOffset, sourceBlend, forceRefresh)) {
+        refresh = pending;
+        return;
+    }
+
+    if (chunkRing) {
+        encodeChunked(source, sourceOffset, sourceBlend);
+        refresh = pending;
+        return;
+    }
+
+    uint8_t* frame = spiArray;
+    if (encodeSlotCount && !pixels16) {
+        frame = encodeCached(source, sourceOffset, sourceBlend);
+    }
+    else {
+        encodeFrame(spiArray, source, sourceOffset, sourceBlend);
+    }
+
     spi->beginTransaction();
-    spi->transfer(spiArray, nullptr, spiArraySize, nullptr);
+    spi->transfer(frame, nullptr, spiArraySize, nullptr);
     spi->endTransaction();
 
-    refresh = false;
+    refresh = pending;
+}
+
+/**
+* Encodes the source pixels (pixelCount, shown from the given ring offset) into the given SPI
+* buffer of spiArraySize bytes (see update()).
+*/
+void ParticlePixels::encodeFrame(uint8_t* frame, const PixCol* source, int sourceOffset, byte sourceBlend) {
+    // start LED data after reset offset, yay pointer math
+    uint8_t* pos = frame + resetOffset;
+    PixOutputWalk walk(source, pixelCount, mapping, sourceOffset, sourceBlend, hsvTable);
+    walk.wide = pixels16;
+    encodePixels(pos, walk, outputCount);
+}
+
+/**
+* Encodes the next count pixels of the walk into SPI bit patterns starting at pos.
+*/
+void ParticlePixels::encodePixels(uint8_t* pos, PixOutputWalk& walk, int count) {
+    if (clocked) {
+        if (gamma16) encodeHd108Pixels(pos, walk, count, rOffset, gOffset, bOffset, brightness, *gamma16);
+        else encodeClockedPixels(pos, walk, count, rOffset, gOffset, bOffset, brightness);
+        return;
+    }
+    if (gamma16) {
+        encodeSpiPixels16(pos, walk, count, rOffset, gOffset, bOffset, *gamma16);
+        return;
+    }
+    if (spiEncoder) {
+        // format fixed at compile time (see FixedParticlePixels)
+        spiEncoder(pos, walk, count);
+        return;
+    }
+    // each LED color bit is expanded into a 3-bit SPI pattern, '1' -> '110', '0' -> '100'
+    encodeSpiPixelsAt(pos, walk, count, rOffset, gOffset, bOffset, wOffset);
+}
+
+ParticlePixels* ParticlePixels::chunkStrips[HAL_PLATFORM_SPI_NUM] = {};
+
+/**
+* Encodes and sends a frame chunk by chunk (see setChunkedEncode()), returns once the trailing
+* reset was sent like the blocking transfer of a full frame.
+*/
+void ParticlePixels::encodeChunked(const PixCol* source, int sourceOffset, byte sourceBlend) {
+    chunkStrips[spi->interface()] = this;
+    spi->beginTransaction();
+    for (int resends = 0; !sendChunks(source, sourceOffset, sourceBlend, resends < SPI_CHUNK_RESENDS); resends++) {
+        chunkResends++;
+    }
+    spi->endTransaction();
+}
+
+/**
+* Sends the frame once (see encodeChunked()), false if an underrun in the LED data was long enough
+* to latch part of it and the transfer was ended there so the frame can be sent again (only if
+* resend). The leading reset of the next frame latches what was sent.
+*/
+bool ParticlePixels::sendChunks(const PixCol* source, int sourceOffset, byte sourceBlend, bool resend) {
+    PixOutputWalk walk(source, pixelCount, mapping, sourceOffset, sourceBlend, hsvTable);
+    walk.wide = pixels16;
+    chunksSent = 0;
+    chunksReady = 1;
+    chunkSending = true;
+    sendChunk(0);  // leading reset, the first chunk is encoded meanwhile
+
+    // transfer n is chunk n of LED data, chunkCount + 1 the trailing reset
+    for (int chunk = 1; chunk <= chunkCount + 1; chunk++) {
+        if (chunk <= chunkCount) {
+            // the ring slot is free once the chunk SPI_CHUNK_RING before it has been sent
+            while (chunksSent <= chunk - SPI_CHUNK_RING);
+            int count = (chunk < chunkCount) ? chunkPixels : outputCount - (chunkCount - 1) * chunkPixels;
+            encodePixels(chunkRing + ((chunk - 1) % SPI_CHUNK_RING) * chunkSize, walk, count);
+        }
+        // with the DMA interrupt between the two it could find the old chunksReady and then go idle
+        int irq = HAL_disable_irq();
+        chunksReady = chunk + 1;
+        bool idle = !chunkSending.exchange(true);
+        HAL_enable_irq(irq);
+        if (idle) {
+            // the previous transfer already completed, restart from here
+            chunkUnderruns++;
+            // clocked LEDs only move on the clock, a longer leading or trailing reset is harmless
+            bool latched = chunk > 1 && chunk <= chunkCount && !clocked && micros() - chunkIdleMicros >= SPI_LATCH_MICROS;
+            if (latched && resend) {
+                chunkSending = false;
+                return false;
+            }
+            sendChunk(chunk);
+        }
+    }
+    while (chunkSending);
+    return true;
+}
+
+/**
+* Starts the DMA transfer of the leading reset, a chunk of LED data or the trailing reset.
+*/
+void ParticlePixels::sendChunk(int chunk) {
+    const uint8_t* data = chunkRing + SPI_CHUNK_RING * chunkSize;  // zeros
+    size_t length = (chunk == 0) ? resetOffset : endOffset;
+    if (chunk >= 1 && chunk <= chunkCount) {
+        data = chunkRing + ((chunk - 1) % SPI_CHUNK_RING) * chunkSize;
+        int count = (chunk < chunkCount) ? chunkPixels : outputCount - (chunkCount - 1) * chunkPixels;
+        length = count * ledSize;
+    }
+    spi->transfer(data, nullptr, length, spi->interface() == HAL_SPI_INTERFACE2 ? chunkSent1 : chunkSent0);
+}
+
+/**
+* DMA completion (interrupt context), starts the next transfer if it is ready.
+*/
+void ParticlePixels::chunkSent(ParticlePixels* strip) {
+    int sent = ++strip->chunksSent;
+    if (sent < strip->chunksReady) {
+        strip->sendChunk(sent);
+    }
+    else {
+        strip->chunkIdleMicros = micros();
+        strip->chunkSending = false;
+    }
 }
 
 #endif
\ No newline at end of file
@@ -3,10 +3,21 @@
 
 #include "Particle.h"
 #include "pixeleds-library.h"
+#include "pixeleds-encode.h"
 
-#define SPI_BITS_FACTOR 3
 #define SPI_CLOCK_SPEED 3125000
 
+// 300us reset period sent before and after the LED data, 3.125mhz / 8 = 0.390625 bytes per microsecond
+#define SPI_RESET_BYTES (300 * 4 / 10)
+
+// chunked output (see ParticlePixels::setChunkedEncode), encoded chunks in flight or ready to send
+#define SPI_CHUNK_RING 3
+#define SPI_CHUNK_PIXELS 32
+// a low period this long in the middle of a chunked frame can latch part of it (50us less the time to restart),
+// the frame is then sent again up to SPI_CHUNK_RESENDS times
+#define SPI_LATCH_MICROS 40
+#define SPI_CHUNK_RESENDS 2
+
 
 
 /**
@@ -16,64 +27,201 @@
  * @param pixels Pointer to an array of PixCol objects representing the colors of the LEDs.
  * @param pixelCount The number of LEDs in the strip.
  * @param pixelPin The pin used for SPI communication (0 for SPI, 1 for SPI1) -- use the SPI MOSI pin.
- * @param type The type of LED strip (default is WS2812B, can also be SK6812W).
+ * @param type The type of LED strip (default is WS2812B, can also be SK6812W, WS2816, APA102, SK9822, HD107S or HD108).
  * @param order The color order of the LEDs (default is ORDER_RGB).
+ * @param spiMemory Optional buffer for the encoded frame (or the chunk ring), used instead of the heap, must outlive the strip.
+ * @param spiMemorySize Size of spiMemory, output that doesn't fit is refused.
  * 
- * @note Only WS2812B and SK6812W types are supported on the Photon 2.
+ * @note WS2812B, SK6812W and WS2816 use MOSI only, each data bit is sent as 3 SPI bits at 3.125MHz.
+ * @note APA102, SK9822, HD107S and HD108 are clocked by SCK and sent as raw bytes at CLOCKED_CLOCK_SPEED.
+ * @note WS2816 and HD108 have 16 bits per channel, the pixels are expanded with a PixGamma16 table.
  * 
  * @warning If an unsupported type is provided, an error will be logged and the constructor will return early.
  */
 class ParticlePixels {
 public:
-    ParticlePixels(PixCol* pixels, int pixelCount, byte pixelPin, byte type = WS2812B, byte order = ORDER_RGB) 
-        : pixels(pixels), pixelCount(pixelCount), refresh(true)
+    ParticlePixels(PixCol* pixels, int pixelCount, byte pixelPin, byte type = WS2812B, byte order = ORDER_RGB,
+                   uint8_t* spiMemory = nullptr, size_t spiMemorySize = 0) 
+        : pixels(pixels), pixelCount(pixelCount), mapping(OUTPUT_DIRECT), outputCount(pixelCount), offset(0), offsetBlend(0), spi(nullptr), refresh(true), spiArray(nullptr),
+          spiMemory(spiMemory), spiMemorySize(spiMemorySize)
     {
-        if (type != WS2812B && type != SK6812W) {
-            Log.error("Only WS2812B and SK6812W supported on Photon 2");
+        if (!isSupported(type)) {
+            Log.error("Only WS2812B, SK6812W, WS2816, APA102, SK9822, HD107S and HD108 supported on Photon 2");
+            status = PIXELEDS_UNSUPPORTED;
             return;
         }
         spi = pixelPin == 0 ? &SPI : &SPI1;
         if (spi->interface() >= HAL_PLATFORM_SPI_NUM) {
             Log.error("SPI/SPI1 interface not defined!");
+            spi = nullptr;
+            status = PIXELEDS_NO_INTERFACE;
             return; 
         }
-        bytesPerLED = (order>>6 & 0b11) ? 4 : 3; // 3 bytes for RGB, 4 bytes for RGBW
-        // Extract offsets from order parameter (each 2 bits represents position)
-        rOffset = SPI_BITS_FACTOR * (uint8_t)(order & 0b11);    // R offset
-        gOffset = SPI_BITS_FACTOR * (uint8_t)(order>>2 & 0b11); // G offset
-        bOffset = SPI_BITS_FACTOR * (uint8_t)(order>>4 & 0b11); // B offset
-        wOffset = SPI_BITS_FACTOR * (uint8_t)(order>>6 & 0b11); // W offset
+        clocked = PIXEL_TYPE_CLOCKED(type);
+        if (PIXEL_TYPE_16BIT(type)) {
+            gamma16 = &PixGamma16::standard();
+        }
+        if (type == HD108) {
+            // [header:2][3 x 16-bit colors] raw, a longer start frame
+            bytesPerLED = 6;
+            ledSize = HD108_BYTES_PER_LED;
+            rOffset = 2 + 2 * (uint8_t)(order & 0b11);
+            gOffset = 2 + 2 * (uint8_t)(order>>2 & 0b11);
+            bOffset = 2 + 2 * (uint8_t)(order>>4 & 0b11);
+            wOffset = 0;
+            resetOffset = HD108_START_BYTES;
+            allocateSpiArray();
+            return;
+        }
+        if (clocked) {
+            // [0b111 + brightness][3 colors] raw, a start frame of zeros, no reset period
+            bytesPerLED = 3;
+            ledSize = CLOCKED_BYTES_PER_LED;
+            rOffset = 1 + (uint8_t)(order & 0b11);
+            gOffset = 1 + (uint8_t)(order>>2 & 0b11);
+            bOffset = 1 + (uint8_t)(order>>4 & 0b11);
+            wOffset = 0;
+            resetOffset = CLOCKED_START_BYTES;
+            allocateSpiArray();
+            return;
+        }
+        if (type == WS2816) {
+            // 2 bytes per color, no white
+            bytesPerLED = WS2816_BYTES_PER_LED;
+            rOffset = 2 * SPI_BITS_FACTOR * (uint8_t)(order & 0b11);
+            gOffset = 2 * SPI_BITS_FACTOR * (uint8_t)(order>>2 & 0b11);
+            bOffset = 2 * SPI_BITS_FACTOR * (uint8_t)(order>>4 & 0b11);
+            wOffset = 0;
+        }
+        else {
+            bytesPerLED = (order>>6 & 0b11) ? 4 : 3; // 3 bytes for RGB, 4 bytes for RGBW
+            // Extract offsets from order parameter (each 2 bits represents position)
+            rOffset = SPI_BITS_FACTOR * (uint8_t)(order & 0b11);    // R offset
+            gOffset = SPI_BITS_FACTOR * (uint8_t)(order>>2 & 0b11); // G offset
+            bOffset = SPI_BITS_FACTOR * (uint8_t)(order>>4 & 0b11); // B offset
+            wOffset = SPI_BITS_FACTOR * (uint8_t)(order>>6 & 0b11); // W offset
+        }
+        ledSize = bytesPerLED * SPI_BITS_FACTOR;
         // 0.4 bytes per microsecond .... 3.125mhz / 8 = 0.390625 bytes per microsecond
         // 300us * 0.4 bytes per microsecond = 120 bytes (or 960 bits)
         // 50us * 0.4 bytes per microsecond = 20 bytes (or 160 bits)
-        resetOffset = 300 * 4 / 10;
-        // bytes per color, spi bits per color bit, plus reset offset (start and end)
-        // e.g. 10 pixels * 3 bytes per pixel * 3 spi bits per color bit + 300us reset = (10 * 3 * 3) + 120 + 120 = 540 bytes 
-        spiArraySize = (pixelCount * bytesPerLED * SPI_BITS_FACTOR) + resetOffset + resetOffset;
-        spiArray = (uint8_t*) malloc(spiArraySize);
-        if (spiArray == NULL) { 
-            Log.error("Not enough memory available!"); 
-            return;
-        }
-        memset(spiArray, 0, spiArraySize);  // clear the array
+        resetOffset = SPI_RESET_BYTES;
+        allocateSpiArray();
     }
 
     ~ParticlePixels() {
-        if (spiArray) {
+        setEncodeCache(0);
+        if (!spiMemory) {
             free(spiArray);
+            free(chunkRing);
         }
         if (spi) {
             spi->end();
         }
     }
 
+    // bytes of the encoded frame for outputCount LEDs of the type and color order, and the part of it that is
+    // reset periods or start and end frames (see pixeledsFootprint)
+    static constexpr size_t encodeBytes(byte type, byte order, int outputCount) {
+        return type == HD108 ? HD108_START_BYTES + outputCount * HD108_BYTES_PER_LED + clockedEndBytes(outputCount)
+             : PIXEL_TYPE_CLOCKED(type) ? CLOCKED_START_BYTES + outputCount * CLOCKED_BYTES_PER_LED + clockedEndBytes(outputCount)
+             : type == WS2816 ? outputCount * WS2816_BYTES_PER_LED * SPI_BITS_FACTOR + 2 * SPI_RESET_BYTES
+             : outputCount * ((order >> 6 & 0b11) ? 4 : 3) * SPI_BITS_FACTOR + 2 * SPI_RESET_BYTES;
+    }
+    static constexpr size_t resetBytes(byte type, int outputCount) {
+        return type == HD108 ? HD108_START_BYTES + clockedEndBytes(outputCount)
+             : PIXEL_TYPE_CLOCKED(type) ? CLOCKED_START_BYTES + clockedEndBytes(outputCount)
+             : 2 * SPI_RESET_BYTES;
+    }
+    static constexpr bool isSupported(byte type) {
+        return type == WS2812B || type == SK6812W || type == WS2816 || PIXEL_TYPE_CLOCKED(type);
+    }
+
     void setup();
     void update(bool forceRefresh = false);
     inline void triggerRefresh() { refresh = true; }
 
+    // PIXELEDS_OK, or why nothing can be sent (PIXELEDS_UNSUPPORTED, PIXELEDS_NO_INTERFACE, PIXELEDS_NO_MEMORY)
+    int getStatus() { return status; }
+    // bytes allocated for the encoded frame (or the chunk ring) and the encode cache, of it the reset periods
+    size_t getEncodeBytes();
+    size_t getResetBytes() { return spiArray ? resetOffset + endOffset : (chunkRing ? max(resetOffset, endOffset) : 0); }
+    bool isRefreshPending() { return refresh || changes.keepAliveDue(); }
+    bool hasFrameExchange() { return exchange != nullptr; }
+
+    // skips frames identical to the one sent last when enabled, off by default
+    PixChangeDetector& getChangeDetector() { return changes; }
+
     int getPixelCount() { return pixelCount; }
     PixCol* getPixels() { return pixels; }
 
+    // encode from a different buffer of pixelCount pixels (e.g. a transition frame)
+    void setPixels(PixCol* pixels) {
+        this->pixels = pixels;
+        triggerRefresh();
+    }
+
+    // emit the pixels tiled, mirrored or reversed (OUTPUT_*) on a strip of outputCount pixels
+    bool setOutputMapping(byte mapping, int outputCount = 0);
+    int getOutputCount() { return outputCount; }
+
+    // keep up to maxBytes of encoded frames, a frame that is already encoded is transmitted without
+    // encoding it again (0 disables the cache), call again after setOutputMapping()
+    bool setEncodeCache(size_t maxBytes);
+    unsigned long getEncodeCacheHits() { return encodeCacheHits; }
+    unsigned long getEncodeCacheMisses() { return encodeCacheMisses; }
+
+    // encode the frame in chunks of chunkPixels just ahead of the SPI DMA instead of into a full frame
+    // buffer, RAM stays at SPI_CHUNK_RING chunks whatever the strip length (0 uses the full buffer)
+    bool setChunkedEncode(int chunkPixels = SPI_CHUNK_PIXELS);
+    // chunks that were not encoded before the previous one was sent (the line stayed low briefly)
+    unsigned long getChunkUnderruns() { return chunkUnderruns; }
+    // frames sent again because an underrun was long enough to latch part of them
+    unsigned long getChunkResends() { return chunkResends; }
+
+    // 5-bit global brightness (0-31) sent with every LED of a clocked strip (APA102, SK9822, HD107S, HD108)
+    void setGlobalBrightness(byte brightness) {
+        this->brightness = min(brightness, (byte) CLOCKED_MAX_BRIGHTNESS);
+        invalidateEncodeCache();
+    }
+
+    // gamma table expanding the 8-bit pixels for 16-bit strips (WS2816, HD108), must outlive the strip
+    void setGamma16(const PixGamma16* gamma) {
+        if (gamma16 && gamma) gamma16 = gamma;
+        invalidateEncodeCache();
+    }
+
+    // send this 16-bit frame of pixelCount pixels (must outlive the strip) instead of the pixels expanded by the gamma
+    // table, false if the strip isn't 16-bit (WS2816, HD108); nullptr sends the pixels again
+    bool setPixels16(const PixCol16* pixels16) {
+        if (pixels16 && !gamma16) return false;
+        this->pixels16 = pixels16;
+        invalidateEncodeCache();
+        return true;
+    }
+    const PixGamma16* getGamma16() const { return gamma16; }
+
+    // the pixels are PixHsv converted with the table while encoding, nullptr for RGB pixels (must outlive the strip)
+    void setHsvTable(const PixHsvTable* table) {
+        hsvTable = table;
+        invalidateEncodeCache();
+    }
+    const PixHsvTable* getHsvTable() const { return hsvTable; }
+
+    // encode the latest frame published to the exchange, frames set here are published to it
+    void setFrameExchange(PixFrameExchange* exchange) {
+        this->exchange = exchange;
+        triggerRefresh();
+    }
+
+    // start the output at the given ring offset, blending towards the next pixel (0-255)
+    void setOffset(int offset, byte blend = 0) {
+        if (offset == this->offset && blend == offsetBlend) return;
+        this->offset = offset;
+        this->offsetBlend = blend;
+        triggerRefresh();
+    }
+
     void setPixelColor(int pixel, PixCol pixelColor) {
         if (pixel >= pixelCount) return;
         pixels[pixel] = pixelColor;
@@ -85,22 +233,121 @@ public:
         triggerRefresh();
     };
 
+protected:
+    // specialized encoder for a format fixed at compile time, nullptr uses the runtime offsets
+    PixSpiEncoder* spiEncoder = nullptr;
 
 private:
+    // the cached and last sent frames were encoded with other settings, encode and send the frame again
+    void invalidateEncodeCache() {
+        for (int i = 0; i < encodeSlotCount; i++) encodeSlots[i].valid = false;
+        changes.invalidate();
+        triggerRefresh();
+    }
+
+    bool allocateSpiArray();
+    void encodeFrame(uint8_t* frame, const PixCol* source, int sourceOffset, byte sourceBlend);
+    uint8_t* encodeCached(const PixCol* source, int sourceOffset, byte sourceBlend);
+    void encodePixels(uint8_t* pos, PixOutputWalk& walk, int count);
+    void encodeChunked(const PixCol* source, int sourceOffset, byte sourceBlend);
+    bool sendChunks(const PixCol* source, int sourceOffset, byte sourceBlend, bool resend);
+    void sendChunk(int chunk);
+    static void chunkSent(ParticlePixels* strip);
+    static void chunkSent0() { chunkSent(chunkStrips[0]); }
+    static void chunkSent1() { chunkSent(chunkStrips[1]); }
+    static ParticlePixels* chunkStrips[HAL_PLATFORM_SPI_NUM];
+
     // pass in constructor
     PixCol* pixels;
     int pixelCount;
+    byte mapping;
+    int outputCount;
+    int offset;
+    byte offsetBlend;
     SPIClass* spi;
+    PixFrameExchange* exchange = nullptr;
 
     // determines if update() should refresh the pixels
     bool refresh;
+    int status = PIXELEDS_OK;
+
+    // change detection (see getChangeDetector)
+    PixChangeDetector changes;
     
     // computed at initialization
+    bool clocked = false;
+    byte brightness = CLOCKED_MAX_BRIGHTNESS;
+    const PixGamma16* gamma16 = nullptr;   // set for 16-bit types
+    const PixCol16* pixels16 = nullptr;    // 16-bit frame sent instead of the pixels
+    const PixHsvTable* hsvTable = nullptr; // set for HSV pixels
     uint8_t bytesPerLED;
+    uint8_t ledSize;                  // encoded bytes per LED
     uint8_t rOffset, gOffset, bOffset, wOffset; 
-    size_t resetOffset;
+    size_t resetOffset;               // zeros before the LED data (reset period or start frame)
+    size_t endOffset;                 // zeros after the LED data (reset period or end frame)
     size_t spiArraySize;
     uint8_t* spiArray;
+    uint8_t* spiMemory;               // external buffer for spiArray or chunkRing, never freed
+    size_t spiMemorySize;
+
+    // encoded frame cache, each slot is [source pixels][encoded frame of spiArraySize]
+    struct EncodeSlot {
+        uint32_t hash;
+        int offset;
+        byte blend;
+        bool valid;
+    };
+    uint8_t* encodeCache = nullptr;
+    EncodeSlot* encodeSlots = nullptr;
+    int encodeSlotCount = 0;
+    int nextEncodeSlot = 0;
+    unsigned long encodeCacheHits = 0;
+    unsigned long encodeCacheMisses = 0;
+
+    // chunked output: the leading reset, chunkCount chunks of LED data and the trailing reset are
+    // sent one transfer each, the DMA completion starts the next transfer if it is encoded
+    uint8_t* chunkRing = nullptr;           // SPI_CHUNK_RING chunks, then max(resetOffset, endOffset) zeros
+    int chunkPixels = 0;
+    size_t chunkSize = 0;
+    int chunkCount = 0;
+    std::atomic<int> chunksReady{0};       // transfers that can be sent (0 = leading reset)
+    std::atomic<int> chunksSent{0};        // transfers completed
+    std::atomic<bool> chunkSending{false};
+    std::atomic<unsigned long> chunkIdleMicros{0};  // when the last transfer completed with nothing ready
+    unsigned long chunkUnderruns = 0;
+    unsigned long chunkResends = 0;
+};
+
+
+/**
+ * @class FixedParticlePixels
+ * @brief A ParticlePixels strip with the LED type and color order fixed at compile time.
+ *
+ * The encoder is specialized for the format (see PixLedFormat), the channel offsets, bytes per LED
+ * and the white channel are constants. An unsupported type or order fails to compile. Use
+ * ParticlePixels when the format is only known at runtime.
+ *
+ * Example Usage:
+ * @code
+ * PixCol pixels[300];
+ * FixedParticlePixels<WS2812B, ORDER_GRB> strip(pixels, 300, MOSI);
+ * Pixeleds px(&strip);
+ * @endcode
+ */
+template <byte TYPE, byte ORDER>
+class FixedParticlePixels : public ParticlePixels {
+public:
+    typedef PixLedFormat<TYPE, ORDER> Format;
+
+    // bytes of the encoded frame for outputCount LEDs (the size of spiMemory for a heap-free strip)
+    static constexpr size_t spiBufferSize(int outputCount) {
+        return encodeBytes(TYPE, ORDER, outputCount);
+    }
+
+    FixedParticlePixels(PixCol* pixels, int pixelCount, byte pixelPin, uint8_t* spiMemory = nullptr, size_t spiMemorySize = 0)
+        : ParticlePixels(pixels, pixelCount, pixelPin, TYPE, ORDER, spiMemory, spiMemorySize) {
+        spiEncoder = &encodeSpiPixels<Format>;
+    }
 };
 
 #endif
\ No newline at end of file
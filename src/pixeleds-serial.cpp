@@ -0,0 +1,135 @@
+/*
+Copyright 2024 The Brynwood Team, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "pixeleds-serial.h"
+
+// little endian helper
+static inline uint16_t getWord(const uint8_t *pos) { return pos[0] | (pos[1] << 8); }
+
+
+bool PixSerial::receive() {
+    int available;
+    while ((available = stream.available()) > 0) {
+        switch (state) {
+            case HEADER: receiveHeader(available); break;
+            case PAYLOAD: receivePayload(available); break;
+            case CHECKSUM: if (receiveChecksum(available)) return true; break;
+        }
+    }
+    return false;
+}
+
+void PixSerial::receiveHeader(int available) {
+    int length = min(available, PIXSERIAL_HEADER_SIZE - headerUsed);
+    stream.readBytes((char*) header + headerUsed, length);
+    headerUsed += length;
+    bytes += length;
+
+    // skip to the next "PX" if out of sync
+    int start = 0;
+    while (start < headerUsed && (header[start] != 'P' || (start + 1 < headerUsed && header[start + 1] != 'X'))) start++;
+    if (start) {
+        memmove(header, header + start, headerUsed - start);
+        headerUsed -= start;
+        skipped += start;
+    }
+    if (headerUsed < PIXSERIAL_HEADER_SIZE) return;
+
+    headerUsed = 0;
+    flags = header[2];
+    position = getWord(header + 3) * sizeof(PixCol);
+    remaining = getWord(header + 5);
+    bufferUsed = 0;
+    sum1 = sum2 = 0;
+    checksum(header, PIXSERIAL_HEADER_SIZE);
+    state = remaining ? PAYLOAD : CHECKSUM;
+}
+
+void PixSerial::receivePayload(int available) {
+    size_t total = pixeleds.getPixelCount() * sizeof(PixCol);
+    uint8_t *pixels = (uint8_t*) pixeleds.getPixels();
+    size_t length = min((size_t) available, remaining);
+
+    if (flags & PIXSERIAL_FLAG_RLE) {
+        length = min(length, (size_t) (PIXSERIAL_BUFFER_SIZE - bufferUsed));
+        stream.readBytes((char*) buffer + bufferUsed, length);
+        checksum(buffer + bufferUsed, length);
+        bufferUsed += length;
+
+        // fill the complete runs, keep a partial run for the next read
+        int idx = 0;
+        for (; idx + 4 <= bufferUsed; idx += 4) {
+            PixCol color(buffer[idx + 1], buffer[idx + 2], buffer[idx + 3]);
+            size_t end = min(position + buffer[idx] * sizeof(PixCol), total);
+            for (size_t pos = position; pos < end; pos += sizeof(PixCol)) { *(PixCol*) (pixels + pos) = color; }
+            position += buffer[idx] * sizeof(PixCol);
+        }
+        bufferUsed -= idx;
+        memmove(buffer, buffer + idx, bufferUsed);
+    }
+    else {
+        // raw colors go straight into the pixels, anything past the strip is read into the buffer and dropped
+        uint8_t *dest = buffer;
+        if (position < total) {
+            length = min(length, total - position);
+            dest = pixels + position;
+        }
+        else {
+            length = min(length, (size_t) PIXSERIAL_BUFFER_SIZE);
+        }
+        stream.readBytes((char*) dest, length);
+        checksum(dest, length);
+        position += length;
+    }
+
+    remaining -= length;
+    bytes += length;
+    if (remaining == 0) state = CHECKSUM;
+}
+
+bool PixSerial::receiveChecksum(int available) {
+    int length = min(available, PIXSERIAL_CHECKSUM_SIZE - headerUsed);
+    stream.readBytes((char*) header + headerUsed, length);
+    headerUsed += length;
+    bytes += length;
+    if (headerUsed < PIXSERIAL_CHECKSUM_SIZE) return false;
+
+    headerUsed = 0;
+    state = HEADER;
+    if (header[0] != sum1 || header[1] != sum2 || bufferUsed) {
+        errors++;
+        return false;
+    }
+    if (!(flags & PIXSERIAL_FLAG_SHOW)) return false;
+    pixeleds.showPixels();
+    frames++;
+    return true;
+}
+
+// Fletcher-16, sums are reduced every 4096 bytes so they don't overflow
+void PixSerial::checksum(const uint8_t *data, size_t length) {
+    while (length > 0) {
+        size_t block = min(length, (size_t) 4096);
+        for (size_t idx = 0; idx < block; idx++) {
+            sum1 += data[idx];
+            sum2 += sum1;
+        }
+        sum1 %= 255;
+        sum2 %= 255;
+        data += block;
+        length -= block;
+    }
+}
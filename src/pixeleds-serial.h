@@ -0,0 +1,96 @@
+/*
+Copyright 2024 The Brynwood Team, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include "Particle.h"
+#include "pixeleds-library.h"
+
+#define PIXSERIAL_HEADER_SIZE 7
+#define PIXSERIAL_CHECKSUM_SIZE 2
+#define PIXSERIAL_BUFFER_SIZE 64
+
+#define PIXSERIAL_FLAG_RLE 0x01     // payload is [count:1][r][g][b] runs instead of raw colors
+#define PIXSERIAL_FLAG_SHOW 0x02    // show the pixels once this frame is received
+
+
+
+/**
+ * @class PixSerial
+ * @brief Receives frames rendered on a PC over a serial port (e.g. USB Serial), see
+ * tools/pixserial-send.py.
+ *
+ * Frame layout (little endian):
+ * "PX" [flags:1] [offset:2] [length:2] then length bytes of payload and a Fletcher-16 checksum
+ * [sum1:1] [sum2:1] of everything before it. The payload is written to the pixels starting at
+ * pixel offset, either raw r, g, b colors or (PIXSERIAL_FLAG_RLE) runs of [count:1][r][g][b].
+ * A frame can update part of the strip; the pixels are shown once a frame with
+ * PIXSERIAL_FLAG_SHOW passes its checksum.
+ *
+ * receive() never waits. It reads what is available in bulk, with raw payloads read straight into
+ * the pixel buffer, and returns as soon as a frame is shown so that the following update()
+ * emits exactly that frame. A frame that fails its checksum isn't shown, but its pixels may
+ * already be written; the next frame replaces them.
+ *
+ * Example Usage:
+ * @code
+ * PixSerial receiver(px);
+ *
+ * void setup() {
+ *     Serial.begin();
+ *     px.setup();
+ * }
+ *
+ * void loop() {
+ *     receiver.receive();
+ *     px.update(millis());
+ * }
+ * @endcode
+ */
+class PixSerial {
+public:
+    PixSerial(Pixeleds &pixeleds, Stream &stream = Serial) : pixeleds(pixeleds), stream(stream) { }
+
+    // read the available bytes into the pixels, returns true if a frame was shown
+    bool receive();
+
+    // frames shown, bytes received, frames with a bad checksum, bytes skipped looking for the start of a frame
+    unsigned long frames = 0;
+    unsigned long bytes = 0;
+    unsigned long errors = 0;
+    unsigned long skipped = 0;
+
+private:
+    void receiveHeader(int available);
+    void receivePayload(int available);
+    bool receiveChecksum(int available);
+    void checksum(const uint8_t *data, size_t length);
+
+    Pixeleds &pixeleds;
+    Stream &stream;
+
+    enum { HEADER, PAYLOAD, CHECKSUM } state = HEADER;
+    uint8_t header[PIXSERIAL_HEADER_SIZE];
+    int headerUsed = 0;
+    uint8_t flags = 0;
+    size_t position = 0;              // byte position in the pixels of the next payload byte
+    size_t remaining = 0;             // payload bytes still to be read
+    uint32_t sum1 = 0, sum2 = 0;
+
+    // rle runs (and raw colors outside the strip) go through a small buffer
+    uint8_t buffer[PIXSERIAL_BUFFER_SIZE];
+    int bufferUsed = 0;
+};
@@ -0,0 +1,98 @@
+/*
+Copyright 2024 The Brynwood Team, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include "Particle.h"
+#include "pixeleds-library.h"
+#include "pixeleds-photon1.h"
+#include "pixeleds-photon2.h"
+
+// RAM a StaticPixeleds may reserve, define before including this header to change it
+#ifndef PIXELEDS_STATIC_RAM_BUDGET
+#if HAL_PLATFORM_RTL872X || (PLATFORM_ID == 32)
+#define PIXELEDS_STATIC_RAM_BUDGET (256 * 1024)
+#else
+#define PIXELEDS_STATIC_RAM_BUDGET (32 * 1024)
+#endif
+#endif
+
+
+
+/**
+ * @struct PixStaticBuffers
+ * @brief The buffers of a StaticPixeleds, sized at compile time: the pixels, the transition frames,
+ * the animation state arena, the encoded frame and the strip using them.
+ *
+ * A base class of StaticPixeleds so the buffers are constructed before Pixeleds uses them.
+ */
+template <int N, byte TYPE, byte ORDER, int OUTPUT>
+struct PixStaticBuffers {
+    typedef FixedParticlePixels<TYPE, ORDER> Strip;
+
+    static constexpr size_t pixelBytes = N * sizeof(PixCol);
+    static constexpr size_t transitionBytes = 2 * N * sizeof(PixCol);
+    static constexpr size_t stateBytes = Pixeleds::stateArenaSize(N);
+    static constexpr size_t encodeBytes = Strip::spiBufferSize(OUTPUT);
+
+    PixCol pixels[N];
+    PixCol transitionPixels[2 * N];
+    alignas(std::max_align_t) byte stateArena[stateBytes];
+    uint8_t encodeBuffer[encodeBytes > 0 ? encodeBytes : 1];
+    Strip strip;
+
+    PixStaticBuffers(byte pixelPin) : strip(pixels, N, pixelPin, encodeBytes > 0 ? encodeBuffer : nullptr, encodeBytes) { }
+};
+
+
+/**
+ * @class StaticPixeleds
+ * @brief A Pixeleds with all of its buffers reserved at compile time, nothing is allocated on the heap.
+ *
+ * N pixels of a FixedParticlePixels<TYPE, ORDER> strip, the encoded frame is sized for OUTPUT LEDs
+ * (more than N for tiled or mirrored output, see setOutputMapping). The buffers live wherever the
+ * object does, declare it globally so they are in .bss and show up in the firmware's RAM usage.
+ *
+ * footprint is the total RAM in bytes, a footprint over PIXELEDS_STATIC_RAM_BUDGET fails to compile.
+ * Use PixPal::wrap() for palettes and setFrameCache(memory, size) for the frame cache to keep
+ * the heap out of the animations as well.
+ *
+ * Example Usage:
+ * @code
+ * StaticPixeleds<300, WS2812B, ORDER_GRB> px(PARTICLE_PIXEL_PIN);
+ * static_assert(decltype(px)::footprint < 8 * 1024, "LED buffers too large");
+ * @endcode
+ */
+template <int N, byte TYPE = WS2812B, byte ORDER = ORDER_RGB, int OUTPUT = N>
+class StaticPixeleds : private PixStaticBuffers<N, TYPE, ORDER, OUTPUT>, public Pixeleds {
+    typedef PixStaticBuffers<N, TYPE, ORDER, OUTPUT> Buffers;
+
+public:
+    static_assert(N > 0 && OUTPUT >= N, "StaticPixeleds needs at least one pixel and OUTPUT >= N");
+
+    static constexpr size_t pixelBytes = Buffers::pixelBytes;
+    static constexpr size_t transitionBytes = Buffers::transitionBytes;
+    static constexpr size_t stateBytes = Buffers::stateBytes;
+    static constexpr size_t encodeBytes = Buffers::encodeBytes;
+    static constexpr size_t footprint = sizeof(Buffers) + sizeof(Pixeleds);
+
+    static_assert(footprint <= PIXELEDS_STATIC_RAM_BUDGET, "StaticPixeleds is larger than PIXELEDS_STATIC_RAM_BUDGET");
+
+    StaticPixeleds(byte pixelPin) : Buffers(pixelPin), Pixeleds(&this->Buffers::strip, this->Buffers::stateArena, this->Buffers::transitionPixels) { }
+
+    StaticPixeleds(const StaticPixeleds&) = delete;
+    StaticPixeleds& operator=(const StaticPixeleds&) = delete;
+};
@@ -0,0 +1,234 @@
+/*
+Copyright 2024 The Brynwood Team, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "pixeleds-stream.h"
+
+#if HAL_PLATFORM_FILESYSTEM
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// literal runs are read straight into the pixel buffer
+static_assert(sizeof(PixCol) == 3, "PixCol must be 3 packed bytes");
+
+// little endian helpers, the stream has no alignment
+static inline uint16_t getWord(const uint8_t *pos) { return pos[0] | (pos[1] << 8); }
+static inline uint32_t getLong(const uint8_t *pos) { return getWord(pos) | ((uint32_t) getWord(pos + 2) << 16); }
+
+
+PixStream::~PixStream() {
+    close();
+}
+
+#if HAL_PLATFORM_FILESYSTEM
+bool PixStream::openFile(const char *path) {
+    close();
+    fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        Log.error("Unable to open stream %s", path);
+        return false;
+    }
+    return readHeader();
+}
+#endif
+
+bool PixStream::openMemory(const uint8_t *memory, size_t size) {
+    close();
+    this->memory = memory;
+    memorySize = memory ? size : 0;
+    return memory && readHeader();
+}
+
+void PixStream::close() {
+#if HAL_PLATFORM_FILESYSTEM
+    if (fd >= 0) ::close(fd);
+#endif
+    fd = -1;
+    memory = nullptr;
+    memorySize = 0;
+    position = 0;
+    bufferUsed = bufferLength = 0;
+    pixelCount = 0;
+    frameCount = 0;
+    duration = 0;
+    pending = false;
+    lastMillis = 0;
+    framesDecoded = 0;
+    bytesRead = 0;
+}
+
+bool PixStream::render(PixCol *pixels, int count, uint32_t millis) {
+    if (!isOpen()) return false;
+    if (millis < lastMillis && !rewind()) return false;
+    lastMillis = millis;
+
+    bool changed = false;
+    while (pending && pendingMillis <= millis) {
+        if (!decodeFrame(pixels, count)) {
+            Log.error("Stream is corrupt, stopping");
+            close();
+            return changed;
+        }
+        changed = true;
+        readFrameHeader();
+    }
+    return changed;
+}
+
+bool PixStream::rewind() {
+    lastMillis = 0;
+    return seek(PIXSTREAM_HEADER_SIZE) && readFrameHeader();
+}
+
+bool PixStream::readHeader() {
+    uint8_t header[PIXSTREAM_HEADER_SIZE];
+    if (!read(header, PIXSTREAM_HEADER_SIZE) || memcmp(header, "PXS", 3) != 0 || header[3] != PIXSTREAM_VERSION) {
+        Log.error("Not a version %d stream", PIXSTREAM_VERSION);
+        close();
+        return false;
+    }
+    pixelCount = getWord(header + 4);
+    frameCount = getLong(header + 8);
+    duration = getLong(header + 12);
+    return readFrameHeader();
+}
+
+// read the header of the next frame, unknown frame types are skipped
+bool PixStream::readFrameHeader() {
+    uint8_t header[PIXSTREAM_FRAME_HEADER_SIZE];
+    while (read(header, PIXSTREAM_FRAME_HEADER_SIZE)) {
+        pendingMillis = getLong(header);
+        pendingLength = getWord(header + 5) | ((uint32_t) header[7] << 16);
+        if (header[4] <= PIXSTREAM_FRAME_DELTA) {
+            pending = true;
+            return true;
+        }
+        if (!skip(pendingLength)) break;
+    }
+    pending = false;
+    return false;
+}
+
+// apply the pending frame to the pixels, pixels past count are read and dropped
+bool PixStream::decodeFrame(PixCol *pixels, int count) {
+    uint32_t remaining = pendingLength;
+    int idx = 0;
+    uint8_t op[4];
+    while (remaining >= 4) {
+        if (!read(op, 4)) return false;
+        idx += getWord(op);
+        int length = getWord(op + 2);
+        remaining -= 4;
+        if (length & 0x8000) {
+            length &= 0x7FFF;
+            PixCol color;
+            if (remaining < sizeof(PixCol) || !read((uint8_t*) &color, sizeof(PixCol))) return false;
+            for (int pix = idx, end = min(idx + length, count); pix < end; pix++) { pixels[pix] = color; }
+            idx += length;
+            remaining -= sizeof(PixCol);
+        }
+        else {
+            uint32_t bytes = length * sizeof(PixCol);
+            int inside = constrain(count - idx, 0, length);
+            if (remaining < bytes
+                    || !read((uint8_t*) (pixels + idx), inside * sizeof(PixCol))
+                    || !skip((length - inside) * sizeof(PixCol))) {
+                return false;
+            }
+            idx += length;
+            remaining -= bytes;
+        }
+    }
+    framesDecoded++;
+    return remaining == 0;
+}
+
+bool PixStream::read(uint8_t *dest, size_t length) {
+    bytesRead += length;
+    if (memory) {
+        if (position + length > memorySize) return false;
+        memcpy(dest, memory + position, length);
+        position += length;
+        return true;
+    }
+#if HAL_PLATFORM_FILESYSTEM
+    while (length > 0) {
+        if (bufferUsed < bufferLength) {
+            size_t chunk = min(length, bufferLength - bufferUsed);
+            memcpy(dest, buffer + bufferUsed, chunk);
+            bufferUsed += chunk;
+            dest += chunk;
+            length -= chunk;
+        }
+        else if (length >= PIXSTREAM_BUFFER_SIZE) {
+            // large runs go straight to the destination
+            int got = ::read(fd, dest, length);
+            if (got <= 0) return false;
+            dest += got;
+            length -= got;
+        }
+        else {
+            int got = ::read(fd, buffer, PIXSTREAM_BUFFER_SIZE);
+            if (got <= 0) return false;
+            bufferUsed = 0;
+            bufferLength = got;
+        }
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool PixStream::skip(size_t length) {
+    if (memory) {
+        if (position + length > memorySize) return false;
+        position += length;
+        return true;
+    }
+#if HAL_PLATFORM_FILESYSTEM
+    size_t buffered = min(length, bufferLength - bufferUsed);
+    bufferUsed += buffered;
+    length -= buffered;
+    return length == 0 || ::lseek(fd, length, SEEK_CUR) >= 0;
+#else
+    return false;
+#endif
+}
+
+bool PixStream::seek(size_t position) {
+    bufferUsed = bufferLength = 0;
+    if (memory) {
+        this->position = position;
+        return position <= memorySize;
+    }
+#if HAL_PLATFORM_FILESYSTEM
+    return ::lseek(fd, position, SEEK_SET) >= 0;
+#else
+    return false;
+#endif
+}
+
+
+
+/*************************
+ * animation
+ */
+
+void __unused animation_stream(PixAniData* data) {
+    PixStream *stream = (PixStream*) data->data;
+    if (stream) stream->render(data->pixels, data->pixelCount, data->cycleMillis);
+}
@@ -0,0 +1,118 @@
+/*
+Copyright 2024 The Brynwood Team, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include "Particle.h"
+#include "pixeleds-library.h"
+
+#define PIXSTREAM_VERSION 1
+#define PIXSTREAM_HEADER_SIZE 16
+#define PIXSTREAM_FRAME_HEADER_SIZE 8
+#define PIXSTREAM_BUFFER_SIZE 64
+
+#define PIXSTREAM_FRAME_KEY 0      // covers every pixel, doesn't depend on the previous frame
+#define PIXSTREAM_FRAME_DELTA 1    // only the pixels that changed since the previous frame
+
+
+
+/**
+ * @class PixStream
+ * @brief Plays a pre-rendered animation (authored on a PC, see tools/pxs-encode.py) from the
+ * filesystem or from a region of flash.
+ *
+ * The stream is decoded straight into the pixel buffer through a small fixed read buffer, so a
+ * show of any length needs no more RAM than the strip itself.
+ *
+ * Stream layout (little endian):
+ * - header: "PXS" [version:1] [pixelCount:2] [flags:2] [frameCount:4] [duration:4]
+ * - frames: [millis:4] [type:1] [length:3] followed by length bytes of ops, where each op is
+ *   [skip:2] [count:2] followed by count colors, or one color if bit 15 of count is set
+ *   (the same ops as the PixFrameCache records). Colors are 3 bytes r, g, b.
+ *
+ * The first frame must be a keyframe; frame times are from the start of the stream and increase.
+ *
+ * Example Usage:
+ * @code
+ * PixStream show;
+ * show.openFile("/show.pxs");            // LittleFS (Gen 3, Photon 2)
+ * // show.openMemory(showData, sizeof(showData));  // const data in flash
+ * px.startAnimation(&animation_stream, nullptr, show.getDuration(), -1, (intptr_t) &show);
+ * @endcode
+ */
+class PixStream {
+public:
+    ~PixStream();
+
+#if HAL_PLATFORM_FILESYSTEM
+    // open a stream file, returns false if it can't be read or isn't a stream
+    bool openFile(const char *path);
+#endif
+
+    // play a stream kept in memory (e.g. a const array in flash), which must outlive the player
+    bool openMemory(const uint8_t *memory, size_t size);
+
+    void close();
+
+    inline bool isOpen() const { return memory != nullptr || fd >= 0; }
+    inline int getPixelCount() const { return pixelCount; }
+    inline uint32_t getFrameCount() const { return frameCount; }
+    inline uint32_t getDuration() const { return duration; }
+
+    // bring pixels to the frame shown at millis into the stream, returns false if nothing changed
+    bool render(PixCol *pixels, int count, uint32_t millis);
+
+    // go back to the first frame
+    bool rewind();
+
+    // decoded frames and stream bytes read
+    unsigned long framesDecoded = 0;
+    unsigned long bytesRead = 0;
+
+private:
+    bool readHeader();
+    bool readFrameHeader();
+    bool decodeFrame(PixCol *pixels, int count);
+    bool read(uint8_t *dest, size_t length);
+    bool skip(size_t length);
+    bool seek(size_t position);
+
+    const uint8_t *memory = nullptr;
+    size_t memorySize = 0;
+    int fd = -1;
+    size_t position = 0;          // next byte of a memory stream
+
+    uint8_t buffer[PIXSTREAM_BUFFER_SIZE];
+    size_t bufferUsed = 0;
+    size_t bufferLength = 0;
+
+    int pixelCount = 0;
+    uint32_t frameCount = 0;
+    uint32_t duration = 0;
+
+    // the next frame to be decoded
+    bool pending = false;
+    uint32_t pendingMillis = 0;
+    uint32_t pendingLength = 0;
+    uint32_t lastMillis = 0;
+};
+
+
+/**
+ * Plays the PixStream given as the animation data, use the stream duration as the cycle
+ * to loop it.
+ */
+extern PixAniFunc animation_stream;
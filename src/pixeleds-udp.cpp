@@ -0,0 +1,203 @@
+/*
+Copyright 2024 The Brynwood Team, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "pixeleds-udp.h"
+
+// DDP header (http://www.3waylabs.com/ddp/)
+#define DDP_HEADER_SIZE 10
+#define DDP_TIMECODE_SIZE 4
+#define DDP_VERSION_MASK 0xC0
+#define DDP_VERSION_1 0x40
+#define DDP_FLAG_TIMECODE 0x10
+#define DDP_FLAG_REPLY 0x04
+#define DDP_FLAG_QUERY 0x02
+#define DDP_FLAG_PUSH 0x01
+#define DDP_ID_DISPLAY 1
+#define DDP_ID_ALL 255
+
+// E1.31 (ANSI E1.31-2018) packet offsets
+#define E131_ROOT_SIZE 38
+#define E131_DATA_SIZE 126
+#define E131_SYNC_SIZE 49
+#define E131_ROOT_VECTOR 18
+#define E131_VECTOR_DATA 0x00000004
+#define E131_VECTOR_EXTENDED 0x00000008
+#define E131_FRAMING_VECTOR 40
+#define E131_VECTOR_SYNC 0x00000001
+#define E131_SYNC_ADDRESS 109
+#define E131_SEQUENCE 111
+#define E131_OPTIONS 112
+#define E131_OPTION_PREVIEW 0x80
+#define E131_OPTION_TERMINATED 0x40
+#define E131_UNIVERSE 113
+#define E131_VALUE_COUNT 123
+#define E131_START_CODE 125
+#define E131_SYNC_UNIVERSE 45
+
+static const uint8_t E131_ACN_ID[] = { 0x00, 0x10, 0x00, 0x00, 'A', 'S', 'C', '-', 'E', '1', '.', '1', '7', 0x00, 0x00, 0x00 };
+
+// big endian helpers
+static inline uint16_t getWord(const uint8_t *pos) { return (pos[0] << 8) | pos[1]; }
+static inline uint32_t getLong(const uint8_t *pos) { return ((uint32_t) getWord(pos) << 16) | getWord(pos + 2); }
+
+
+bool PixUdp::begin(byte protocol, uint16_t port, uint16_t startUniverse, uint16_t universeChannels) {
+    end();
+    this->protocol = protocol;
+    this->startUniverse = startUniverse;
+    this->universeChannels = constrain(universeChannels, 3, 512);
+    int channels = pixeleds.getPixelCount() * sizeof(PixCol);
+    universeCount = min((channels + this->universeChannels - 1) / this->universeChannels, PIXUDP_MAX_UNIVERSES);
+    if (universeCount * this->universeChannels < channels) {
+        Log.warn("Only %d universes are received, the strip needs more", PIXUDP_MAX_UNIVERSES);
+    }
+    if (port == 0) port = protocol == PIXUDP_E131 ? PIXUDP_E131_PORT : PIXUDP_DDP_PORT;
+
+    // packets larger than the (512 byte) default buffer would be truncated
+    if (!udp.setBuffer(PIXUDP_BUFFER_SIZE) || !udp.begin(port)) {
+        Log.error("Unable to listen on UDP port %d", port);
+        return false;
+    }
+    if (protocol == PIXUDP_E131) {
+        for (int idx = 0; idx < universeCount; idx++) {
+            uint16_t universe = startUniverse + idx;
+            udp.joinMulticast(IPAddress(239, 255, universe >> 8, universe & 0xFF));
+        }
+    }
+    ddpSequence = 0;
+    ddpPushed = false;
+    for (int idx = 0; idx < PIXUDP_MAX_UNIVERSES; idx++) { e131Sequences[idx] = -1; }
+    syncUniverse = 0;
+    framePending = false;
+    listening = true;
+    return true;
+}
+
+void PixUdp::end() {
+    if (listening) udp.stop();
+    listening = false;
+}
+
+bool PixUdp::receive() {
+    if (!listening) return false;
+    bool shown = false;
+    int size;
+    while ((size = udp.parsePacket()) > 0) {
+        packets++;
+        if (protocol == PIXUDP_E131 ? receiveE131(size) : receiveDdp(size)) shown = true;
+    }
+    return shown;
+}
+
+bool PixUdp::receiveDdp(int size) {
+    if (size < DDP_HEADER_SIZE || udp.read(header, DDP_HEADER_SIZE) != DDP_HEADER_SIZE
+            || (header[0] & DDP_VERSION_MASK) != DDP_VERSION_1
+            || (header[0] & (DDP_FLAG_QUERY | DDP_FLAG_REPLY))
+            || (header[3] != DDP_ID_DISPLAY && header[3] != DDP_ID_ALL)) {
+        invalid++;
+        return false;
+    }
+    if (header[0] & DDP_FLAG_TIMECODE) udp.read(header + DDP_HEADER_SIZE, DDP_TIMECODE_SIZE);
+
+    // sequence numbers are 1-15, 0 if the sender doesn't use them
+    uint8_t sequence = header[1] & 0x0F;
+    if (sequence) {
+        if (ddpSequence && sequence != ddpSequence % 15 + 1) {
+            dropped += (sequence + 15 - ddpSequence - 1) % 15;
+        }
+        ddpSequence = sequence;
+    }
+
+    size_t offset = getLong(header + 4);
+    size_t length = getWord(header + 8);
+    if (length) readPixels(offset, length);
+
+    if (header[0] & DDP_FLAG_PUSH) {
+        ddpPushed = true;
+        return showFrame();
+    }
+    // senders that never push complete a frame with the data at the end of the strip
+    if (!ddpPushed && length && offset + length >= pixeleds.getPixelCount() * sizeof(PixCol)) {
+        return showFrame();
+    }
+    return false;
+}
+
+bool PixUdp::receiveE131(int size) {
+    if (size < E131_ROOT_SIZE || udp.read(header, E131_ROOT_SIZE) != E131_ROOT_SIZE
+            || memcmp(header, E131_ACN_ID, sizeof(E131_ACN_ID)) != 0) {
+        invalid++;
+        return false;
+    }
+
+    uint32_t vector = getLong(header + E131_ROOT_VECTOR);
+    if (vector == E131_VECTOR_EXTENDED) {
+        if (size < E131_SYNC_SIZE || udp.read(header + E131_ROOT_SIZE, E131_SYNC_SIZE - E131_ROOT_SIZE) != E131_SYNC_SIZE - E131_ROOT_SIZE
+                || getLong(header + E131_FRAMING_VECTOR) != E131_VECTOR_SYNC) {
+            invalid++;
+            return false;
+        }
+        if (syncUniverse && getWord(header + E131_SYNC_UNIVERSE) == syncUniverse && framePending) return showFrame();
+        return false;
+    }
+
+    if (vector != E131_VECTOR_DATA || size < E131_DATA_SIZE
+            || udp.read(header + E131_ROOT_SIZE, E131_DATA_SIZE - E131_ROOT_SIZE) != E131_DATA_SIZE - E131_ROOT_SIZE
+            || header[E131_START_CODE] != 0 || (header[E131_OPTIONS] & (E131_OPTION_PREVIEW | E131_OPTION_TERMINATED))) {
+        invalid++;
+        return false;
+    }
+    int universe = getWord(header + E131_UNIVERSE) - startUniverse;
+    if (universe < 0 || universe >= universeCount) {
+        invalid++;
+        return false;
+    }
+
+    // sequence numbers wrap at 256, a packet up to 20 behind the last one is late and discarded (E1.31 6.7.2)
+    int16_t &last = e131Sequences[universe];
+    uint8_t sequence = header[E131_SEQUENCE];
+    int8_t ahead = (int8_t) (sequence - (uint8_t) last);
+    if (last >= 0 && ahead <= 0 && ahead > -20) {
+        invalid++;
+        return false;
+    }
+    if (last >= 0 && ahead > 1) dropped += ahead - 1;
+    last = sequence;
+
+    int length = min(getWord(header + E131_VALUE_COUNT) - 1, (int) universeChannels);   // without the start code
+    if (length > 0) readPixels(universe * universeChannels, length);
+
+    syncUniverse = getWord(header + E131_SYNC_ADDRESS);
+    if (!syncUniverse && universe == universeCount - 1) return showFrame();
+    return false;
+}
+
+// read length bytes of pixel data from the packet into the pixels at the given byte offset
+bool PixUdp::readPixels(size_t offset, size_t length) {
+    size_t available = pixeleds.getPixelCount() * sizeof(PixCol);
+    if (offset >= available) return false;
+    length = min(length, available - offset);
+    udp.read((uint8_t*) pixeleds.getPixels() + offset, length);
+    framePending = true;
+    return true;
+}
+
+bool PixUdp::showFrame() {
+    pixeleds.showPixels();
+    framePending = false;
+    frames++;
+    return true;
+}
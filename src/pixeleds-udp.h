@@ -0,0 +1,105 @@
+/*
+Copyright 2024 The Brynwood Team, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include "Particle.h"
+#include "pixeleds-library.h"
+
+#define PIXUDP_DDP 0
+#define PIXUDP_E131 1
+
+#define PIXUDP_DDP_PORT 4048
+#define PIXUDP_E131_PORT 5568
+#define PIXUDP_E131_CHANNELS 510       // 170 RGB pixels per universe
+#define PIXUDP_BUFFER_SIZE 1460        // largest DDP packet (1440 bytes of data and a timecode header)
+#define PIXUDP_MAX_UNIVERSES 64
+
+
+
+/**
+ * @class PixUdp
+ * @brief Receives pixel frames from a show controller over UDP, using DDP or E1.31 (sACN).
+ *
+ * Pixel data is read from the UDP packet straight into the Pixeleds pixel buffer at the offset
+ * given by the packet, there is no intermediate frame buffer. When a frame is complete it is
+ * shown on the next Pixeleds::update() (stopping any running animation):
+ * - DDP: on a packet with the push flag (or, if the sender never pushes, on data ending at the
+ *   end of the strip)
+ * - E1.31: when the universe holding the last pixel arrives, or on a sync packet if the sender
+ *   uses universe synchronization. Universes are assembled in order from startUniverse, each
+ *   holding universeChannels channels (510 = 170 pixels).
+ *
+ * Sequence numbers are checked to count dropped packets, pixels outside the strip are ignored.
+ *
+ * Example Usage:
+ * @code
+ * PixUdp receiver(px);
+ *
+ * void setup() {
+ *     px.setup();
+ *     WiFi.connect();
+ *     waitUntil(WiFi.ready);
+ *     receiver.begin(PIXUDP_DDP);
+ * }
+ *
+ * void loop() {
+ *     receiver.receive();
+ *     px.update(millis());
+ * }
+ * @endcode
+ */
+class PixUdp {
+public:
+    PixUdp(Pixeleds &pixeleds) : pixeleds(pixeleds) { }
+    ~PixUdp() { end(); }
+
+    // start listening (port 0 = the protocol's port), E1.31 also joins the universes' multicast groups
+    bool begin(byte protocol = PIXUDP_DDP, uint16_t port = 0,
+               uint16_t startUniverse = 1, uint16_t universeChannels = PIXUDP_E131_CHANNELS);
+
+    void end();
+
+    // read all waiting packets into the pixels, returns true if a frame was completed
+    bool receive();
+
+    // packets received, frames shown, packets missing from the sequence, packets that were ignored
+    unsigned long packets = 0;
+    unsigned long frames = 0;
+    unsigned long dropped = 0;
+    unsigned long invalid = 0;
+
+private:
+    bool receiveDdp(int size);
+    bool receiveE131(int size);
+    bool readPixels(size_t offset, size_t length);
+    bool showFrame();
+
+    Pixeleds &pixeleds;
+    UDP udp;
+    bool listening = false;
+    byte protocol = PIXUDP_DDP;
+    uint16_t startUniverse = 1;
+    uint16_t universeChannels = PIXUDP_E131_CHANNELS;
+    int universeCount = 0;
+    uint16_t syncUniverse = 0;        // E1.31 sync address used by the sender, 0 if none
+    bool framePending = false;        // pixels were written since the last frame was shown
+
+    uint8_t ddpSequence = 0;
+    bool ddpPushed = false;           // the sender uses the push flag
+    int16_t e131Sequences[PIXUDP_MAX_UNIVERSES];   // last sequence of each universe, -1 if none yet
+    uint8_t header[126];
+};
@@ -0,0 +1,63 @@
+/*
+ * Change detection: off by default, when on an identical frame is skipped, a frame that differs in a
+ * single byte or in the output offset is sent, and the keep-alive resends an unchanged frame.
+ */
+#include "host-test.h"
+#include "pixeleds-library.h"
+#include "pixeleds-host.h"
+
+#define TEST_PIXELS 100
+#define TEST_KEEP_ALIVE 1000
+
+int main() {
+    hostSetMillis(0);
+    PixCol pixels[TEST_PIXELS] = {};
+    ParticlePixels strip(pixels, TEST_PIXELS);
+    Pixeleds px(&strip);
+
+    // off: every refreshed frame is sent
+    px.setPixels(PixCol(10, 20, 30));
+    px.update(millis());
+    px.setPixels(PixCol(10, 20, 30));
+    px.update(millis());
+    CHECK_EQ(px.getSentFrames(), 2);
+    CHECK_EQ(px.getSkippedFrames(), 0);
+    CHECK_EQ(px.getFootprint().caches, 0);
+
+    CHECK(px.setChangeDetection(true, TEST_KEEP_ALIVE));
+    CHECK_EQ(px.getFootprint().caches, TEST_PIXELS * sizeof(PixCol));
+    strip.flush();
+    px.setPixels(PixCol(10, 20, 30));
+    px.update(millis());
+    CHECK(strip.flush());
+    px.setPixels(PixCol(10, 20, 30));
+    px.update(millis());
+    CHECK(!strip.flush());
+    CHECK_EQ(px.getSkippedFrames(), 1);
+
+    // one byte of one pixel
+    px.setPixel(TEST_PIXELS - 1, PixCol(10, 20, 31));
+    px.update(millis());
+    CHECK(strip.flush());
+    CHECK(strip.getFrame()[TEST_PIXELS - 1] == PixCol(10, 20, 31));
+
+    // the same pixels from another offset
+    strip.setOffset(1);
+    px.update(millis());
+    CHECK(strip.flush());
+    CHECK(strip.getFrame()[TEST_PIXELS - 2] == PixCol(10, 20, 31));
+
+    // nothing changes until the keep-alive is due
+    CHECK_EQ(px.getIdleMillis(millis()), TEST_KEEP_ALIVE);
+    hostAdvanceMillis(TEST_KEEP_ALIVE - 1);
+    px.update(millis());
+    CHECK(!strip.flush());
+    hostAdvanceMillis(1);
+    CHECK_EQ(px.getIdleMillis(millis()), 0);
+    px.update(millis());
+    CHECK(strip.flush());
+
+    CHECK(px.setChangeDetection(false));
+    CHECK_EQ(px.getFootprint().caches, 0);
+    return testResult("change-detection");
+}
@@ -0,0 +1,123 @@
+/*
+ * Chunked encode of the Photon 2 strip on a simulated 3.125 MHz SPI DMA (host/Particle.h): the
+ * transfers are replayed into a model of a WS2812B chain that latches whenever the line stays low
+ * for TEST_LATCH_MICROS. Every frame must end up on the LEDs whole, also when the encoder is
+ * stalled long enough mid-frame for the LEDs to latch part of it. The clock is the CPU time of the
+ * test (hostCpuTime()) so the counts are exact on a loaded machine. Run under -DPIXELEDS_SANITIZE=thread.
+ */
+#include "host-test.h"
+#include "pixeleds-library.h"
+#include "pixeleds-photon2.h"
+#include <algorithm>
+
+#define TEST_PIXELS 300
+#define TEST_FRAMES 40
+#define TEST_STALL_CHUNK 5
+#define TEST_STALL_MICROS 5000
+#define TEST_LATCH_MICROS 50
+
+static std::atomic<int> encodeCalls{0};
+static std::atomic<int> stallCall{-1};
+
+// encodes like the runtime encoder, after spinning on the chunk stallCall (a preempted update())
+class StalledPixels : public ParticlePixels {
+public:
+    StalledPixels(PixCol* pixels, int pixelCount) : ParticlePixels(pixels, pixelCount, 0, WS2812B, ORDER_RGB) {
+        spiEncoder = &encode;
+    }
+
+private:
+    static void encode(uint8_t* pos, PixOutputWalk& walk, int count) {
+        if (encodeCalls++ == stallCall) delayMicroseconds(TEST_STALL_MICROS);
+        encodeSpiPixels<PixLedFormat<WS2812B, ORDER_RGB>>(pos, walk, count);
+    }
+};
+
+// a chain of LEDs: each takes the first 24 bits it receives after a latch and passes the rest on
+struct LedChain {
+    std::vector<PixCol> leds = std::vector<PixCol>(TEST_PIXELS);
+    std::vector<uint8_t> data;
+    unsigned long lastEnd = 0;
+    unsigned long low = 0;
+    unsigned long partial = 0;
+
+    void receive(const std::vector<HostSpiTransfer>& transfers) {
+        for (const HostSpiTransfer& transfer : transfers) {
+            if (lastEnd) low += transfer.start - lastEnd;
+            lastEnd = transfer.end;
+            bool zeros = std::all_of(transfer.data.begin(), transfer.data.end(), [](uint8_t b) { return b == 0; });
+            if (zeros) {
+                low += transfer.end - transfer.start;
+                continue;
+            }
+            if (low >= TEST_LATCH_MICROS) latch();
+            low = 0;
+            data.insert(data.end(), transfer.data.begin(), transfer.data.end());
+        }
+        if (low >= TEST_LATCH_MICROS) latch();
+    }
+
+    // the middle bit of each 3-bit SPI pattern is the data bit
+    void latch() {
+        if (data.empty()) return;
+        size_t count = min(data.size() / 9, leds.size());
+        if (data.size() != leds.size() * 9) partial++;
+        for (size_t led = 0; led < count; led++) {
+            uint8_t bytes[3] = {};
+            for (int bit = 0; bit < 24; bit++) {
+                int spiBit = led * 72 + bit * 3 + 1;
+                if (data[spiBit / 8] >> (7 - spiBit % 8) & 1) bytes[bit / 8] |= 0x80 >> (bit % 8);
+            }
+            leds[led] = PixCol(bytes[0], bytes[1], bytes[2]);
+        }
+        data.clear();
+    }
+};
+
+static PixCol testColor(int frame, int pixel) {
+    return PixCol(frame * 7 + pixel, frame * 13 + pixel * 3, frame * 29 + pixel * 5);
+}
+
+// sends frames, stalling the encoder on one chunk of each if stall, and counts those not shown whole
+static int sendFrames(StalledPixels& strip, PixCol* pixels, LedChain& chain, int first, bool stall) {
+    int wrong = 0;
+    for (int frame = first; frame < first + TEST_FRAMES; frame++) {
+        for (int idx = 0; idx < TEST_PIXELS; idx++) { pixels[idx] = testColor(frame, idx); }
+        encodeCalls = 0;
+        stallCall = stall ? TEST_STALL_CHUNK : -1;
+        strip.triggerRefresh();
+        strip.update();
+        chain.receive(SPI.takeTransfers());
+        for (int idx = 0; idx < TEST_PIXELS; idx++) {
+            if (chain.leds[idx] != testColor(frame, idx)) {
+                wrong++;
+                break;
+            }
+        }
+    }
+    return wrong;
+}
+
+int main() {
+    hostCpuTime();
+    PixCol pixels[TEST_PIXELS] = {};
+    StalledPixels strip(pixels, TEST_PIXELS);
+    strip.setup();
+    CHECK(strip.setChunkedEncode(SPI_CHUNK_PIXELS));
+    LedChain chain;
+
+    int wrong = sendFrames(strip, pixels, chain, 0, false);
+    printf("running: %lu underruns, %lu resends, %lu partial latches\n", strip.getChunkUnderruns(),
+           strip.getChunkResends(), chain.partial);
+    CHECK_EQ(wrong, 0);
+
+    unsigned long resends = strip.getChunkResends();
+    unsigned long partial = chain.partial;
+    wrong = sendFrames(strip, pixels, chain, TEST_FRAMES, true);
+    printf("stalled %dus: %lu underruns, %lu resends, %lu partial latches\n", TEST_STALL_MICROS,
+           strip.getChunkUnderruns(), strip.getChunkResends() - resends, chain.partial - partial);
+    CHECK_EQ(wrong, 0);
+    CHECK_EQ(strip.getChunkResends() - resends, TEST_FRAMES);
+    CHECK_EQ(chain.partial - partial, TEST_FRAMES);
+    return testResult("chunked-dma");
+}
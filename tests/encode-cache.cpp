@@ -0,0 +1,59 @@
+/*
+ * The Photon 2 encode cache on the simulated SPI (host/Particle.h): a setting that changes the encoded
+ * bytes but not the pixels (global brightness, HSV table, 16-bit gamma) must not send a frame from the cache.
+ */
+#include "host-test.h"
+#include "pixeleds-library.h"
+#include "pixeleds-photon2.h"
+#include <vector>
+
+#define TEST_PIXELS 10
+#define TEST_START_FRAME 4
+
+// the bytes sent by one update
+static std::vector<uint8_t> sendFrame(ParticlePixels &strip) {
+    strip.triggerRefresh();
+    strip.update();
+    std::vector<uint8_t> data;
+    for (const HostSpiTransfer &transfer : SPI.takeTransfers()) {
+        data.insert(data.end(), transfer.data.begin(), transfer.data.end());
+    }
+    return data;
+}
+
+int main() {
+    hostRealTime();
+    PixCol pixels[TEST_PIXELS];
+    for (int idx = 0; idx < TEST_PIXELS; idx++) { pixels[idx] = PixCol(idx * 20, 0, 0); }
+    ParticlePixels strip(pixels, TEST_PIXELS, 0, APA102, ORDER_BGR);
+    strip.setup();
+    CHECK(strip.setEncodeCache(4096));
+
+    std::vector<uint8_t> data = sendFrame(strip);
+    CHECK(data.size() > TEST_START_FRAME);
+    CHECK_EQ(data[TEST_START_FRAME], 0xFF);
+    data = sendFrame(strip);
+    CHECK_EQ(strip.getEncodeCacheHits(), 1);
+
+    strip.setGlobalBrightness(3);
+    data = sendFrame(strip);
+    CHECK(data.size() > TEST_START_FRAME);
+    CHECK_EQ(data[TEST_START_FRAME], 0xE3);
+    CHECK_EQ(strip.getEncodeCacheHits(), 1);
+
+    // the same pixels as HSV are other colors
+    std::vector<uint8_t> rgb = sendFrame(strip);
+    strip.setHsvTable(&PixHsvTable::standard());
+    CHECK(sendFrame(strip) != rgb);
+
+    // 16-bit channels through another gamma table
+    ParticlePixels wide(pixels, TEST_PIXELS, 0, HD108, ORDER_RGB);
+    wide.setup();
+    CHECK(wide.setEncodeCache(4096));
+    std::vector<uint8_t> standard = sendFrame(wide);
+    CHECK(sendFrame(wide) == standard);
+    PixGamma16 linear(1.0f);
+    wide.setGamma16(&linear);
+    CHECK(sendFrame(wide) != standard);
+    return testResult("encode-cache");
+}
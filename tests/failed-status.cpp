@@ -0,0 +1,41 @@
+/*
+ * A Pixeleds that failed to allocate its pixels reports PIXELEDS_NO_MEMORY, and the pixel setters,
+ * animations and sequences do nothing instead of writing through the null buffer. Run under
+ * -DPIXELEDS_SANITIZE=address.
+ */
+#include "host-test.h"
+#include "pixeleds-library.h"
+#include "pixeleds-colors.h"
+#include "pixeleds-host.h"
+
+#define TEST_PIXELS 30
+
+int main() {
+    hostSetMillis(1000);
+    Pixeleds px(nullptr, TEST_PIXELS, 0);
+    CHECK_EQ(px.setup(), PIXELEDS_NO_MEMORY);
+    CHECK_EQ(px.getStatus(), PIXELEDS_NO_MEMORY);
+
+    px.setPixel(0, Color::RED);
+    px.setPixels(Color::RED);
+    px.setPixels(&Color::RAINBOW);
+    px.updatePixel(0, Color::RED);
+    px.updatePixels(Color::RED);
+    px.showPixels();
+    CHECK(px.startAnimation(&animation_comet, &Color::RAINBOW, 1000) == nullptr);
+    CHECK(!px.isAnimationActive());
+    PixSeqStep steps[] = {
+        { &animation_glow, &Color::GREENS, 1000, 2000, 0, 0, TRANSITION_CROSSFADE },
+    };
+    px.startSequence(steps, 1);
+    CHECK(!px.isSequenceActive());
+    CHECK(!px.isAnimationActive());
+
+    for (int frame = 0; frame < 10; frame++) {
+        hostAdvanceMillis(20);
+        px.update(millis());
+    }
+    CHECK_EQ(px.getSentFrames(), 0);
+    CHECK_EQ(px.getIdleMillis(millis()), PIXELEDS_IDLE_FOREVER);
+    return testResult("failed-status");
+}
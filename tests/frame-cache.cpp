@@ -0,0 +1,78 @@
+/*
+ * The frame cache records the first cycle while it is shown: startAnimation() renders one frame,
+ * each update() one more (or the ones it missed), the frames are the same as with the cache off
+ * and the following cycles are replayed without calling the animation.
+ */
+#include "host-test.h"
+#include "pixeleds-library.h"
+#include "pixeleds-colors.h"
+#include "pixeleds-host.h"
+#include <vector>
+
+#define TEST_PIXELS 60
+#define TEST_REFRESH 20
+#define TEST_CYCLE 2000
+#define TEST_START 1000
+#define TEST_FRAMES (TEST_CYCLE / TEST_REFRESH)
+
+static int calls = 0;
+
+static void countedComet(PixAniData *data) {
+    calls++;
+    animation_comet(data);
+}
+
+// the output frames at the given times from the start, with or without a cache of cacheBytes
+static std::vector<PixCol> run(size_t cacheBytes, const std::vector<int> &times, Pixeleds **keep = nullptr) {
+    static PixCol pixels[TEST_PIXELS];
+    static ParticlePixels *strip;
+    static Pixeleds *px;
+    delete px;
+    delete strip;
+    strip = new ParticlePixels(pixels, TEST_PIXELS);
+    px = new Pixeleds(strip);
+    px->setAnimationRefresh(TEST_REFRESH);
+    px->setChangeDetection(false);
+    if (cacheBytes) CHECK(px->setFrameCache(cacheBytes));
+
+    calls = 0;
+    hostSetMillis(TEST_START);
+    px->startAnimation(&countedComet, &Color::BLUES, TEST_CYCLE);
+    CHECK_EQ(calls, 1);
+    std::vector<PixCol> frames;
+    for (int time : times) {
+        hostSetMillis(TEST_START + time);
+        px->update(TEST_START + time);
+        frames.insert(frames.end(), strip->getFrame(), strip->getFrame() + TEST_PIXELS);
+    }
+    if (keep) *keep = px;
+    return frames;
+}
+
+int main() {
+    std::vector<int> grid;
+    for (int frame = 0; frame < 3 * TEST_FRAMES; frame++) grid.push_back(frame * TEST_REFRESH);
+
+    std::vector<PixCol> live = run(0, grid);
+    Pixeleds *px;
+    std::vector<PixCol> cached = run(64 * 1024, grid, &px);
+    CHECK(cached == live);
+    CHECK_EQ(calls, TEST_FRAMES);  // the first cycle only
+    CHECK_EQ(px->getFrameCacheMisses(), TEST_FRAMES - 1);
+    CHECK_EQ(px->getFrameCacheHits(), 2 * TEST_FRAMES);
+    CHECK(px->getFrameCacheBytes() > 0);
+
+    // update() late by several frames renders the missed ones, the following cycles replay the same
+    std::vector<int> late;
+    for (int time = 0; time < 3 * TEST_CYCLE; time += (time < TEST_CYCLE ? 5 * TEST_REFRESH : TEST_REFRESH)) late.push_back(time);
+    std::vector<PixCol> lateCached = run(64 * 1024, late, &px);
+    CHECK_EQ(calls, TEST_FRAMES);
+    CHECK(lateCached == run(0, late));
+
+    // a cycle that doesn't fit is rendered live, without starting over
+    std::vector<PixCol> small = run(2 * TEST_PIXELS * sizeof(PixCol), grid, &px);
+    CHECK(small == live);
+    CHECK_EQ(calls, 3 * TEST_FRAMES);
+    CHECK_EQ(px->getFrameCacheBytes(), 0);
+    return testResult("frame-cache");
+}
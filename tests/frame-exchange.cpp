@@ -0,0 +1,84 @@
+/*
+ * PixFrameExchange under contention: writer threads publish frames filled with their own id, half
+ * with publish() and half rendered into the back buffer, while the strip renders the latest frame
+ * on the main thread. Every frame rendered must be uniform. Run under -DPIXELEDS_SANITIZE=thread.
+ */
+#include "host-test.h"
+#include "pixeleds-library.h"
+#include "pixeleds-host.h"
+#include <thread>
+#include <vector>
+
+#define TEST_PIXELS 300
+#define TEST_WRITERS 3
+#define TEST_FRAMES 20000
+#define TEST_TIMEOUT 10000
+
+static PixFrameExchange exchange(TEST_PIXELS);
+static std::atomic<bool> stopping{false};
+static std::atomic<unsigned long> writes[TEST_WRITERS + 1];
+
+static void writer(intptr_t id) {
+    PixCol color((byte) id, (byte) (id * 3), (byte) (id * 7));
+    std::vector<PixCol> frame(TEST_PIXELS, color);
+    for (uint32_t count = 0; !stopping; count++) {
+        if (count % 2) {
+            exchange.publish(frame.data());
+        }
+        else {
+            PixCol *back = exchange.beginFrame();
+            if (back) {
+                for (int idx = 0; idx < TEST_PIXELS; idx++) { back[idx] = color; }
+                exchange.endFrame();
+            }
+        }
+        writes[id]++;
+        // a short pause lets every writer in, even on a single core
+        usleep(50);
+    }
+}
+
+int main() {
+    PixCol pixels[TEST_PIXELS] = {};
+    ParticlePixels strip(pixels, TEST_PIXELS);
+    Pixeleds px(&strip);
+    px.setChangeDetection(false);
+    CHECK(px.setFrameExchange(&exchange));
+
+    std::vector<std::thread> writers;
+    for (intptr_t id = 1; id <= TEST_WRITERS; id++) writers.emplace_back(writer, id);
+
+    unsigned long rendered = 0, torn = 0;
+    bool seen[TEST_WRITERS + 1] = {};
+    int writersSeen = 0;
+    system_tick_t start = millis();
+    while ((rendered < TEST_FRAMES || writersSeen < TEST_WRITERS) && millis() - start < TEST_TIMEOUT) {
+        px.update(millis());
+        if (!strip.flush()) {
+            std::this_thread::yield();
+            continue;
+        }
+        rendered++;
+        const PixCol *frame = strip.getFrame();
+        for (int idx = 1; idx < TEST_PIXELS; idx++) {
+            if (frame[idx] != frame[0]) {
+                torn++;
+                break;
+            }
+        }
+        if (frame[0].r > 0 && frame[0].r <= TEST_WRITERS && !seen[frame[0].r]) {
+            seen[frame[0].r] = true;
+            writersSeen++;
+        }
+    }
+    stopping = true;
+    for (std::thread &thread : writers) thread.join();
+
+    printf("published=%lu acquired=%lu rendered=%lu collisions=%lu torn=%lu\n", exchange.published.load(),
+           exchange.acquired, rendered, exchange.collisions.load(), torn);
+    CHECK(rendered >= TEST_FRAMES);
+    CHECK_EQ(torn, 0);
+    for (int id = 1; id <= TEST_WRITERS; id++) CHECK(writes[id] > 0);
+    CHECK_EQ(writersSeen, TEST_WRITERS);
+    return testResult("frame-exchange");
+}
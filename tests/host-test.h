@@ -0,0 +1,50 @@
+/*
+Copyright 2024 The Brynwood Team, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/*
+ * Checks for the host tests (see CMakeLists.txt): a failed check prints where and what, the test
+ * keeps running and testResult() returns the exit code for ctest.
+ */
+#pragma once
+
+#include "Particle.h"
+#include <cinttypes>
+#include <cstdio>
+
+inline int& testFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(condition) do { \
+        if (!(condition)) { \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            testFailures()++; \
+        } \
+    } while (0)
+
+#define CHECK_EQ(actual, expected) do { \
+        long long a_ = (long long) (actual), e_ = (long long) (expected); \
+        if (a_ != e_) { \
+            printf("%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__, #actual, a_, e_); \
+            testFailures()++; \
+        } \
+    } while (0)
+
+inline int testResult(const char *name) {
+    printf("%s: %s (%d failed)\n", name, testFailures() ? "FAILED" : "passed", testFailures());
+    return testFailures() ? 1 : 0;
+}
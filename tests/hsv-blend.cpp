@@ -0,0 +1,98 @@
+/*
+ * Blending HSV pixels: a crossfade and keyframes from magenta to orange pass through red, the short
+ * way around the hue wheel, and a sub-pixel offset blends the two neighbouring pixels as RGB.
+ */
+#include "host-test.h"
+#include "pixeleds-library.h"
+#include "pixeleds-colors.h"
+#include "pixeleds-host.h"
+#include <cstdlib>
+
+#define TEST_PIXELS 10
+#define TEST_REFRESH 10
+#define TEST_MAGENTA 224
+#define TEST_ORANGE 16
+
+// fills the pixels with the hue passed as data
+static void hsv_fill(PixAniData *data) {
+    data->fillHsv(PixHsv((byte) data->data, 255, 255));
+}
+
+// magenta to orange, a byte blend would pass through blue and green
+static bool shortWay(PixCol color) {
+    return color.r == 255 && color.b < 255 && color.g < 255 && (color.g == 0 || color.b == 0);
+}
+
+// a hue at the fill hue, the short way from magenta to orange, by alpha (0-256)
+static PixCol hueAt(int alpha) {
+    int delta = (int8_t) (byte) (TEST_ORANGE - TEST_MAGENTA);
+    return PixHsvTable::standard().rgb(PixHsv((byte) (TEST_MAGENTA + delta * alpha / 256), 255, 255));
+}
+
+static bool near(PixCol a, PixCol b) {
+    return abs(a.r - b.r) <= 8 && abs(a.g - b.g) <= 8 && abs(a.b - b.b) <= 8;
+}
+
+static void crossfade() {
+    PixCol pixels[TEST_PIXELS];
+    ParticlePixels strip(pixels, TEST_PIXELS);
+    Pixeleds px(&strip);
+    px.setAnimationRefresh(TEST_REFRESH);
+    px.setHsvPixels();
+    hostSetMillis(1000);
+    px.startAnimation(&hsv_fill, &Color::RAINBOW, 1000, -1, TEST_MAGENTA);
+    px.update(millis());
+    px.startAnimation(&hsv_fill, &Color::RAINBOW, 1000, -1, TEST_ORANGE, 1000);
+    for (int step = 1; step < 10; step++) {
+        hostAdvanceMillis(100);
+        px.update(millis());
+        PixCol color = strip.getFrame()[0];
+        CHECK(shortWay(color));
+        CHECK(near(color, hueAt(step * 256 / 10)));
+    }
+}
+
+static void keyframes() {
+    PixCol pixels[TEST_PIXELS];
+    ParticlePixels strip(pixels, TEST_PIXELS);
+    Pixeleds px(&strip);
+    px.setAnimationRefresh(TEST_REFRESH);
+    CHECK(px.setKeyframeRefresh(100));
+    px.setHsvPixels();
+    hostSetMillis(1000);
+    PixAniData *data = px.startAnimation(&hsv_fill, &Color::RAINBOW, 1000, -1, TEST_MAGENTA);
+    px.update(millis());
+    // the next keyframe is orange, the frames in between are blended towards it
+    data->data = TEST_ORANGE;
+    int between = 0;
+    for (int step = 0; step < 20; step++) {
+        hostAdvanceMillis(TEST_REFRESH + 1);
+        px.update(millis());
+        PixCol color = strip.getFrame()[0];
+        CHECK(shortWay(color));
+        if (color != hueAt(0) && color != hueAt(256)) between++;
+    }
+    CHECK(between > 0);
+}
+
+static void offsetBlend() {
+    PixCol pixels[TEST_PIXELS];
+    ParticlePixels strip(pixels, TEST_PIXELS);
+    strip.setHsvTable(&PixHsvTable::standard());
+    PixHsv *hsv = (PixHsv*) pixels;
+    for (int idx = 0; idx < TEST_PIXELS; idx++) { hsv[idx] = PixHsv(idx % 2 ? 170 : 0, 255, 255); }
+    strip.setOffset(0, 128);
+    strip.update();
+    CHECK(strip.flush());
+    // red and blue blended as RGB, the byte blend would be hue 85 (green)
+    PixCol expected = PixHsvTable::standard().rgb(hsv[0]).blend(PixHsvTable::standard().rgb(hsv[1]), 128);
+    CHECK(strip.getFrame()[0] == expected);
+    CHECK(strip.getFrame()[0].g < 16);
+}
+
+int main() {
+    crossfade();
+    keyframes();
+    offsetBlend();
+    return testResult("hsv-blend");
+}
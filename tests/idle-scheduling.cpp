@@ -0,0 +1,82 @@
+/*
+ * getIdleMillis() against polling: each case runs 60 s at a 20 ms refresh, once calling update()
+ * every 1 ms and once sleeping getIdleMillis() between calls. The frames sent and their times
+ * must be the same, the wakes are the numbers in the README (Idle Scheduling).
+ */
+#include "host-test.h"
+#include "pixeleds-library.h"
+#include "pixeleds-colors.h"
+#include "pixeleds-host.h"
+#include <vector>
+
+#define TEST_PIXELS 60
+#define TEST_MILLIS 60000
+#define TEST_REFRESH 20
+#define TEST_START 1000
+
+struct SentFrame {
+    system_tick_t millis;
+    uint32_t hash;
+    bool operator==(const SentFrame &other) const { return millis == other.millis && hash == other.hash; }
+};
+
+static void recordFrame(const PixCol *frame, int outputCount, void *context) {
+    ((std::vector<SentFrame>*) context)->push_back({millis(), pixelHash(frame, outputCount)});
+}
+
+static const PixSeqStep sequence[] = {
+    { &animation_cycle, &Color::RAINBOW, 7000, 10000, 0, 0, TRANSITION_CROSSFADE },
+    { &animation_blink, &Color::RGB, 1000, 5000, 0, 1000, TRANSITION_CROSSFADE },
+};
+
+static void start(Pixeleds &px, int scenario) {
+    switch (scenario) {
+        case 0: px.startAnimation(&animation_cycle, &Color::RAINBOW, 7000); break;
+        case 1: px.startAnimation(&animation_strobe, &Color::RAINBOW, 1000); break;
+        case 2: px.startAnimation(&animation_blink, &Color::RGB, 1000); break;
+        case 3: px.startAnimation(&animation_fadeIn, &Color::REDS, 2000, 2000); break;
+        case 4: px.setPixels(PixCol(20, 40, 60)); break;
+        case 5: px.startAnimation(&animation_glow, &Color::GREENS, 1500); break;
+        case 6: px.startSequence(sequence, 2); break;
+    }
+}
+
+// the frames sent in 60 s, returns the number of update() calls
+static long run(int scenario, bool idle, std::vector<SentFrame> &sent) {
+    PixCol pixels[TEST_PIXELS];
+    ParticlePixels strip(pixels, TEST_PIXELS);
+    strip.setOutput(&recordFrame, &sent);
+    Pixeleds px(&strip);
+    px.setAnimationRefresh(TEST_REFRESH);
+    randomSeed(1);
+    hostSetMillis(TEST_START);
+    start(px, scenario);
+
+    long wakes = 0;
+    system_tick_t now = TEST_START;
+    while (now < TEST_START + TEST_MILLIS) {
+        hostSetMillis(now);
+        px.update(now);
+        strip.flush();
+        wakes++;
+        system_tick_t wait = idle ? px.getIdleMillis(now) : 1;
+        if (wait == (system_tick_t) PIXELEDS_IDLE_FOREVER) break;
+        now += max(wait, (system_tick_t) 1);
+    }
+    return wakes;
+}
+
+int main() {
+    // cycle, strobe, blink, fadeIn then static, static pixels, glow, sequence
+    const long expectedWakes[] = { 60, 600, 120, 102, 1, 3000, 268 };
+    for (int scenario = 0; scenario < 7; scenario++) {
+        std::vector<SentFrame> polled, scheduled;
+        CHECK_EQ(run(scenario, false, polled), TEST_MILLIS);
+        long wakes = run(scenario, true, scheduled);
+        printf("scenario %d: %ld wakes, %.1f%% idle, %zu frames sent\n", scenario, wakes,
+               100.0 - wakes * 100.0 / TEST_MILLIS, scheduled.size());
+        CHECK_EQ(wakes, expectedWakes[scenario]);
+        CHECK(polled == scheduled);
+    }
+    return testResult("idle-scheduling");
+}
@@ -0,0 +1,74 @@
+/*
+ * Keyframes against rendering every frame: 6 s of a 3 s cycle at a 10 ms refresh with 50 ms
+ * keyframes. The animation runs 121 instead of 600 times and every output frame is within the
+ * error given in the README (Keyframes) of the frame rendered at full rate.
+ */
+#include "host-test.h"
+#include "pixeleds-library.h"
+#include "pixeleds-colors.h"
+#include "pixeleds-host.h"
+#include <cstdlib>
+#include <vector>
+
+#define TEST_PIXELS 60
+#define TEST_MILLIS 6000
+#define TEST_REFRESH 10
+#define TEST_KEYFRAMES 50
+#define TEST_START 1000
+
+static PixAniFunc *counted = nullptr;
+static int calls = 0;
+
+static void countCalls(PixAniData *data) {
+    calls++;
+    counted(data);
+}
+
+// the output frame at every refresh, with the number of animation calls
+static std::vector<PixCol> run(PixAniFunc *animation, PixPal *palette, int keyframeMillis) {
+    PixCol pixels[TEST_PIXELS];
+    ParticlePixels strip(pixels, TEST_PIXELS);
+    Pixeleds px(&strip);
+    px.setAnimationRefresh(TEST_REFRESH);
+    px.setChangeDetection(false);
+    if (keyframeMillis) CHECK(px.setKeyframeRefresh(keyframeMillis));
+
+    counted = animation;
+    calls = 0;
+    hostSetMillis(TEST_START);
+    px.startAnimation(&countCalls, palette, 3000);
+    std::vector<PixCol> frames;
+    for (system_tick_t now = TEST_START; now < TEST_START + TEST_MILLIS; now += TEST_REFRESH) {
+        hostSetMillis(now);
+        px.update(now);
+        frames.insert(frames.end(), strip.getFrame(), strip.getFrame() + TEST_PIXELS);
+    }
+    return frames;
+}
+
+static int maxError(const std::vector<PixCol> &frames, const std::vector<PixCol> &expected) {
+    int error = 0;
+    for (size_t idx = 0; idx < frames.size(); idx++) {
+        error = max(error, abs(frames[idx].r - expected[idx].r));
+        error = max(error, abs(frames[idx].g - expected[idx].g));
+        error = max(error, abs(frames[idx].b - expected[idx].b));
+    }
+    return error;
+}
+
+int main() {
+    struct { const char *name; PixAniFunc *animation; PixPal *palette; int error; } cases[] = {
+        { "glow", &animation_glow, &Color::GREENS, 1 },
+        { "fader", &animation_fader, &Color::BLUES, 11 },
+    };
+    for (auto &test : cases) {
+        std::vector<PixCol> full = run(test.animation, test.palette, 0);
+        CHECK_EQ(calls, TEST_MILLIS / TEST_REFRESH);
+        std::vector<PixCol> keyed = run(test.animation, test.palette, TEST_KEYFRAMES);
+        int error = maxError(keyed, full);
+        printf("%s: %d animation calls, max error %d\n", test.name, calls, error);
+        CHECK_EQ(calls, 121);
+        CHECK(error <= test.error);
+    }
+    return testResult("keyframes");
+}
@@ -0,0 +1,46 @@
+/*
+ * PixLayout tables: a layout made from the caller's table references it (copies too), the wiring
+ * patterns own theirs and copies get their own, and setLayout() checks the indexes. Run under
+ * -DPIXELEDS_SANITIZE=address.
+ */
+#include "host-test.h"
+#include "pixeleds-library.h"
+#include "pixeleds-host.h"
+
+#define TEST_WIDTH 4
+#define TEST_HEIGHT 2
+
+static const uint16_t table[TEST_WIDTH * TEST_HEIGHT] = { 7, 6, 5, 4, 0, 1, 2, 3 };
+
+int main() {
+    PixLayout wired(TEST_WIDTH, TEST_HEIGHT, table);
+    CHECK(wired.indexes == table);
+    CHECK_EQ(wired.index(1, 1), 1);
+    PixLayout wiredCopy(wired);
+    CHECK(wiredCopy.indexes == table);
+
+    PixLayout panel(TEST_WIDTH, TEST_HEIGHT, LAYOUT_SERPENTINE);
+    CHECK_EQ(panel.index(0, 1), 7);
+    PixLayout panelCopy(panel);
+    CHECK(panelCopy.indexes != panel.indexes);
+    CHECK_EQ(panelCopy.index(0, 1), 7);
+
+    // owned and referenced tables swap places
+    panelCopy = wired;
+    CHECK(panelCopy.indexes == table);
+    wiredCopy = panel;
+    CHECK(wiredCopy.indexes != panel.indexes);
+    CHECK_EQ(wiredCopy.index(3, 0), 3);
+
+    PixCol pixels[TEST_WIDTH * TEST_HEIGHT];
+    ParticlePixels strip(pixels, TEST_WIDTH * TEST_HEIGHT);
+    Pixeleds px(&strip);
+    CHECK(px.setLayout(&wired));
+    PixLayout failed;
+    failed.width = TEST_WIDTH;
+    failed.height = TEST_HEIGHT;
+    CHECK(!px.setLayout(&failed));
+    PixLayout wide(TEST_WIDTH * 2, TEST_HEIGHT);
+    CHECK(!px.setLayout(&wide));
+    return testResult("layout");
+}
@@ -0,0 +1,94 @@
+/*
+ * 16-bit frames on the Photon 2 strip with the simulated SPI (host/Particle.h): an animation writing
+ * PixAniData::pixels16 drives HD108 and WS2816 LEDs with every 16-bit level, scrolled through the
+ * output offset, and the pixel setters write the gamma expanded colors. Other strips refuse it.
+ */
+#include "host-test.h"
+#include "pixeleds-library.h"
+#include "pixeleds-colors.h"
+#include "pixeleds-photon2.h"
+#include <vector>
+
+#define TEST_PIXELS 12
+#define TEST_OFFSET 5
+
+// consecutive low levels an 8-bit frame can't reach through the gamma table
+static PixCol16 testColor(int pixel) {
+    return PixCol16(pixel + 1, 1000 + pixel, 65535 - pixel);
+}
+
+static void ramp16(PixAniData *data) {
+    for (int idx = 0; idx < data->pixelCount; idx++) { data->pixels16[idx] = testColor(idx); }
+    data->offset = TEST_OFFSET;
+}
+
+// the bytes sent by one update
+static std::vector<uint8_t> sendFrame(Pixeleds &px) {
+    hostAdvanceMillis(100);
+    px.update(millis());
+    std::vector<uint8_t> data;
+    for (const HostSpiTransfer &transfer : SPI.takeTransfers()) {
+        data.insert(data.end(), transfer.data.begin(), transfer.data.end());
+    }
+    return data;
+}
+
+// HD108 ORDER_RGB: a 16-byte start frame, then a 2-byte header and r, g, b big endian per LED
+static PixCol16 hd108Led(const std::vector<uint8_t> &data, int led) {
+    const uint8_t *pos = data.data() + HD108_START_BYTES + led * HD108_BYTES_PER_LED;
+    return PixCol16(pos[2] << 8 | pos[3], pos[4] << 8 | pos[5], pos[6] << 8 | pos[7]);
+}
+
+// WS2816 ORDER_GRB: the data bit is the middle one of each 3-bit SPI pattern, after the reset zeros
+static PixCol16 ws2816Led(const std::vector<uint8_t> &data, int led) {
+    size_t start = 0;
+    while (start < data.size() && !data[start]) start++;
+    uint16_t channels[3] = {};
+    for (int bit = 0; bit < 48; bit++) {
+        size_t spiBit = start * 8 + (led * 48 + bit) * 3 + 1;
+        if (spiBit / 8 < data.size() && data[spiBit / 8] >> (7 - spiBit % 8) & 1) channels[bit / 16] |= 0x8000 >> (bit % 16);
+    }
+    return PixCol16(channels[1], channels[0], channels[2]);
+}
+
+static void checkStrip(byte type, byte order, PixCol16 (*led)(const std::vector<uint8_t>&, int)) {
+    PixCol pixels[TEST_PIXELS] = {};
+    ParticlePixels strip(pixels, TEST_PIXELS, 0, type, order);
+    Pixeleds px(&strip);
+    CHECK_EQ(px.setup(), PIXELEDS_OK);
+    CHECK(px.setPixels16());
+    CHECK_EQ(px.getFootprint().pixels, TEST_PIXELS * (sizeof(PixCol) + sizeof(PixCol16)));
+
+    px.startAnimation(&ramp16, &Color::RAINBOW, 1000);
+    std::vector<uint8_t> data = sendFrame(px);
+    for (int idx = 0; idx < TEST_PIXELS; idx++) { CHECK(led(data, idx) == testColor((idx + TEST_OFFSET) % TEST_PIXELS)); }
+
+    // transitions cut to the new animation
+    px.startAnimation(&animation_glow, &Color::GREENS, 1000, -1, 0, 1000);
+    CHECK(!px.isTransitionActive());
+
+    px.setPixels(PixCol(10, 128, 255));
+    data = sendFrame(px);
+    PixCol16 expanded = PixGamma16::standard().expand(PixCol(10, 128, 255));
+    for (int idx = 0; idx < TEST_PIXELS; idx++) { CHECK(led(data, idx) == expanded); }
+
+    CHECK(px.setPixels16(false));
+    CHECK(px.getPixels16() == nullptr);
+    px.setPixel(0, PixCol(1, 2, 3));
+    data = sendFrame(px);
+    CHECK(led(data, 0) == PixGamma16::standard().expand(PixCol(1, 2, 3)));
+}
+
+int main() {
+    hostSetMillis(1000);
+    checkStrip(HD108, ORDER_RGB, hd108Led);
+    checkStrip(WS2816, ORDER_GRB, ws2816Led);
+
+    // only 16-bit strips
+    PixCol pixels[TEST_PIXELS] = {};
+    ParticlePixels strip(pixels, TEST_PIXELS, 0, WS2812B, ORDER_GRB);
+    Pixeleds px(&strip);
+    CHECK(!px.setPixels16());
+    CHECK(px.getPixels16() == nullptr);
+    return testResult("pixels16");
+}
@@ -0,0 +1,53 @@
+/*
+ * The render thread on std::thread: the strip renders on its own thread at a 5 ms refresh while the
+ * main thread switches animations, fills the pixels and reads the frame stats, from the moment
+ * the object is constructed. Run under -DPIXELEDS_SANITIZE=thread.
+ */
+#include "host-test.h"
+#include "pixeleds-library.h"
+#include "pixeleds-colors.h"
+#include "pixeleds-host.h"
+#include <thread>
+
+#define TEST_PIXELS 120
+#define TEST_REFRESH 5
+#define TEST_MILLIS 500
+
+static void runThread(Pixeleds &px) {
+    CHECK(px.startThread());
+    CHECK(px.isThreadRunning());
+    system_tick_t start = millis();
+    for (int count = 0; millis() - start < TEST_MILLIS; count++) {
+        // a new palette every 50 ms, static pixels for 10 ms of them
+        if (count % 50 == 0) px.startAnimation(&animation_comet, count % 100 ? &Color::RAINBOW : &Color::BLUES, 1000);
+        else if (count % 50 == 40) px.setPixels(Color::RED);
+        px.getFrameStats();
+        WITH_LOCK(px) {
+            px.getPixels()[0] = Color::GREEN;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    px.stopThread();
+    CHECK(!px.isThreadRunning());
+}
+
+int main() {
+    PixCol pixels[TEST_PIXELS] = {};
+    ParticlePixels strip(pixels, TEST_PIXELS);
+    Pixeleds px(&strip);
+    px.setAnimationRefresh(TEST_REFRESH);
+    px.startAnimation(&animation_comet, &Color::RAINBOW, 1000);
+
+    // the lock exists before the thread, so the main thread can take it while it starts
+    runThread(px);
+    PixFrameStats stats = px.getFrameStats();
+    printf("frames=%lu interval avg=%luus min=%luus max=%luus late=%lu\n", stats.frames, stats.averageInterval(),
+           stats.minInterval, stats.maxInterval, stats.late);
+    CHECK(stats.frames > 0);
+
+    // and it can be started again
+    px.resetFrameStats();
+    runThread(px);
+    CHECK(px.getFrameStats().frames > 0);
+    return testResult("render-thread");
+}
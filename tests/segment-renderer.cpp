@@ -0,0 +1,69 @@
+/*
+ * PixSegmentRenderer renders the same frames on any number of threads: 40 segments of different
+ * lengths and animations, 300 frames, every output frame hashed per segment. sparkle, strobe and
+ * random are left out, they share the global random() so their frames depend on the thread order.
+ * Run under -DPIXELEDS_SANITIZE=thread as well.
+ */
+#include "host-test.h"
+#include "pixeleds-library.h"
+#include "pixeleds-colors.h"
+#include "pixeleds-host.h"
+#include <vector>
+
+#define TEST_SEGMENTS 40
+#define TEST_FRAMES 300
+#define TEST_FRAME_MILLIS 20
+
+struct SegmentOutput {
+    uint32_t hash = 0;
+    int frames = 0;
+};
+
+static void outputSegment(const PixCol *frame, int outputCount, void *context) {
+    SegmentOutput *output = (SegmentOutput*) context;
+    output->hash = pixelHash(frame, outputCount, output->hash);
+    output->frames++;
+}
+
+static std::vector<SegmentOutput> render(int threads) {
+    std::vector<SegmentOutput> outputs(TEST_SEGMENTS);
+    hostSetMillis(1000);
+    PixSegmentRenderer renderer(threads);
+    for (int idx = 0; idx < TEST_SEGMENTS; idx++) {
+        Pixeleds *px = renderer.addSegment(100 + idx * 7, &outputSegment, &outputs[idx]);
+        CHECK(px != nullptr);
+        if (!px) continue;
+        px->setAnimationRefresh(TEST_FRAME_MILLIS);
+        px->setChangeDetection(false);
+        switch (idx % 5) {
+            case 0: px->startAnimation(&animation_gradient, &Color::RAINBOW, 3000 + idx * 10); break;
+            case 1: px->startAnimation(&animation_comet, &Color::BLUES, 2000 + idx * 10); break;
+            case 2: px->startAnimation(&animation_glow, &Color::REDS, 4000 + idx * 10); break;
+            case 3: px->startAnimation(&animation_fader, &Color::RAINBOW, 2500 + idx * 10); break;
+            case 4: px->startAnimation(&animation_bounce, &Color::PURPLES, 1500 + idx * 10); break;
+        }
+    }
+    for (int frame = 0; frame < TEST_FRAMES; frame++) {
+        hostSetMillis(1000 + frame * TEST_FRAME_MILLIS);
+        renderer.render(millis());
+    }
+    return outputs;
+}
+
+int main() {
+    std::vector<SegmentOutput> single = render(1);
+    for (int idx = 0; idx < TEST_SEGMENTS; idx++) {
+        CHECK_EQ(single[idx].frames, TEST_FRAMES);
+    }
+
+    int cores = (int) std::thread::hardware_concurrency();
+    for (int threads : {2, 4, 7, cores}) {
+        if (threads < 2) continue;
+        std::vector<SegmentOutput> outputs = render(threads);
+        for (int idx = 0; idx < TEST_SEGMENTS; idx++) {
+            CHECK_EQ(outputs[idx].frames, single[idx].frames);
+            CHECK_EQ(outputs[idx].hash, single[idx].hash);
+        }
+    }
+    return testResult("segment-renderer");
+}
@@ -0,0 +1,77 @@
+/*
+ * PixSerial through a pseudo-terminal: tools/pixserial-send.py writes raw and run length encoded
+ * frames to the terminal side for a few seconds, the receiver reads the master side. Every frame
+ * must pass its checksum and be shown, and the last one must be in the pixels. The frames per
+ * second reached are printed.
+ */
+#include "host-test.h"
+#include "pixeleds-library.h"
+#include "pixeleds-host.h"
+#include "pixeleds-serial.h"
+#include <fcntl.h>
+#include <thread>
+
+#define TEST_PIXELS 300
+#define TEST_SECONDS "2"
+
+static PixCol pixels[TEST_PIXELS];
+static ParticlePixels strip(pixels, TEST_PIXELS);
+static Pixeleds px(&strip);
+
+// the bars() color of the sender for a pixel of frame n: 6 hues at value 0.3, 10 pixels wide
+static PixCol barColor(int frame, int pixel) {
+    static const PixCol hues[] = { PixCol(76, 0, 0), PixCol(76, 76, 0), PixCol(0, 76, 0),
+                                   PixCol(0, 76, 76), PixCol(0, 0, 76), PixCol(76, 0, 76) };
+    return hues[(pixel + frame) / 10 % 6];
+}
+
+static void runSender(bool rle) {
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    CHECK(master >= 0 && grantpt(master) == 0 && unlockpt(master) == 0);
+    if (master < 0) return;
+    char command[1024];
+    snprintf(command, sizeof(command), "%s %s/tools/pixserial-send.py %s --pixels %d --seconds %s %s 2>&1",
+             PIXELEDS_PYTHON, PIXELEDS_SOURCE_DIR, ptsname(master), TEST_PIXELS, TEST_SECONDS, rle ? "--rle" : "");
+
+    // the sender prints "<frames> frames, <fps> fps, <bytes> bytes/s" when it is done
+    std::atomic<bool> done{false};
+    int sent = -1;
+    std::thread sender([&] {
+        FILE *output = popen(command, "r");
+        char line[256];
+        while (output && fgets(line, sizeof(line), output)) {
+            if (strstr(line, " frames, ")) sent = atoi(line);
+            else printf("%s", line);
+        }
+        if (output) pclose(output);
+        done = true;
+    });
+
+    FdStream stream(master);
+    PixSerial receiver(px, stream);
+    unsigned long begin = micros();
+    while (!done || stream.available() > 0) {
+        if (receiver.receive()) px.update(millis());
+        else usleep(100);
+    }
+    double seconds = (micros() - begin) / 1e6;
+    sender.join();
+    close(master);
+
+    printf("%s: %lu frames, %.0f fps, %.0f bytes/s\n", rle ? "rle" : "raw", receiver.frames,
+           receiver.frames / seconds, receiver.bytes / seconds);
+    CHECK(sent > 0);
+    CHECK_EQ(receiver.frames, sent);
+    CHECK_EQ(receiver.errors, 0);
+    CHECK_EQ(receiver.skipped, 0);
+    bool last = true;
+    for (int idx = 0; idx < TEST_PIXELS; idx++) { last = last && pixels[idx] == barColor(sent - 1, idx); }
+    CHECK(last);
+    CHECK(memcmp(strip.getFrame(), pixels, sizeof(pixels)) == 0);
+}
+
+int main() {
+    runSender(false);
+    runSender(true);
+    return testResult("serial-receiver");
+}
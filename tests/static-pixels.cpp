@@ -0,0 +1,45 @@
+/*
+ * Pixels set directly after a scrolling animation: they are shown without the animation's offset,
+ * and a transition started from them fades out the frame that was shown, not a rotated one.
+ */
+#include "host-test.h"
+#include "pixeleds-library.h"
+#include "pixeleds-colors.h"
+#include "pixeleds-host.h"
+#include <cstdlib>
+#include <cstring>
+
+#define TEST_PIXELS 12
+#define TEST_REFRESH 10
+
+int main() {
+    PixCol pixels[TEST_PIXELS];
+    ParticlePixels strip(pixels, TEST_PIXELS);
+    Pixeleds px(&strip);
+    px.setAnimationRefresh(TEST_REFRESH);
+    hostSetMillis(1000);
+
+    // scroll until the offset is away from 0
+    px.startAnimation(&animation_bars, &Color::RGB, 1000);
+    for (int frame = 0; frame < 27; frame++) {
+        hostAdvanceMillis(TEST_REFRESH + 1);
+        px.update(millis());
+    }
+
+    // a ramp, every pixel different
+    PixCol ramp[TEST_PIXELS];
+    for (int idx = 0; idx < TEST_PIXELS; idx++) { ramp[idx] = PixCol(idx * 20, 0, 0); }
+    PixPal palette(TEST_PIXELS, ramp);
+    px.setPixels(&palette);
+    px.update(millis());
+    PixCol shown[TEST_PIXELS];
+    memcpy(shown, strip.getFrame(), sizeof(shown));
+    for (int idx = 0; idx < TEST_PIXELS; idx++) { CHECK(shown[idx] == pixels[idx]); }
+
+    // the crossfade starts from the frame that was shown
+    px.startAnimation(&animation_glow, &Color::BLUES, 1000, -1, 0, 1000);
+    hostAdvanceMillis(TEST_REFRESH + 1);
+    px.update(millis());
+    for (int idx = 0; idx < TEST_PIXELS; idx++) { CHECK(abs(strip.getFrame()[idx].r - shown[idx].r) <= 4); }
+    return testResult("static-pixels");
+}
@@ -0,0 +1,190 @@
+/*
+ * PixUdp over loopback: DDP and E1.31 packets sent to 127.0.0.1 land in the pixel buffer, a frame is
+ * shown on push, on the last pixel or universe and on a sync packet, and gaps in the sequence
+ * numbers are counted as dropped.
+ */
+#include "host-test.h"
+#include "pixeleds-library.h"
+#include "pixeleds-host.h"
+#include "pixeleds-udp.h"
+#include <vector>
+
+#define TEST_PIXELS 300
+#define TEST_DDP_PORT 24048
+#define TEST_E131_PORT 25568
+#define TEST_SYNC_UNIVERSE 7000
+
+static PixCol pixels[TEST_PIXELS];
+static ParticlePixels strip(pixels, TEST_PIXELS);
+static Pixeleds px(&strip);
+static UDP sender;
+
+// the color of a pixel in frame n
+static PixCol testColor(int frame, int pixel) {
+    return PixCol(frame * 40 + pixel, pixel >> 2, 255 - pixel);
+}
+
+static std::vector<uint8_t> frameBytes(int frame) {
+    std::vector<uint8_t> bytes;
+    for (int idx = 0; idx < TEST_PIXELS; idx++) {
+        PixCol color = testColor(frame, idx);
+        bytes.insert(bytes.end(), { color.r, color.g, color.b });
+    }
+    return bytes;
+}
+
+static bool pixelsAre(int frame, int first, int end) {
+    for (int idx = first; idx < end; idx++) {
+        if (px.getPixels()[idx] != testColor(frame, idx)) return false;
+    }
+    return true;
+}
+
+// receive until the receiver has counted the packets (loopback delivery isn't synchronous), true if a frame was shown
+static bool receivePackets(PixUdp &receiver, unsigned long packets) {
+    bool shown = false;
+    for (int tries = 0; tries < 1000 && receiver.packets < packets; tries++) {
+        shown |= receiver.receive();
+        if (receiver.packets < packets) usleep(1000);
+    }
+    CHECK_EQ(receiver.packets, packets);
+    return shown;
+}
+
+static void sendDdp(uint8_t flags, uint8_t sequence, uint8_t id, size_t offset, const uint8_t *data, size_t length) {
+    uint8_t packet[10 + 1440] = {
+        (uint8_t) (0x40 | flags), sequence, 0x01, id,
+        (uint8_t) (offset >> 24), (uint8_t) (offset >> 16), (uint8_t) (offset >> 8), (uint8_t) offset,
+        (uint8_t) (length >> 8), (uint8_t) length,
+    };
+    memcpy(packet + 10, data, length);
+    CHECK_EQ(sender.sendPacket(packet, 10 + length, IPAddress(127, 0, 0, 1), TEST_DDP_PORT), 10 + length);
+}
+
+static void sendE131(uint16_t universe, uint8_t sequence, uint16_t sync, const uint8_t *data, size_t length) {
+    uint8_t packet[126 + 512] = { 0x00, 0x10, 0x00, 0x00, 'A', 'S', 'C', '-', 'E', '1', '.', '1', '7', 0x00, 0x00, 0x00 };
+    packet[21] = 0x04;                  // root vector data
+    packet[43] = 0x02;                  // framing vector data
+    strcpy((char*) packet + 44, "pixeleds test");
+    packet[108] = 100;                  // priority
+    packet[109] = sync >> 8;
+    packet[110] = sync & 0xFF;
+    packet[111] = sequence;
+    packet[113] = universe >> 8;
+    packet[114] = universe & 0xFF;
+    packet[117] = 0x02;
+    packet[118] = 0xA1;
+    packet[122] = 1;                    // address increment
+    packet[123] = (length + 1) >> 8;    // values including the start code
+    packet[124] = (length + 1) & 0xFF;
+    memcpy(packet + 126, data, length);
+    CHECK_EQ(sender.sendPacket(packet, 126 + length, IPAddress(127, 0, 0, 1), TEST_E131_PORT), 126 + length);
+}
+
+static void sendE131Sync(uint16_t universe, uint8_t sequence) {
+    uint8_t packet[49] = { 0x00, 0x10, 0x00, 0x00, 'A', 'S', 'C', '-', 'E', '1', '.', '1', '7', 0x00, 0x00, 0x00 };
+    packet[21] = 0x08;                  // root vector extended
+    packet[43] = 0x01;                  // framing vector sync
+    packet[44] = sequence;
+    packet[45] = universe >> 8;
+    packet[46] = universe & 0xFF;
+    CHECK_EQ(sender.sendPacket(packet, sizeof(packet), IPAddress(127, 0, 0, 1), TEST_E131_PORT), sizeof(packet));
+}
+
+static void testDdp() {
+    PixUdp receiver(px);
+    CHECK(receiver.begin(PIXUDP_DDP, TEST_DDP_PORT));
+
+    // half a frame, then the rest with the push flag
+    std::vector<uint8_t> frame = frameBytes(1);
+    sendDdp(0, 1, 1, 0, frame.data(), 450);
+    CHECK(!receivePackets(receiver, 1));
+    CHECK(pixelsAre(1, 0, 150));
+    CHECK_EQ(receiver.frames, 0);
+    sendDdp(0x01, 2, 1, 450, frame.data() + 450, 450);
+    CHECK(receivePackets(receiver, 2));
+    CHECK(pixelsAre(1, 0, TEST_PIXELS));
+    CHECK_EQ(receiver.frames, 1);
+
+    // the strip shows the frame on the next update
+    px.update(millis());
+    CHECK(memcmp(strip.getFrame(), px.getPixels(), TEST_PIXELS * sizeof(PixCol)) == 0);
+
+    // sequence 3 and 4 are lost
+    frame = frameBytes(2);
+    sendDdp(0x01, 5, 1, 0, frame.data(), 900);
+    CHECK(receivePackets(receiver, 3));
+    CHECK_EQ(receiver.dropped, 2);
+    CHECK(pixelsAre(2, 0, TEST_PIXELS));
+
+    // a query and a packet for another id are ignored, data past the strip is cut off
+    sendDdp(0x02, 0, 1, 0, frame.data(), 3);
+    sendDdp(0x01, 0, 2, 0, frame.data(), 3);
+    CHECK(!receivePackets(receiver, 5));
+    CHECK_EQ(receiver.invalid, 2);
+    frame = frameBytes(3);
+    sendDdp(0x01, 0, 1, 897, frame.data(), 30);
+    CHECK(receivePackets(receiver, 6));
+    CHECK(px.getPixels()[TEST_PIXELS - 1] == testColor(3, 0));
+    CHECK_EQ(receiver.frames, 3);
+}
+
+static void testDdpWithoutPush() {
+    PixUdp receiver(px);
+    CHECK(receiver.begin(PIXUDP_DDP, TEST_DDP_PORT));
+    std::vector<uint8_t> frame = frameBytes(4);
+    sendDdp(0, 0, 1, 0, frame.data(), 600);
+    CHECK(!receivePackets(receiver, 1));
+    sendDdp(0, 0, 1, 600, frame.data() + 600, 300);  // ends at the last pixel
+    CHECK(receivePackets(receiver, 2));
+    CHECK(pixelsAre(4, 0, TEST_PIXELS));
+    CHECK_EQ(receiver.frames, 1);
+}
+
+static void testE131() {
+    PixUdp receiver(px);
+    CHECK(receiver.begin(PIXUDP_E131, TEST_E131_PORT, 1));
+
+    // 300 pixels are 900 channels in universes 1 (510) and 2 (390), the last one shows the frame
+    std::vector<uint8_t> frame = frameBytes(5);
+    sendE131(1, 10, 0, frame.data(), 510);
+    CHECK(!receivePackets(receiver, 1));
+    CHECK(pixelsAre(5, 0, 170));
+    sendE131(2, 10, 0, frame.data() + 510, 390);
+    CHECK(receivePackets(receiver, 2));
+    CHECK(pixelsAre(5, 0, TEST_PIXELS));
+    CHECK_EQ(receiver.frames, 1);
+
+    // universe 1 skips two sequence numbers, a late packet is discarded
+    frame = frameBytes(6);
+    sendE131(1, 13, 0, frame.data(), 510);
+    sendE131(1, 12, 0, frame.data(), 510);
+    CHECK(!receivePackets(receiver, 4));
+    CHECK_EQ(receiver.dropped, 2);
+    CHECK_EQ(receiver.invalid, 1);
+
+    // with synchronization the frame waits for the sync packet, even after the last universe
+    frame = frameBytes(7);
+    sendE131(1, 14, TEST_SYNC_UNIVERSE, frame.data(), 510);
+    sendE131(2, 11, TEST_SYNC_UNIVERSE, frame.data() + 510, 390);
+    CHECK(!receivePackets(receiver, 6));
+    CHECK(pixelsAre(7, 0, TEST_PIXELS));
+    CHECK_EQ(receiver.frames, 1);
+    sendE131Sync(TEST_SYNC_UNIVERSE + 1, 0);
+    CHECK(!receivePackets(receiver, 7));
+    sendE131Sync(TEST_SYNC_UNIVERSE, 1);
+    CHECK(receivePackets(receiver, 8));
+    CHECK_EQ(receiver.frames, 2);
+
+    // a universe outside the strip is ignored
+    sendE131(3, 0, 0, frame.data(), 510);
+    CHECK(!receivePackets(receiver, 9));
+    CHECK_EQ(receiver.invalid, 2);
+}
+
+int main() {
+    testDdp();
+    testDdpWithoutPush();
+    testE131();
+    return testResult("udp-receiver");
+}
@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+"""
+Send frames rendered on the PC to a PixSerial receiver over a serial port (e.g. the device's USB
+serial port, or a pseudo-terminal when testing).
+
+    pixserial-send.py /dev/ttyACM0 --pixels 300 --fps 60
+    pixserial-send.py /dev/ttyACM0 --pixels 300 --rle --seconds 30
+
+Frame layout (little endian), see src/pixeleds-serial.h:
+    "PX" [flags:1] [offset:2] [length:2] payload [sum1:1] [sum2:1]   (Fletcher-16 of all before it)
+"""
+
+import argparse
+import colorsys
+import os
+import struct
+import sys
+import termios
+import time
+import tty
+
+FLAG_RLE = 0x01
+FLAG_SHOW = 0x02
+
+
+def fletcher16(data):
+    sum1 = sum2 = 0
+    for value in data:
+        sum1 = (sum1 + value) % 255
+        sum2 = (sum2 + sum1) % 255
+    return bytes((sum1, sum2))
+
+
+def rle(frame):
+    runs = bytearray()
+    idx = 0
+    while idx < len(frame):
+        color = frame[idx:idx + 3]
+        count = 1
+        while count < 255 and idx + count * 3 < len(frame) and frame[idx + count * 3:idx + count * 3 + 3] == color:
+            count += 1
+        runs += bytes((count,)) + color
+        idx += count * 3
+    return bytes(runs)
+
+
+def packet(frame, offset=0, use_rle=False, show=True):
+    payload = rle(frame) if use_rle else frame
+    flags = (FLAG_RLE if use_rle else 0) | (FLAG_SHOW if show else 0)
+    data = b'PX' + struct.pack('<BHH', flags, offset, len(payload)) + payload
+    return data + fletcher16(data)
+
+
+def bars(pixels, shift, width=10):
+    """bars of a few colors, so run length encoding has something to do"""
+    frame = bytearray()
+    for idx in range(pixels):
+        r, g, b = colorsys.hsv_to_rgb(((idx + shift) // width % 6) / 6, 1.0, 0.3)
+        frame += bytes((int(r * 255), int(g * 255), int(b * 255)))
+    return bytes(frame)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0].strip())
+    parser.add_argument('port', help='serial device')
+    parser.add_argument('--pixels', type=int, default=300)
+    parser.add_argument('--fps', type=float, default=0, help='frames per second (default: as fast as possible)')
+    parser.add_argument('--rle', action='store_true', help='run length encode the frames')
+    parser.add_argument('--seconds', type=float, default=10)
+    args = parser.parse_args()
+
+    fd = os.open(args.port, os.O_RDWR | os.O_NOCTTY)
+    if os.isatty(fd):
+        tty.setraw(fd)
+        attributes = termios.tcgetattr(fd)
+        attributes[4] = attributes[5] = termios.B115200  # ignored by USB CDC
+        termios.tcsetattr(fd, termios.TCSANOW, attributes)
+
+    frames = sent = 0
+    start = time.monotonic()
+    deadline = start
+    while time.monotonic() - start < args.seconds:
+        data = packet(bars(args.pixels, frames), use_rle=args.rle)
+        view = memoryview(data)
+        while view:
+            view = view[os.write(fd, view):]
+        frames += 1
+        sent += len(data)
+        if args.fps:
+            deadline += 1.0 / args.fps
+            time.sleep(max(0.0, deadline - time.monotonic()))
+    elapsed = time.monotonic() - start
+    os.close(fd)
+    print('%d frames, %.1f fps, %.0f bytes/s' % (frames, frames / elapsed, sent / elapsed), file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+"""
+Send a moving rainbow to a PixUdp receiver using DDP or E1.31 (sACN).
+
+    pixudp-send.py 192.168.1.50 --pixels 1000 --fps 40
+    pixudp-send.py 192.168.1.50 --pixels 1000 --protocol e131 --universe 1
+    pixudp-send.py 127.0.0.1 --port 14048 --drop 0.01     # loopback, dropping 1% of the packets
+
+Use --drop to check that the receiver's dropped packet count follows.
+"""
+
+import argparse
+import colorsys
+import random
+import socket
+import struct
+import time
+
+DDP_PORT = 4048
+E131_PORT = 5568
+DDP_CHUNK = 1440          # 480 pixels per packet
+E131_CHANNELS = 510       # 170 pixels per universe
+CID = bytes(range(16))
+
+
+def rainbow(pixels, shift):
+    frame = bytearray()
+    for idx in range(pixels):
+        r, g, b = colorsys.hsv_to_rgb(((idx + shift) % pixels) / pixels, 1.0, 0.3)
+        frame += bytes((int(r * 255), int(g * 255), int(b * 255)))
+    return bytes(frame)
+
+
+def ddp_packets(frame, sequence):
+    packets = []
+    for offset in range(0, len(frame), DDP_CHUNK):
+        data = frame[offset:offset + DDP_CHUNK]
+        push = offset + DDP_CHUNK >= len(frame)
+        flags = 0x40 | (0x01 if push else 0)
+        packets.append(struct.pack('>BBBBIH', flags, sequence, 1, 1, offset, len(data)) + data)
+        sequence = sequence % 15 + 1
+    return packets, sequence
+
+
+def e131_packet(universe, sequence, data):
+    dmp = struct.pack('>HBBHHH', 0x7000 | (10 + 1 + len(data)), 0x02, 0xA1, 0, 1, 1 + len(data)) + b'\x00' + data
+    framing = (struct.pack('>HI', 0x7000 | (77 + len(dmp)), 0x00000002) + b'pixudp-send'.ljust(64, b'\x00')
+               + struct.pack('>BHBBH', 100, 0, sequence, 0, universe))
+    root = (struct.pack('>HH', 0x0010, 0) + b'ASC-E1.17\x00\x00\x00'
+            + struct.pack('>HI', 0x7000 | (22 + len(framing) + len(dmp)), 0x00000004) + CID)
+    return root + framing + dmp
+
+
+def e131_packets(frame, sequence, first_universe):
+    packets = []
+    for idx, offset in enumerate(range(0, len(frame), E131_CHANNELS)):
+        packets.append(e131_packet(first_universe + idx, sequence, frame[offset:offset + E131_CHANNELS]))
+    return packets, (sequence + 1) % 256
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0].strip())
+    parser.add_argument('host')
+    parser.add_argument('--protocol', choices=('ddp', 'e131'), default='ddp')
+    parser.add_argument('--port', type=int, help='default 4048 (ddp) or 5568 (e131)')
+    parser.add_argument('--pixels', type=int, default=1000)
+    parser.add_argument('--fps', type=float, default=40)
+    parser.add_argument('--universe', type=int, default=1, help='first E1.31 universe')
+    parser.add_argument('--drop', type=float, default=0, help='fraction of packets to drop on purpose')
+    parser.add_argument('--seconds', type=float, default=0, help='stop after this long (default: run forever)')
+    args = parser.parse_args()
+
+    port = args.port or (E131_PORT if args.protocol == 'e131' else DDP_PORT)
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sequence = 1
+    frames = packets = dropped = 0
+    start = report = time.monotonic()
+    deadline = start
+    while not args.seconds or time.monotonic() - start < args.seconds:
+        frame = rainbow(args.pixels, frames)
+        if args.protocol == 'e131':
+            batch, sequence = e131_packets(frame, sequence, args.universe)
+        else:
+            batch, sequence = ddp_packets(frame, sequence)
+        for packet in batch:
+            if random.random() < args.drop:
+                dropped += 1
+                continue
+            sock.sendto(packet, (args.host, port))
+            packets += 1
+        frames += 1
+
+        now = time.monotonic()
+        if now - report >= 5:
+            print('%.1f fps, %d packets, %d dropped on purpose' % (frames / (now - start), packets, dropped))
+            report = now
+        deadline += 1.0 / args.fps
+        time.sleep(max(0.0, deadline - time.monotonic()))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+"""
+Encode a pre-rendered animation into a Pixeleds stream (.pxs) for PixStream.
+
+Input is raw 24-bit RGB frames, pixels * 3 bytes per frame, as written by most LED authoring
+tools or e.g. `ffmpeg -i show.mp4 -vf scale=60:1 -f rawvideo -pix_fmt rgb24 show.rgb`.
+An image can be used instead (one row per frame, needs Pillow).
+
+    pxs-encode.py show.rgb --pixels 60 --fps 50 -o show.pxs
+    pxs-encode.py show.png --fps 30 -o show.pxs
+    pxs-encode.py show.rgb --pixels 60 --fps 50 --c-array show > show.h   # for flash
+
+Stream layout (little endian), see src/pixeleds-stream.h:
+    header: "PXS" [version:1] [pixelCount:2] [flags:2] [frameCount:4] [duration:4]
+    frames: [millis:4] [type:1] [length:3] then length bytes of ops,
+            op: [skip:2] [count:2] + count colors, or one color if bit 15 of count is set
+"""
+
+import argparse
+import struct
+import sys
+
+VERSION = 1
+FRAME_KEY = 0
+FRAME_DELTA = 1
+MAX_SKIP = 0xFFFF
+MAX_COUNT = 0x7FFF
+MIN_FILL = 4  # shorter runs of one color are cheaper as part of a literal run
+
+
+def read_frames(path, pixels):
+    if path.lower().endswith(('.png', '.gif', '.bmp')):
+        from PIL import Image
+        image = Image.open(path).convert('RGB')
+        width, height = image.size
+        data = image.tobytes()
+        return width, [data[row * width * 3:(row + 1) * width * 3] for row in range(height)]
+    if not pixels:
+        sys.exit('--pixels is required for raw input')
+    with open(path, 'rb') if path != '-' else sys.stdin.buffer as f:
+        data = f.read()
+    size = pixels * 3
+    if len(data) % size:
+        sys.exit('input is not a whole number of %d pixel frames' % pixels)
+    return pixels, [data[pos:pos + size] for pos in range(0, len(data), size)]
+
+
+def color(frame, idx):
+    return frame[idx * 3:idx * 3 + 3]
+
+
+def runs(frame, start, end):
+    """split [start, end) into (fill, start, count) runs"""
+    idx = start
+    literal = start
+    while idx < end:
+        same = idx + 1
+        while same < end and same - idx < MAX_COUNT and color(frame, same) == color(frame, idx):
+            same += 1
+        if same - idx >= MIN_FILL:
+            while literal < idx:
+                count = min(idx - literal, MAX_COUNT)
+                yield False, literal, count
+                literal += count
+            yield True, idx, same - idx
+            literal = same
+        idx = same
+    while literal < end:
+        count = min(end - literal, MAX_COUNT)
+        yield False, literal, count
+        literal += count
+
+
+def changed_ranges(frame, previous, count):
+    """ranges of changed pixels, gaps of one unchanged pixel are kept in the range"""
+    if previous is None:
+        return [(0, count)] if count else []
+    ranges = []
+    idx = 0
+    while idx < count:
+        if color(frame, idx) == color(previous, idx):
+            idx += 1
+            continue
+        start = idx
+        while idx < count and (color(frame, idx) != color(previous, idx) or
+                               (idx + 1 < count and color(frame, idx + 1) != color(previous, idx + 1))):
+            idx += 1
+        ranges.append((start, idx))
+    return ranges
+
+
+def encode_ops(frame, previous, count):
+    ops = bytearray()
+    position = 0
+    for start, end in changed_ranges(frame, previous, count):
+        for fill, run, length in runs(frame, start, end):
+            skip = run - position
+            while skip > MAX_SKIP:
+                ops += struct.pack('<HH', MAX_SKIP, 0)
+                skip -= MAX_SKIP
+            ops += struct.pack('<HH', skip, length | (0x8000 if fill else 0))
+            ops += color(frame, run) if fill else frame[run * 3:(run + length) * 3]
+            position = run + length
+    return bytes(ops)
+
+
+def encode(frames, pixels, fps, keyframe_interval):
+    body = bytearray()
+    written = 0
+    previous = None
+    for idx, frame in enumerate(frames):
+        key = previous is None or (keyframe_interval and idx % keyframe_interval == 0)
+        if not key and frame == previous:
+            continue  # nothing changed, the previous frame stays
+        ops = encode_ops(frame, None if key else previous, pixels)
+        millis = idx * 1000 // fps
+        body += struct.pack('<IB', millis, FRAME_KEY if key else FRAME_DELTA)
+        body += struct.pack('<I', len(ops))[:3]
+        body += ops
+        previous = frame
+        written += 1
+    duration = len(frames) * 1000 // fps
+    header = b'PXS' + struct.pack('<BHHII', VERSION, pixels, 0, written, duration)
+    return header + bytes(body), written
+
+
+def c_array(name, data):
+    lines = ['// generated by pxs-encode.py', '#pragma once', '#include <stdint.h>', '',
+             'const uint8_t %s[%d] = {' % (name, len(data))]
+    for pos in range(0, len(data), 16):
+        lines.append('    ' + ', '.join('0x%02x' % b for b in data[pos:pos + 16]) + ',')
+    lines.append('};')
+    return '\n'.join(lines) + '\n'
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0].strip())
+    parser.add_argument('input', help='raw rgb24 frames (- for stdin), or an image with one row per frame')
+    parser.add_argument('--pixels', type=int, help='pixels per frame (raw input)')
+    parser.add_argument('--fps', type=int, default=50, help='frames per second (default 50)')
+    parser.add_argument('--keyframe-interval', type=int, default=0,
+                        help='write a keyframe every N frames (default: only the first)')
+    parser.add_argument('--c-array', metavar='NAME', help='write a C header with a const array instead')
+    parser.add_argument('-o', '--output', default='-', help='output file (default stdout)')
+    args = parser.parse_args()
+
+    pixels, frames = read_frames(args.input, args.pixels)
+    if not frames:
+        sys.exit('no frames')
+    if pixels > MAX_SKIP:
+        sys.exit('too many pixels')
+    stream, written = encode(frames, pixels, args.fps, args.keyframe_interval)
+    raw = pixels * 3 * len(frames)
+    print('%d pixels, %d frames (%d stored), %d bytes (%.1f%% of raw)'
+          % (pixels, len(frames), written, len(stream), 100.0 * len(stream) / raw), file=sys.stderr)
+
+    output = c_array(args.c_array, stream).encode() if args.c_array else stream
+    if args.output == '-':
+        sys.stdout.buffer.write(output)
+    else:
+        with open(args.output, 'wb') as f:
+            f.write(output)
+
+
+if __name__ == '__main__':
+    main()